@@ -0,0 +1,65 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Arena.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "Arena.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+/**
+ *  Arena Constructor
+ *
+ *  _size   the amount of memory to preallocate
+ *
+ *  Constructs an empty arena of _size bytes. Kills the executing
+ *  program on malloc failure.
+ */
+Arena::Arena (size_t _size)
+    : size (_size), head (0) {
+    if (!(data = (BytePointer)malloc(size))) {
+        std::cout << "ERROR: malloc failure" << std::endl;
+        exit (1);
+    }
+}
+
+/**
+ *  Arena Destructor
+ *
+ *  Frees the block of memory
+ */
+Arena::~Arena () {
+    free (data);
+}
+
+/**
+ *  allocate
+ *
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *
+ *  Allocates a block with a stricter alignment than ARENA_ALIGNMENT,
+ *  such as a cache line or a page. The padding depends on where the
+ *  offset is when the block is placed, so this takes a compare and swap
+ *  loop rather than a single fetch_add. returns a null pointer on failure.
+ */
+void* Arena::allocate (size_t _size, size_t _alignment) {
+    if (_alignment == 0 || (_alignment & (_alignment - 1)) != 0) return nullptr;
+    if (_alignment <= ARENA_ALIGNMENT) return allocate (_size);
+    if (_size > size) return nullptr;
+
+    size_t bytes  = (_size + ARENA_ALIGNMENT - 1) & ~size_t(ARENA_ALIGNMENT - 1);
+    size_t offset = head.load (std::memory_order_relaxed);
+    size_t start;
+    do {
+        if (offset > size) return nullptr;
+
+        // compared against what is left, so no sum can wrap
+        size_t padding = alignmentPadding (data + offset, _alignment);
+        if (padding > size - offset || bytes > size - offset - padding) return nullptr;
+        start = offset + padding;
+    } while (!head.compare_exchange_weak (offset, start + bytes, std::memory_order_relaxed));
+
+    return data + start;
+}
@@ -0,0 +1,67 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Arena.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Arena_hpp
+#define Arena_hpp
+
+#include "BytePointer.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+#define ARENA_ALIGNMENT alignof(std::max_align_t)
+
+/**
+ *  Arena
+ *
+ *  A linear allocator that any number of threads can share without a
+ *  lock. Allocating is one atomic fetch_add on the offset into the
+ *  block and nothing is stored per allocation, so blocks cannot be
+ *  freed one at a time; release() hands everything back in O(1). Sizes
+ *  are rounded up to ARENA_ALIGNMENT so every block stays aligned.
+ */
+class Arena {
+    public:
+        Arena (size_t _size);
+       ~Arena ();
+
+        /** return nullptr on fail */
+        inline void* allocate (size_t _size) {
+            // checked before rounding, which would wrap for a size near the top
+            if (_size > size) return nullptr;
+
+            size_t bytes  = (_size + ARENA_ALIGNMENT - 1) & ~size_t(ARENA_ALIGNMENT - 1);
+            size_t offset = head.fetch_add (bytes, std::memory_order_relaxed);
+
+            // a failed request still moves head past the end, on purpose:
+            // taking it back would race with the threads already past it,
+            // and once the arena is full every later request fails anyway
+            if (offset > size || bytes > size - offset) return nullptr;
+            return data + offset;
+        }
+
+        /** return nullptr on fail */
+        void* allocate (size_t _size, size_t _alignment);
+
+        /** only safe once every thread is done with its blocks */
+        inline void release () { head.store (0, std::memory_order_relaxed); }
+
+        inline size_t occupiedMemory () {
+            size_t used = head.load (std::memory_order_relaxed);
+            return (used < size) ? used : size;
+        }
+        inline size_t totalMemory    () { return size; }
+        inline size_t freeMemory     () { return size - occupiedMemory(); }
+
+    private:
+        Arena (const Arena&) = delete;
+        Arena& operator= (const Arena&) = delete;
+
+        BytePointer         data; // the handle to the preallocated memory
+        size_t              size; // the total size of the preallocated memory
+        std::atomic<size_t> head; // the offset of the next allocation
+};
+
+#endif /* Arena_hpp */
@@ -0,0 +1,201 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Backing.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "Backing.hpp"
+#include "SystemQueries.hpp"
+
+#include <cstdlib>
+
+#if defined __unix__ || defined __APPLE__
+    #define BACKING_MMAP
+    #include <sys/mman.h>
+    #include <unistd.h>
+
+    #ifndef MAP_ANONYMOUS
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+#endif
+
+#if defined __linux__
+    #include <sys/syscall.h>
+    #include <linux/mempolicy.h>
+#endif
+
+#define BACKING_MAX_NODES 1024 // the most NUMA nodes mbind is told about
+
+#ifndef MAP_HUGE_SHIFT
+    #define MAP_HUGE_SHIFT 26
+#endif
+
+namespace {
+    /**
+     *  touch
+     *
+     *  writes a byte to every page so they are all faulted in now.
+     */
+    void touch (BytePointer _data, size_t _size, size_t _page) {
+        for (size_t offset = 0; offset < _size; offset += _page) ((volatile char*)_data)[offset] = 0;
+    }
+}
+
+/**
+ *  Backing Constructor
+ *
+ *  _kind   heap or mapped memory
+ *  _flags  Flags for mapped memory
+ *  _node   the NUMA node mapped memory is bound to, -1 for none
+ */
+Backing::Backing (Kind _kind, unsigned _flags, int _node)
+    : type (_kind), options (_flags), numa (_node) {}
+
+/**
+ *  pageSize
+ *
+ *  the system's base page size.
+ */
+size_t Backing::pageSize () {
+    return (size_t)systemPageSize();
+}
+
+/**
+ *  granularity
+ *
+ *  the page size mapped memory is rounded to.
+ */
+size_t Backing::granularity () const {
+    if (options & GiantPages) return BACKING_GIANT_PAGE;
+    if (options & HugePages)  return BACKING_HUGE_PAGE;
+    return pageSize();
+}
+
+/**
+ *  acquire
+ *
+ *  _size       the bytes required
+ *  _alignment  the power of two the memory must start on
+ *  _base       set to what must be handed to dispose
+ *  _reserved   set to the bytes actually reserved
+ *
+ *  Gets a block of at least _size bytes aligned to _alignment. Mapped
+ *  memory is rounded to whole pages; reserved huge pages are tried
+ *  first, then ordinary ones over reserved by the alignment with the
+ *  ends unmapped again. returns a null pointer on failure.
+ */
+BytePointer Backing::acquire (size_t _size, size_t _alignment, BytePointer& _base, size_t& _reserved) const {
+#ifdef BACKING_MMAP
+    if (type == Mapped) {
+        size_t page   = granularity();
+        size_t length = (_size + page - 1) & ~(page - 1);
+        if (length == 0) length = page;
+
+        int   prot      = PROT_READ | PROT_WRITE;
+        int   flags     = MAP_PRIVATE | MAP_ANONYMOUS;
+        void* map       = MAP_FAILED;
+        bool  populated = false;
+
+    #ifdef MAP_HUGETLB
+        // reserved huge pages come aligned to their own size
+        if (page > pageSize() && _alignment <= page) {
+            int huge = MAP_HUGETLB | ((options & GiantPages) ? (30 << MAP_HUGE_SHIFT) : (21 << MAP_HUGE_SHIFT));
+            map = mmap (nullptr, length, prot, flags | huge, -1, 0);
+        }
+    #endif
+
+        if (map == MAP_FAILED) {
+            // huge pages want their size as alignment to be backed by one
+            size_t alignment = (_alignment > page) ? _alignment : page;
+            if (alignment < pageSize()) alignment = pageSize();
+
+        #ifdef MAP_POPULATE
+            // the kernel can only fault in a mapping kept whole and unbound
+            if ((options & Populate) && numa < 0 && alignment == pageSize()) {
+                flags    |= MAP_POPULATE;
+                populated = true;
+            }
+        #endif
+
+            size_t span = length + alignment - pageSize();
+            BytePointer raw = (BytePointer)mmap (nullptr, span, prot, flags, -1, 0);
+            if (raw == (BytePointer)MAP_FAILED) return nullptr;
+
+            size_t head = alignmentPadding (raw, alignment);
+            if (head > 0) munmap (raw, head);
+            if (span - head > length) munmap (raw + head + length, span - head - length);
+            map = raw + head;
+
+        #ifdef MADV_HUGEPAGE
+            if (page > pageSize()) madvise (map, length, MADV_HUGEPAGE);
+        #endif
+        }
+
+    #if defined __linux__ && defined SYS_mbind
+        // bound before anything is faulted in, so every page lands there
+        const int bits = 8 * sizeof(unsigned long);
+        if (numa >= 0 && numa < BACKING_MAX_NODES) {
+            unsigned long mask[BACKING_MAX_NODES / bits] = {};
+            mask[numa / bits] = 1UL << (numa % bits);
+            syscall (SYS_mbind, map, length, MPOL_BIND, mask, (unsigned long)BACKING_MAX_NODES, 0);
+        }
+    #endif
+
+        if ((options & Populate) && !populated) touch ((BytePointer)map, length, pageSize());
+
+        _base     = (BytePointer)map;
+        _reserved = length;
+        return _base;
+    }
+#endif
+
+    size_t extra = (_alignment > alignof(std::max_align_t)) ? _alignment - 1 : 0;
+    BytePointer raw = (BytePointer)malloc (_size + extra);
+    if (raw == nullptr) return nullptr;
+
+    if (options & Populate) touch (raw, _size + extra, pageSize());
+
+    _base     = raw;
+    _reserved = _size + extra;
+    return raw + alignmentPadding (raw, (extra > 0) ? _alignment : 1);
+}
+
+/**
+ *  dispose
+ *
+ *  _base       the base set by acquire
+ *  _reserved   the bytes set by acquire
+ *
+ *  Hands a block back to where it came from.
+ */
+void Backing::dispose (BytePointer _base, size_t _reserved) const {
+#ifdef BACKING_MMAP
+    if (type == Mapped) {
+        munmap (_base, _reserved);
+        return;
+    }
+#endif
+    free (_base);
+}
+
+/**
+ *  discard
+ *
+ *  _data   the start of memory no longer in use
+ *  _size   the size of the memory
+ *
+ *  Tells the system the contents of the pages wholly inside the range
+ *  are not needed. They stay mapped and read back as zero, but stop
+ *  counting against the process until they are touched again.
+ */
+void Backing::discard (BytePointer _data, size_t _size) const {
+#ifdef BACKING_MMAP
+    if (type != Mapped) return;
+
+    size_t page  = granularity();
+    size_t head  = alignmentPadding (_data, page);
+    if (_size <= head) return;
+
+    size_t length = (_size - head) & ~(page - 1);
+    if (length > 0) madvise (_data + head, length, MADV_DONTNEED);
+#endif
+}
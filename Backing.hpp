@@ -0,0 +1,60 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Backing.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Backing_hpp
+#define Backing_hpp
+
+#include "BytePointer.hpp"
+
+#include <cstddef>
+
+#define BACKING_HUGE_PAGE  (size_t(1) << 21) // 2 MB, x86-64 and arm64
+#define BACKING_GIANT_PAGE (size_t(1) << 30) // 1 GB
+
+/**
+ *  Backing
+ *
+ *  where a manager gets its memory from. Heap memory comes from malloc
+ *  as it always has. Mapped memory comes straight from mmap, so it can
+ *  be placed on huge pages to take pressure off the TLB, faulted in up
+ *  front, bound to a NUMA node and handed back to the system page by
+ *  page when the manager is released. Huge pages fall back to ordinary
+ *  pages (with a transparent huge page hint) when none are reserved,
+ *  and on platforms without mmap Mapped behaves like Heap.
+ */
+class Backing {
+    public:
+        enum Kind { Heap, Mapped };
+        enum Flags : unsigned {
+            None       = 0,
+            HugePages  = 1, // 2 MB pages
+            GiantPages = 2, // 1 GB pages
+            Populate   = 4  // fault every page in before the memory is used
+        };
+
+        Backing (Kind _kind = Heap, unsigned _flags = None, int _node = -1);
+
+        /** return nullptr on fail, _base and _reserved go to dispose */
+        BytePointer acquire (size_t _size, size_t _alignment, BytePointer& _base, size_t& _reserved) const;
+        void        dispose (BytePointer _base, size_t _reserved) const;
+
+        /** lets the system reclaim whole pages in the range, Mapped only */
+        void discard (BytePointer _data, size_t _size) const;
+
+        inline Kind     kind  () const { return type; }
+        inline unsigned flags () const { return options; }
+        inline int      node  () const { return numa; }
+
+        static size_t pageSize ();
+
+    private:
+        size_t granularity () const;
+
+        Kind     type;    // heap or mapped memory
+        unsigned options; // Flags for mapped memory
+        int      numa;    // the node to bind to, -1 for no binding
+};
+
+#endif /* Backing_hpp */
@@ -0,0 +1,205 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BasicMemoryManager.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BasicMemoryManager_hpp
+#define BasicMemoryManager_hpp
+
+#include "BytePointer.hpp"
+#include "Backing.hpp"
+#include "Region.hpp"
+#include "Threading.hpp"
+#include "Stats.hpp"
+#include "Debug.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+/**
+ *  BasicMemoryManager
+ *
+ *  A memory manager put together from policies at compile time. The
+ *  Strategy decides how blocks are placed and freed (StackStrategy,
+ *  QueueStrategy or PoolStrategy), the ThreadingPolicy how calls are
+ *  serialised (SingleThreaded or Locked), the BackingStore where the
+ *  region's memory comes from (Backing), the StatsPolicy what is
+ *  counted along the way (NoStats or Stats) and the DebugPolicy what is
+ *  checked (NoDebug or Guarded). Nothing is chosen at run time, so
+ *  the fast path of the strategy inlines into the caller, and the empty
+ *  policies are empty bases that take up no space.
+ */
+template <class Strategy,
+          class ThreadingPolicy = SingleThreaded,
+          class BackingStore    = Backing,
+          class StatsPolicy     = NoStats,
+          class DebugPolicy     = NoDebug>
+class BasicMemoryManager : private ThreadingPolicy, private StatsPolicy, private DebugPolicy {
+    public:
+        /** _args go to the strategy, e.g. a FreeIndex::Policy for PoolStrategy */
+        template <class... Args>
+        explicit BasicMemoryManager (size_t _size, Growth _growth = Growth { Growth::None, 0, 0 },
+                                     BackingStore _backing = BackingStore(), Args&&... _args)
+            : region (_size, _growth, _backing), strategy (region, std::forward<Args>(_args)...) {}
+
+        /** what is still live is a leak to the DebugPolicy */
+       ~BasicMemoryManager () { DebugPolicy::released(); }
+
+        /** return nullptr on fail, _site is only kept by a DebugPolicy */
+        inline void* allocate (size_t _size, size_t _alignment = alignof(std::max_align_t), Site _site = Site()) {
+            // not a power of two, no address can satisfy it
+            if (_alignment == 0 || (_alignment & (_alignment - 1)) != 0) return nullptr;
+
+            std::lock_guard<ThreadingPolicy> guard (*this);
+
+            void*  block = nullptr;
+            size_t span  = DebugPolicy::span (_size, _alignment);
+            if (span < region.total() - region.occupied() || region.growable()) {
+                block = DebugPolicy::guard (strategy.allocate (region, span, DebugPolicy::alignment (_alignment)), _size, _alignment, _site);
+            }
+
+            StatsPolicy::allocated (_size, block, region.occupied());
+            if (block != nullptr) StatsPolicy::searched (strategy.searchLength());
+            return block;
+        }
+
+        /** return false on fail */
+        inline bool deallocate (void* _data) {
+            std::lock_guard<ThreadingPolicy> guard (*this);
+            return deallocateOne (_data);
+        }
+
+        /** all or nothing, return false on fail */
+        inline bool allocateBatch (size_t _size, size_t _count, void** _out,
+                                   size_t _alignment = alignof(std::max_align_t)) {
+            if (_alignment == 0 || (_alignment & (_alignment - 1)) != 0) return false;
+
+            std::lock_guard<ThreadingPolicy> guard (*this);
+
+            bool allocated = strategy.allocateBatch (region, DebugPolicy::span (_size, _alignment), DebugPolicy::alignment (_alignment), _count, _out);
+            if (allocated && DebugPolicy::Enabled) {
+                for (size_t i = 0; i < _count; ++i) _out[i] = DebugPolicy::guard (_out[i], _size, _alignment, Site());
+            }
+
+            if (!allocated) StatsPolicy::allocated (_size, nullptr, region.occupied());
+            else for (size_t i = 0; i < _count; ++i) StatsPolicy::allocated (_size, _out[i], region.occupied());
+            return allocated;
+        }
+
+        /** returns the number freed, moved to the front of _data */
+        inline size_t deallocate (void** _data, size_t _count) {
+            std::lock_guard<ThreadingPolicy> guard (*this);
+
+            // every block is checked on its own, so the strategy sees them one at a time
+            if (DebugPolicy::Enabled) {
+                size_t freed = 0;
+                for (size_t i = 0; i < _count; ++i) {
+                    if (deallocateOne (_data[i])) std::swap (_data[i], _data[freed++]);
+                }
+                return freed;
+            }
+
+            size_t freed = strategy.deallocateBatch (region, _data, _count);
+            for (size_t i = 0; i < freed; ++i) StatsPolicy::freed (_data[i], true);
+            return freed;
+        }
+
+        void release ();
+
+        /** Stack only: how deep the stack is now, to free back to later */
+        template <class S = Strategy>
+        inline typename S::Marker getMarker () {
+            std::lock_guard<ThreadingPolicy> guard (*this);
+            return strategy.marker();
+        }
+
+        /** Stack only: frees every block allocated since _marker, return false when they are already gone */
+        template <class S = Strategy>
+        inline bool freeToMarker (typename S::Marker _marker) {
+            std::lock_guard<ThreadingPolicy> guard (*this);
+            return strategy.freeToMarker (region, _marker, [this] (void* _block) { StatsPolicy::freed (DebugPolicy::dropped (_block), true); });
+        }
+
+        /** Stack only: a block from the other end of the preallocated memory, return nullptr on fail */
+        inline void* allocateHigh (size_t _size, size_t _alignment = alignof(std::max_align_t), Site _site = Site()) {
+            if (_alignment == 0 || (_alignment & (_alignment - 1)) != 0) return nullptr;
+
+            std::lock_guard<ThreadingPolicy> guard (*this);
+
+            size_t span  = DebugPolicy::span (_size, _alignment);
+            void*  block = DebugPolicy::guard (strategy.allocateHigh (region, span, DebugPolicy::alignment (_alignment)), _size, _alignment, _site);
+            StatsPolicy::allocated (_size, block, region.occupied());
+            return block;
+        }
+
+        /** whether deallocate would accept _data right now */
+        inline bool freeable (void* _data) {
+            std::lock_guard<ThreadingPolicy> guard (*this);
+
+            void* block = DebugPolicy::block (region, _data);
+            return block != nullptr && strategy.freeable (region, block);
+        }
+
+        inline size_t occupiedMemory () { return region.occupied(); }
+        inline size_t totalMemory    () { return region.total(); }
+        inline size_t freeMemory     () { return region.total() - region.occupied(); }
+
+        Statistics statistics ();
+
+    private:
+        BasicMemoryManager (const BasicMemoryManager&) = delete;
+        BasicMemoryManager& operator= (const BasicMemoryManager&) = delete;
+
+        /** deallocate with the lock held */
+        inline bool deallocateOne (void* _data) {
+            void* block = DebugPolicy::retire (region, _data, [this] (void* _block) { return strategy.freeable (region, _block); });
+            bool  freed = block != nullptr && strategy.deallocate (region, block);
+            StatsPolicy::freed (_data, freed);
+            return freed;
+        }
+
+        Region<BackingStore> region;   // every chunk of memory handed out
+        Strategy             strategy; // where blocks go in the region
+};
+
+/**
+ *  release
+ *
+ *  clears every block at once. The region lets the backing reclaim the
+ *  pages as it empties, before the strategy writes anything into them.
+ *  A DebugPolicy reports the blocks that were still live as leaks.
+ */
+template <class Strategy, class ThreadingPolicy, class BackingStore, class StatsPolicy, class DebugPolicy>
+void BasicMemoryManager<Strategy, ThreadingPolicy, BackingStore, StatsPolicy, DebugPolicy>::release () {
+    std::lock_guard<ThreadingPolicy> guard (*this);
+
+    DebugPolicy::released();
+    strategy.release (region);
+}
+
+/**
+ *  statistics
+ *
+ *  a snapshot of the counters the StatsPolicy keeps along with the
+ *  current state of the region. Under NoStats only the memory figures
+ *  are filled in, the peak being no less than what is occupied now.
+ */
+template <class Strategy, class ThreadingPolicy, class BackingStore, class StatsPolicy, class DebugPolicy>
+Statistics BasicMemoryManager<Strategy, ThreadingPolicy, BackingStore, StatsPolicy, DebugPolicy>::statistics () {
+    std::lock_guard<ThreadingPolicy> guard (*this);
+
+    Statistics stats = {};
+    StatsPolicy::collect (stats);
+
+    stats.occupied    = region.occupied();
+    stats.total       = region.total();
+    stats.largestFree = strategy.largestFree (region);
+    if (stats.peak < stats.occupied) stats.peak = stats.occupied;
+
+    size_t free = stats.total - stats.occupied;
+    stats.fragmentation = free ? (double)stats.largestFree / free : 1.0;
+    return stats;
+}
+
+#endif /* BasicMemoryManager_hpp */
@@ -0,0 +1,493 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Benchmark.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "../MemoryManager.hpp"
+#include "../BasicMemoryManager.hpp"
+#include "../PoolStrategy.hpp"
+#include "../SlabAllocator.hpp"
+#include "../ConcurrentPool.hpp"
+#include "../Threading.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *  Benchmark
+ *
+ *  times every allocator against the system malloc in five scenarios:
+ *
+ *      alloc       allocate ops blocks of 32 bytes, then release them
+ *      pair        allocate a block and free it straight away
+ *      random      free ops blocks of 32 bytes in a shuffled order
+ *      mixed       allocate 8 to 4096 bytes and free at random, up to
+ *                  BENCH_LIVE blocks live at once
+ *      threads     the mixed scenario on every thread at once
+ *      latency     the mixed scenario with every call timed on its own
+ *
+ *  A run of a scenario times one batch of ops calls with a steady clock
+ *  and divides, so the clock costs nothing per call. Each scenario runs
+ *  warmup times untimed, then reps times, and the ns/op of the timed
+ *  runs are reported as min, p50, p90, p99 and mean. Stack and Queue
+ *  only take the scenarios that free in their order. The threads
+ *  scenario reports wall time over the calls of every thread, so it
+ *  falls as the allocator scales. The latency scenario is the worst
+ *  case rather than the usual one: it reads the clock around every
+ *  call of every timed run and reports the p50, p99, p99.99 and max of
+ *  them all, clock reads included, so a rare slow call shows up.
+ *
+ *  usage: Benchmark [--ops N] [--reps N] [--warmup N] [--threads N] [--json file]
+ *
+ *  built like the tests, from this file and every .cpp file at the top
+ *  of the repository but main.cpp.
+ */
+
+#define BENCH_SIZE  (size_t(256) << 20) // bytes each allocator preallocates
+#define BENCH_BLOCK 32                  // the size of fixed size blocks
+#define BENCH_LIVE  1024                // most blocks live at once when mixed
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    size_t      ops;     // calls per timed run
+    size_t      reps;    // timed runs per scenario
+    size_t      warmup;  // untimed runs first
+    size_t      threads; // threads in the threads scenario
+    std::string json;    // where to write the results, none when empty
+};
+
+struct Result {
+    std::string scenario;
+    std::string target;
+    double      min, p50, p90, p99, mean; // ns per call
+};
+
+struct Latency {
+    std::string target;
+    double      p50, p99, p9999, max; // ns of single calls
+};
+
+/**
+ *  Step
+ *
+ *  one call of a mixed script, an allocation of size or a free of the
+ *  live block in slot.
+ */
+struct Step {
+    bool   allocate;
+    size_t size;
+    size_t slot;
+};
+
+/**
+ *  keep
+ *
+ *  _data   a block
+ *
+ *  stops the compiler from dropping a malloc and free pair whose block
+ *  it can see is never used.
+ */
+inline void* keep (void* _data) {
+#if defined __GNUC__
+    asm volatile ("" : : "g" (_data) : "memory");
+#else
+    static void* volatile sink;
+    sink = _data;
+#endif
+    return _data;
+}
+
+/**
+ *  the allocators under test, all with the same face. Ordered says
+ *  whether blocks may be freed in any order.
+ */
+struct MallocTarget {
+    static constexpr bool Ordered = false;
+    inline void* allocate   (size_t _size) { return keep (malloc (_size)); }
+    inline void  deallocate (void* _data)  { free (_data); }
+    inline void  release    () {}
+};
+
+template <MemoryManager::Mode M, bool O>
+struct ManagerTarget {
+    static constexpr bool Ordered = O;
+    MemoryManager manager;
+
+    ManagerTarget () : manager (M, BENCH_SIZE) {}
+    inline void* allocate   (size_t _size) { return manager.allocate (_size); }
+    inline void  deallocate (void* _data)  { manager.deallocate (_data); }
+    inline void  release    () { manager.release(); }
+};
+
+typedef ManagerTarget<MemoryManager::Stack,  true>  StackTarget;
+typedef ManagerTarget<MemoryManager::Queue,  true>  QueueTarget;
+typedef ManagerTarget<MemoryManager::Pool,   false> PoolTarget;
+typedef ManagerTarget<MemoryManager::Bitmap, false> BitmapTarget;
+typedef ManagerTarget<MemoryManager::Buddy,  false> BuddyTarget;
+typedef ManagerTarget<MemoryManager::TLSF,   false> TLSFTarget;
+
+struct SlabTarget {
+    static constexpr bool Ordered = false;
+    SlabAllocator slabs;
+
+    SlabTarget () : slabs (BENCH_SIZE) {}
+    inline void* allocate   (size_t _size) { return slabs.allocate (_size); }
+    inline void  deallocate (void* _data)  { slabs.deallocate (_data); }
+    inline void  release    () { slabs.release(); }
+};
+
+struct LockedTarget {
+    static constexpr bool Ordered = false;
+    BasicMemoryManager<PoolStrategy, Locked> manager;
+
+    LockedTarget () : manager (BENCH_SIZE) {}
+    inline void* allocate   (size_t _size) { return manager.allocate (_size); }
+    inline void  deallocate (void* _data)  { manager.deallocate (_data); }
+    inline void  release    () { manager.release(); }
+};
+
+struct ConcurrentTarget {
+    static constexpr bool Ordered = false;
+    ConcurrentPool pool;
+
+    ConcurrentTarget () : pool (BENCH_SIZE) {}
+    inline void* allocate   (size_t _size) { return pool.allocate (_size); }
+    inline void  deallocate (void* _data)  { pool.deallocate (_data); }
+    inline void  release    () {}
+};
+
+/**
+ *  summarise
+ *
+ *  _scenario   what was timed
+ *  _target     what it was timed on
+ *  _samples    ns per call of every timed run
+ */
+Result summarise (const std::string& _scenario, const std::string& _target, std::vector<double> _samples) {
+    std::sort (_samples.begin(), _samples.end());
+
+    double sum = 0;
+    for (double sample : _samples) sum += sample;
+
+    size_t last = _samples.size() - 1;
+    return Result { _scenario, _target, _samples.front(),
+                    _samples[last * 50 / 100], _samples[last * 90 / 100], _samples[last * 99 / 100],
+                    sum / _samples.size() };
+}
+
+/**
+ *  measure
+ *
+ *  _options    the run counts
+ *  _calls      the calls one run makes
+ *  _run        runs once and returns the nanoseconds it took
+ *
+ *  warms up, then samples ns per call over the timed runs.
+ */
+template <class Run>
+std::vector<double> measure (const Options& _options, size_t _calls, Run _run) {
+    for (size_t i = 0; i < _options.warmup; ++i) _run();
+
+    std::vector<double> samples;
+    for (size_t i = 0; i < _options.reps; ++i) samples.push_back ((double)_run() / _calls);
+    return samples;
+}
+
+inline uint64_t since (Clock::time_point _start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count();
+}
+
+/**
+ *  mixedScript
+ *
+ *  _calls  the number of steps
+ *  _seed   so every target and thread gets a script of its own, but the
+ *          same one on every run
+ *
+ *  a random walk of allocations of 8 to 4096 bytes, log uniform, and
+ *  frees of random live blocks, keeping at most BENCH_LIVE live.
+ */
+std::vector<Step> mixedScript (size_t _calls, unsigned _seed) {
+    std::mt19937 random (_seed);
+    std::vector<Step> script;
+    size_t live = 0;
+
+    for (size_t i = 0; i < _calls; ++i) {
+        if (live == 0 || (live < BENCH_LIVE && random() % 2 == 0)) {
+            script.push_back (Step { true, (size_t)8 << (random() % 9), live });
+            script.back().size += random() % script.back().size;
+            ++live;
+        } else {
+            script.push_back (Step { false, 0, random() % live });
+            --live;
+        }
+    }
+    return script;
+}
+
+/**
+ *  playScript
+ *
+ *  _target the allocator
+ *  _script steps from mixedScript
+ *  _live   room for BENCH_LIVE blocks
+ *
+ *  runs a script, freed slots being filled from the end so live blocks
+ *  stay packed. frees whatever is left afterwards, untimed.
+ */
+template <class Target>
+uint64_t playScript (Target& _target, const std::vector<Step>& _script, std::vector<void*>& _live) {
+    size_t live = 0;
+
+    Clock::time_point start = Clock::now();
+    for (const Step& step : _script) {
+        if (step.allocate) _live[live++] = _target.allocate (step.size);
+        else {
+            _target.deallocate (_live[step.slot]);
+            _live[step.slot] = _live[--live];
+        }
+    }
+    uint64_t elapsed = since (start);
+
+    while (live > 0) _target.deallocate (_live[--live]);
+    return elapsed;
+}
+
+/**
+ *  benchmark
+ *
+ *  _name       the target's name in the results
+ *  _options    the run counts
+ *  _results    where the results go
+ *
+ *  runs the single threaded scenarios a target can take.
+ */
+template <class Target>
+void benchmark (const std::string& _name, const Options& _options, std::vector<Result>& _results) {
+    Target target;
+    std::vector<void*> blocks (_options.ops);
+
+    _results.push_back (summarise ("alloc", _name, measure (_options, _options.ops, [&] () {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < _options.ops; ++i) blocks[i] = target.allocate (BENCH_BLOCK);
+        uint64_t elapsed = since (start);
+
+        for (size_t i = _options.ops; i > 0; --i) target.deallocate (blocks[i - 1]);
+        target.release();
+        return elapsed;
+    })));
+
+    _results.push_back (summarise ("pair", _name, measure (_options, 2 * _options.ops, [&] () {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < _options.ops; ++i) target.deallocate (target.allocate (BENCH_BLOCK));
+        return since (start);
+    })));
+
+    if (Target::Ordered) return;
+
+    std::vector<size_t> order (_options.ops);
+    for (size_t i = 0; i < _options.ops; ++i) order[i] = i;
+    std::shuffle (order.begin(), order.end(), std::mt19937 (1));
+
+    _results.push_back (summarise ("random", _name, measure (_options, _options.ops, [&] () {
+        for (size_t i = 0; i < _options.ops; ++i) blocks[i] = target.allocate (BENCH_BLOCK);
+
+        Clock::time_point start = Clock::now();
+        for (size_t i : order) target.deallocate (blocks[i]);
+        return since (start);
+    })));
+
+    std::vector<Step>  script = mixedScript (_options.ops, 2);
+    std::vector<void*> live (BENCH_LIVE);
+    _results.push_back (summarise ("mixed", _name, measure (_options, _options.ops, [&] () {
+        return playScript (target, script, live);
+    })));
+}
+
+/**
+ *  benchmarkThreads
+ *
+ *  _name       the target's name in the results
+ *  _options    the run counts
+ *  _results    where the results go
+ *
+ *  runs a mixed script on every thread at once, from a common start.
+ */
+template <class Target>
+void benchmarkThreads (const std::string& _name, const Options& _options, std::vector<Result>& _results) {
+    Target target;
+
+    std::vector<std::vector<Step>> scripts;
+    for (size_t t = 0; t < _options.threads; ++t) scripts.push_back (mixedScript (_options.ops, 3 + t));
+
+    _results.push_back (summarise ("threads", _name, measure (_options, _options.threads * _options.ops, [&] () {
+        std::atomic<size_t> ready (0);
+        std::atomic<bool>   go (false);
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < _options.threads; ++t) {
+            workers.emplace_back ([&, t] () {
+                std::vector<void*> live (BENCH_LIVE);
+                ready.fetch_add (1);
+                while (!go.load()) std::this_thread::yield();
+                playScript (target, scripts[t], live);
+            });
+        }
+
+        while (ready.load() < _options.threads) std::this_thread::yield();
+        Clock::time_point start = Clock::now();
+        go.store (true);
+        for (std::thread& worker : workers) worker.join();
+        return since (start);
+    })));
+}
+
+/**
+ *  benchmarkLatency
+ *
+ *  _name       the target's name in the results
+ *  _options    the run counts
+ *  _latencies  where the results go
+ *
+ *  plays a mixed script timing every call on its own, and keeps the
+ *  time of every call of the timed runs for the tail of the spread.
+ */
+template <class Target>
+void benchmarkLatency (const std::string& _name, const Options& _options, std::vector<Latency>& _latencies) {
+    Target target;
+    std::vector<Step>     script = mixedScript (_options.ops, 4);
+    std::vector<void*>    live (BENCH_LIVE);
+    std::vector<uint64_t> samples;
+    samples.reserve (_options.reps * _options.ops);
+
+    for (size_t run = 0; run < _options.warmup + _options.reps; ++run) {
+        size_t count = 0;
+        for (const Step& step : script) {
+            Clock::time_point start = Clock::now();
+            if (step.allocate) live[count++] = target.allocate (step.size);
+            else target.deallocate (live[step.slot]);
+            uint64_t elapsed = since (start);
+
+            if (!step.allocate) live[step.slot] = live[--count];
+            if (run >= _options.warmup) samples.push_back (elapsed);
+        }
+        while (count > 0) target.deallocate (live[--count]);
+    }
+
+    std::sort (samples.begin(), samples.end());
+    size_t last = samples.size() - 1;
+    _latencies.push_back (Latency { _name, (double)samples[last * 50 / 100], (double)samples[last * 99 / 100],
+                                    (double)samples[last * 9999 / 10000], (double)samples[last] });
+}
+
+/**
+ *  writeJson
+ *
+ *  _options    the run counts
+ *  _results    every result
+ *  _latencies  every latency result
+ *
+ *  writes the results where --json asked, one object per result.
+ */
+bool writeJson (const Options& _options, const std::vector<Result>& _results, const std::vector<Latency>& _latencies) {
+    std::ofstream out (_options.json);
+    if (!out) return false;
+
+    out << "{\"ops\":" << _options.ops << ",\"reps\":" << _options.reps
+        << ",\"warmup\":" << _options.warmup << ",\"threads\":" << _options.threads
+        << ",\"unit\":\"ns/op\",\"results\":[";
+
+    for (size_t i = 0; i < _results.size(); ++i) {
+        const Result& r = _results[i];
+        out << (i ? "," : "") << "{\"scenario\":\"" << r.scenario << "\",\"target\":\"" << r.target
+            << "\",\"min\":" << r.min << ",\"p50\":" << r.p50 << ",\"p90\":" << r.p90
+            << ",\"p99\":" << r.p99 << ",\"mean\":" << r.mean << "}";
+    }
+    out << "],\"latency\":[";
+
+    for (size_t i = 0; i < _latencies.size(); ++i) {
+        const Latency& l = _latencies[i];
+        out << (i ? "," : "") << "{\"target\":\"" << l.target << "\",\"p50\":" << l.p50
+            << ",\"p99\":" << l.p99 << ",\"p9999\":" << l.p9999 << ",\"max\":" << l.max << "}";
+    }
+    out << "]}" << std::endl;
+    return (bool)out;
+}
+
+int main (int argc, const char * argv[]) {
+    Options options = { 10000, 30, 5, std::max (2u, std::thread::hardware_concurrency()), "" };
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if      (!strcmp (argv[i], "--ops"))     options.ops     = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--reps"))    options.reps    = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--warmup"))  options.warmup  = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--threads")) options.threads = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--json"))    options.json    = argv[i + 1];
+        else {
+            std::cout << "usage: " << argv[0] << " [--ops N] [--reps N] [--warmup N] [--threads N] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.ops == 0 || options.reps == 0 || options.threads == 0) {
+        std::cout << "ERROR: ops, reps and threads must be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    benchmark<MallocTarget> ("malloc", options, results);
+    benchmark<StackTarget>  ("Stack",  options, results);
+    benchmark<QueueTarget>  ("Queue",  options, results);
+    benchmark<PoolTarget>   ("Pool",   options, results);
+    benchmark<BitmapTarget> ("Bitmap", options, results);
+    benchmark<BuddyTarget>  ("Buddy",  options, results);
+    benchmark<TLSFTarget>   ("TLSF",   options, results);
+    benchmark<SlabTarget>   ("Slab",   options, results);
+
+    benchmarkThreads<MallocTarget>     ("malloc",     options, results);
+    benchmarkThreads<LockedTarget>     ("Locked",     options, results);
+    benchmarkThreads<ConcurrentTarget> ("Concurrent", options, results);
+
+    std::vector<Latency> latencies;
+    benchmarkLatency<MallocTarget> ("malloc", options, latencies);
+    benchmarkLatency<PoolTarget>   ("Pool",   options, latencies);
+    benchmarkLatency<BitmapTarget> ("Bitmap", options, latencies);
+    benchmarkLatency<BuddyTarget>  ("Buddy",  options, latencies);
+    benchmarkLatency<TLSFTarget>   ("TLSF",   options, latencies);
+    benchmarkLatency<SlabTarget>   ("Slab",   options, latencies);
+
+    std::cout << std::endl << std::left << std::setw (10) << "scenario" << std::setw (12) << "target" << std::right
+              << std::setw (10) << "min" << std::setw (10) << "p50" << std::setw (10) << "p90"
+              << std::setw (10) << "p99" << std::setw (10) << "mean" << "  ns/op" << std::endl;
+    std::cout << std::fixed << std::setprecision (1);
+    for (const Result& r : results) {
+        std::cout << std::left << std::setw (10) << r.scenario << std::setw (12) << r.target << std::right
+                  << std::setw (10) << r.min << std::setw (10) << r.p50 << std::setw (10) << r.p90
+                  << std::setw (10) << r.p99 << std::setw (10) << r.mean << std::endl;
+    }
+
+    std::cout << std::endl << std::left << std::setw (10) << "latency" << std::setw (12) << "target" << std::right
+              << std::setw (10) << "p50" << std::setw (10) << "p99" << std::setw (10) << "p99.99"
+              << std::setw (10) << "max" << "  ns" << std::endl;
+    for (const Latency& l : latencies) {
+        std::cout << std::left << std::setw (10) << "" << std::setw (12) << l.target << std::right
+                  << std::setw (10) << l.p50 << std::setw (10) << l.p99 << std::setw (10) << l.p9999
+                  << std::setw (10) << l.max << std::endl;
+    }
+
+    if (!options.json.empty() && !writeJson (options, results, latencies)) {
+        std::cout << "ERROR: cannot write " << options.json << std::endl;
+        return 1;
+    }
+    return 0;
+}
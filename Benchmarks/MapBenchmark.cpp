@@ -0,0 +1,194 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  MapBenchmark.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "../GlobalHeap.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *  MapBenchmark
+ *
+ *  times a whole program's worth of operator new and delete, with or
+ *  without the GlobalHeap, in three scenarios:
+ *
+ *      build       insert ops random keys into a std::map, each holding
+ *                  a string of 0 to MAP_VALUE bytes, so a node and most
+ *                  strings are an allocation each
+ *      teardown    destroy that map
+ *      threads     build and tear down on every thread at once
+ *
+ *  Nothing calls an allocator directly; the program is the same both
+ *  ways and only the link changes. Build it twice, once as is and once
+ *  with MEMORY_MANAGER_GLOBAL, and compare the two tables. Each scenario
+ *  runs warmup times untimed, then reps times, and the ns per node of
+ *  the timed runs are reported as min, p50, p90 and mean. The threads
+ *  scenario reports wall time over the nodes of every thread.
+ *
+ *  usage: MapBenchmark [--ops N] [--reps N] [--warmup N] [--threads N]
+ *
+ *  built like Benchmark, from this file and every .cpp file at the top
+ *  of the repository but main.cpp.
+ */
+
+#define MAP_VALUE 64 // the longest string a node holds
+
+typedef std::chrono::steady_clock Clock;
+typedef std::map<uint64_t, std::string> Tree;
+
+struct Options {
+    size_t ops;     // nodes per map
+    size_t reps;    // timed runs per scenario
+    size_t warmup;  // untimed runs first
+    size_t threads; // threads in the threads scenario
+};
+
+struct Result {
+    std::string scenario;
+    double      min, p50, p90, mean; // ns per node
+};
+
+inline uint64_t since (Clock::time_point _start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count();
+}
+
+/**
+ *  build
+ *
+ *  _tree   an empty map
+ *  _ops    the nodes to insert
+ *  _seed   so every thread gets keys of its own, but the same each run
+ *
+ *  fills _tree, a key seen twice only replacing the string.
+ */
+void build (Tree& _tree, size_t _ops, unsigned _seed) {
+    std::mt19937_64 random (_seed);
+    for (size_t i = 0; i < _ops; ++i) {
+        uint64_t key = random();
+        _tree[key].assign (key % (MAP_VALUE + 1), 'x');
+    }
+}
+
+/**
+ *  summarise
+ *
+ *  _scenario   what was timed
+ *  _samples    ns per node of every timed run
+ */
+Result summarise (const std::string& _scenario, std::vector<double> _samples) {
+    std::sort (_samples.begin(), _samples.end());
+
+    double sum = 0;
+    for (double sample : _samples) sum += sample;
+
+    size_t last = _samples.size() - 1;
+    return Result { _scenario, _samples.front(), _samples[last * 50 / 100], _samples[last * 90 / 100],
+                    sum / _samples.size() };
+}
+
+/**
+ *  measure
+ *
+ *  _options    the run counts
+ *  _nodes      the nodes one run makes
+ *  _run        runs once and returns the nanoseconds it took
+ *
+ *  warms up, then samples ns per node over the timed runs.
+ */
+template <class Run>
+std::vector<double> measure (const Options& _options, size_t _nodes, Run _run) {
+    for (size_t i = 0; i < _options.warmup; ++i) _run();
+
+    std::vector<double> samples;
+    for (size_t i = 0; i < _options.reps; ++i) samples.push_back ((double)_run() / _nodes);
+    return samples;
+}
+
+int main (int argc, const char * argv[]) {
+    Options options = { 100000, 20, 3, std::max (2u, std::thread::hardware_concurrency()) };
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if      (!strcmp (argv[i], "--ops"))     options.ops     = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--reps"))    options.reps    = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--warmup"))  options.warmup  = std::strtoull (argv[i + 1], nullptr, 10);
+        else if (!strcmp (argv[i], "--threads")) options.threads = std::strtoull (argv[i + 1], nullptr, 10);
+        else {
+            std::cout << "usage: " << argv[0] << " [--ops N] [--reps N] [--warmup N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.ops == 0 || options.reps == 0 || options.threads == 0) {
+        std::cout << "ERROR: ops, reps and threads must be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+
+    // build and teardown share runs, each timing its own half
+    std::vector<double> builds, teardowns;
+    for (size_t run = 0; run < options.warmup + options.reps; ++run) {
+        Tree* tree = new Tree;
+
+        Clock::time_point start = Clock::now();
+        build (*tree, options.ops, 1);
+        uint64_t built = since (start);
+
+        start = Clock::now();
+        delete tree;
+        uint64_t destroyed = since (start);
+
+        if (run < options.warmup) continue;
+        builds.push_back ((double)built / options.ops);
+        teardowns.push_back ((double)destroyed / options.ops);
+    }
+    results.push_back (summarise ("build",    builds));
+    results.push_back (summarise ("teardown", teardowns));
+
+    results.push_back (summarise ("threads", measure (options, options.threads * options.ops, [&] () {
+        std::atomic<size_t> ready (0);
+        std::atomic<bool>   go (false);
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < options.threads; ++t) {
+            workers.emplace_back ([&, t] () {
+                ready.fetch_add (1);
+                while (!go.load()) std::this_thread::yield();
+
+                Tree tree;
+                build (tree, options.ops, 2 + t);
+            });
+        }
+
+        while (ready.load() < options.threads) std::this_thread::yield();
+        Clock::time_point start = Clock::now();
+        go.store (true);
+        for (std::thread& worker : workers) worker.join();
+        return since (start);
+    })));
+
+#ifdef MEMORY_MANAGER_GLOBAL
+    std::cout << std::endl << "operator new: GlobalHeap, " << GlobalHeap::occupiedMemory() << " bytes of pages held" << std::endl;
+#else
+    std::cout << std::endl << "operator new: system" << std::endl;
+#endif
+    std::cout << std::left << std::setw (10) << "scenario" << std::right << std::setw (10) << "min"
+              << std::setw (10) << "p50" << std::setw (10) << "p90" << std::setw (10) << "mean" << "  ns/node" << std::endl;
+    std::cout << std::fixed << std::setprecision (1);
+    for (const Result& r : results) {
+        std::cout << std::left << std::setw (10) << r.scenario << std::right << std::setw (10) << r.min
+                  << std::setw (10) << r.p50 << std::setw (10) << r.p90 << std::setw (10) << r.mean << std::endl;
+    }
+    return 0;
+}
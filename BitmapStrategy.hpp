@@ -0,0 +1,355 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BitmapStrategy.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BitmapStrategy_hpp
+#define BitmapStrategy_hpp
+
+#include "BytePointer.hpp"
+#include "Bits.hpp"
+#include "Sanitizer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#define BITMAP_GRANULE alignof(std::max_align_t) // blocks are whole granules, so every one is aligned
+#define BITMAP_WORD    64                        // granules per bitmap word
+
+/**
+ *  BitmapStrategy
+ *
+ *  variable size blocks freed in any order, with no metadata outside
+ *  the region. Every chunk starts with two bitmaps of one bit per
+ *  granule: one marks the granules in use, the other the first granule
+ *  of every block, so a block ends at the next first granule or the
+ *  next free one. That is two bits per granule and nothing per block,
+ *  no allocation ever reaches the global heap, and the occupied memory
+ *  is exactly the granules in use. Placing a block is first fit over
+ *  the free runs, a 64 granule word at a time. Alignment padding is
+ *  left free rather than counted as used.
+ */
+class BitmapStrategy {
+    public:
+        template <class Region>
+        explicit BitmapStrategy (Region& _region) : lowest (0), steps (0), failedSize (size_t(-1)), failedAlignment (0) {
+            format (_region.chunk (0));
+        }
+
+        /** return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocate (Region& _region, size_t _size, size_t _alignment) {
+            // every block needs an address of its own, even an empty one
+            if (_size == 0) _size = 1;
+            if (_size > size_t(-1) / 2) return nullptr;
+
+            // nothing has been freed since a block this size and alignment failed
+            if (_size >= failedSize && _alignment >= failedAlignment) return nullptr;
+
+            size_t count = (_size + BITMAP_GRANULE - 1) / BITMAP_GRANULE;
+            steps = 0;
+
+            BytePointer block = take (_region.chunk (0), count, _alignment, lowest);
+            if (block != nullptr) return place (_region, _region.chunk (0), block, count, _size);
+
+            for (size_t i = 1; i < _region.count(); ++i) {
+                size_t from = 0;
+                if ((block = take (_region.chunk (i), count, _alignment, from))) return place (_region, _region.chunk (i), block, count, _size);
+            }
+
+            size_t from  = 0;
+            auto   chunk = grow (_region, count, _alignment);
+            block = (chunk != nullptr) ? take (chunk, count, _alignment, from) : nullptr;
+            if (block == nullptr) {
+                failedSize      = _size;
+                failedAlignment = _alignment;
+                return nullptr;
+            }
+            return place (_region, chunk, block, count, _size);
+        }
+
+        /** return false when _data is not a live block */
+        template <class Region>
+        inline bool deallocate (Region& _region, void* _data) {
+            auto   chunk = _region.chunkOf (_data);
+            Layout map   = layout (chunk);
+
+            size_t first;
+            if (!live (map, (BytePointer)_data, first)) return false;
+
+            // the block runs up to the next free granule or the next block before it
+            size_t end = findClear (map.used, first + 1, map.granules);
+            end = findSet (map.starts, first + 1, end);
+
+            map.starts[first / BITMAP_WORD] &= ~(uint64_t(1) << (first % BITMAP_WORD));
+            clearRange (map.used, first, end);
+
+            _region.vacate ((end - first) * BITMAP_GRANULE);
+            _region.freed (_data, (end - first) * BITMAP_GRANULE);
+            failedSize = size_t(-1);
+            if (chunk->index == 0) lowest = std::min (lowest, first);
+
+            if (_region.leave (chunk)) _region.drop (chunk);
+            return true;
+        }
+
+        /** all or nothing, return false on fail */
+        template <class Region>
+        bool allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out) {
+            for (size_t i = 0; i < _count; ++i) {
+                if ((_out[i] = allocate (_region, _size, _alignment)) == nullptr) {
+                    while (i > 0) deallocate (_region, _out[--i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** returns the number freed, moved to the front of _data */
+        template <class Region>
+        size_t deallocateBatch (Region& _region, void** _data, size_t _count) {
+            size_t freed = 0;
+            for (size_t i = 0; i < _count; ++i) {
+                if (deallocate (_region, _data[i])) std::swap (_data[i], _data[freed++]);
+            }
+            return freed;
+        }
+
+        template <class Region>
+        void release (Region& _region) {
+            _region.reset();
+            for (size_t i = 0; i < _region.count(); ++i) format (_region.chunk (i));
+            lowest     = 0;
+            failedSize = size_t(-1);
+        }
+
+        template <class Region>
+        inline bool freeable (Region& _region, void* _data) const {
+            size_t first;
+            return live (layout (_region.chunkOf (_data)), (BytePointer)_data, first);
+        }
+
+        /** the biggest block that fits without growing */
+        template <class Region>
+        size_t largestFree (const Region& _region) const;
+
+        /** free runs looked at by the last allocate */
+        inline size_t searchLength () const { return steps; }
+
+    private:
+        struct Layout {
+            uint64_t*   used;     // a bit per granule in use
+            uint64_t*   starts;   // a bit per first granule of a block
+            BytePointer base;     // the first granule
+            size_t      granules; // granules in the chunk
+        };
+
+        /** where the bitmaps and granules of _chunk are, worked out from its size alone */
+        template <class Chunk>
+        static inline Layout layout (const Chunk* _chunk) {
+            // each word's worth of granules costs its own bytes and a word in each bitmap
+            size_t granules = _chunk->size / (BITMAP_WORD * BITMAP_GRANULE + 2 * sizeof(uint64_t)) * BITMAP_WORD;
+            size_t rest     = _chunk->size - metadata (granules) - granules * BITMAP_GRANULE;
+            size_t words    = metadata (granules + 1) - metadata (granules);
+            if (rest >= words + BITMAP_GRANULE) granules += std::min ((rest - words) / BITMAP_GRANULE, (size_t)BITMAP_WORD - 1);
+
+            Layout map;
+            map.used     = (uint64_t*)_chunk->begin;
+            map.starts   = map.used + (granules + BITMAP_WORD - 1) / BITMAP_WORD;
+            map.base     = _chunk->begin + metadata (granules);
+            map.granules = granules;
+            return map;
+        }
+
+        /** the bytes in front of the granules, kept to a whole granule */
+        static inline size_t metadata (size_t _granules) {
+            size_t bytes = 2 * sizeof(uint64_t) * ((_granules + BITMAP_WORD - 1) / BITMAP_WORD);
+            return (bytes + BITMAP_GRANULE - 1) & ~(size_t)(BITMAP_GRANULE - 1);
+        }
+
+        /** whether _data is the first granule of a block, setting _first to its index */
+        static inline bool live (const Layout& _map, BytePointer _data, size_t& _first) {
+            if (_data < _map.base || (size_t)(_data - _map.base) % BITMAP_GRANULE != 0) return false;
+
+            _first = (_data - _map.base) / BITMAP_GRANULE;
+            return _first < _map.granules && (_map.starts[_first / BITMAP_WORD] >> (_first % BITMAP_WORD)) & 1;
+        }
+
+        /** the first bit at or after _from that is clear, or _end */
+        static inline size_t findClear (const uint64_t* _words, size_t _from, size_t _end) {
+            if (_from >= _end) return _end;
+
+            size_t   w    = _from / BITMAP_WORD;
+            uint64_t bits = ~_words[w] & (~uint64_t(0) << (_from % BITMAP_WORD));
+            while (bits == 0) {
+                if (++w * BITMAP_WORD >= _end) return _end;
+                bits = ~_words[w];
+            }
+            return std::min (w * BITMAP_WORD + lowestBit (bits), _end);
+        }
+
+        /** the first bit at or after _from that is set, or _end */
+        static inline size_t findSet (const uint64_t* _words, size_t _from, size_t _end) {
+            if (_from >= _end) return _end;
+
+            size_t   w    = _from / BITMAP_WORD;
+            uint64_t bits = _words[w] & (~uint64_t(0) << (_from % BITMAP_WORD));
+            while (bits == 0) {
+                if (++w * BITMAP_WORD >= _end) return _end;
+                bits = _words[w];
+            }
+            return std::min (w * BITMAP_WORD + lowestBit (bits), _end);
+        }
+
+        static void setRange   (uint64_t* _words, size_t _begin, size_t _end);
+        static void clearRange (uint64_t* _words, size_t _begin, size_t _end);
+
+        template <class Chunk>
+        BytePointer take (Chunk* _chunk, size_t _count, size_t _alignment, size_t& _lowest);
+
+        template <class Region>
+        inline BytePointer place (Region& _region, typename Region::Chunk* _chunk, BytePointer _block, size_t _count, size_t _size) {
+            _region.enter (_chunk);
+            _region.occupy (_count * BITMAP_GRANULE);
+            _region.allocated (_block, _size);
+            return _block;
+        }
+
+        template <class Region>
+        typename Region::Chunk* grow (Region& _region, size_t _count, size_t _alignment);
+
+        template <class Chunk>
+        static void format (Chunk* _chunk) {
+            Layout map = layout (_chunk);
+            sanitizerUnpoison (map.used, map.base - (BytePointer)map.used);
+            std::memset (map.used, 0, map.base - (BytePointer)map.used);
+        }
+
+        size_t lowest;          // every granule of the first chunk below this is in use
+        size_t steps;           // free runs looked at by the last allocate
+        size_t failedSize;      // the last request to fail since a block was freed
+        size_t failedAlignment; // and its alignment
+};
+
+/**
+ *  largestFree
+ *
+ *  _region the region the bitmaps are in
+ *
+ *  The longest free run of any chunk, walking every bitmap.
+ */
+template <class Region>
+size_t BitmapStrategy::largestFree (const Region& _region) const {
+    size_t largest = 0;
+    for (size_t i = 0; i < _region.count(); ++i) {
+        Layout map = layout (_region.chunk (i));
+        for (size_t from = findClear (map.used, 0, map.granules); from < map.granules; ) {
+            size_t end = findSet (map.used, from, map.granules);
+            largest    = std::max (largest, end - from);
+            from       = findClear (map.used, end, map.granules);
+        }
+    }
+    return largest * BITMAP_GRANULE;
+}
+
+/**
+ *  take
+ *
+ *  _chunk      the chunk to look in
+ *  _count      the granules the block needs
+ *  _alignment  the power of two the address must be a multiple of
+ *  _lowest     no granule below it is free, moved up to the first free one
+ *
+ *  Walks the free runs of the chunk in address order and marks the
+ *  first one the block fits once aligned. A run is only read as far as
+ *  the block would reach. returns a null pointer when none does.
+ */
+template <class Chunk>
+BytePointer BitmapStrategy::take (Chunk* _chunk, size_t _count, size_t _alignment, size_t& _lowest) {
+    Layout map = layout (_chunk);
+    if (_count > map.granules) return nullptr;
+
+    _lowest = findClear (map.used, _lowest, map.granules);
+    for (size_t from = _lowest; from < map.granules; ) {
+        size_t first = from + alignmentPadding (map.base + from * BITMAP_GRANULE, _alignment) / BITMAP_GRANULE;
+        if (first + _count > map.granules) break;
+        ++steps;
+
+        // only as far as the block reaches, the rest of a long run is never read
+        size_t end = findSet (map.used, from, first + _count);
+        if (end == first + _count) {
+            if (first == _lowest) _lowest = end;
+            setRange (map.used, first, end);
+            map.starts[first / BITMAP_WORD] |= uint64_t(1) << (first % BITMAP_WORD);
+            return map.base + first * BITMAP_GRANULE;
+        }
+        from = findClear (map.used, end, map.granules);
+    }
+    return nullptr;
+}
+
+/**
+ *  grow
+ *
+ *  _region     the region to grow
+ *  _count      the granules the block needs
+ *  _alignment  the power of two the address must be a multiple of
+ *
+ *  Chains a chunk with room for the block, its alignment and the
+ *  bitmaps in front, then clears the bitmaps. returns a null pointer
+ *  when the region cannot grow.
+ */
+template <class Region>
+typename Region::Chunk* BitmapStrategy::grow (Region& _region, size_t _count, size_t _alignment) {
+    if (_count > (size_t(-1) / 4 - _alignment) / BITMAP_GRANULE) return nullptr;
+
+    size_t granules = _count + (_alignment + BITMAP_GRANULE - 1) / BITMAP_GRANULE;
+    auto   chunk    = _region.grow (granules * BITMAP_GRANULE + metadata (granules) + BITMAP_GRANULE);
+    if (chunk != nullptr) format (chunk);
+    return chunk;
+}
+
+/**
+ *  setRange
+ *
+ *  _words  the bitmap
+ *  _begin  the first bit to set
+ *  _end    one past the last
+ *
+ *  Sets a run of bits a word at a time.
+ */
+inline void BitmapStrategy::setRange (uint64_t* _words, size_t _begin, size_t _end) {
+    for (size_t i = _begin; i < _end; ) {
+        size_t   bit  = i % BITMAP_WORD;
+        size_t   bits = std::min (BITMAP_WORD - bit, _end - i);
+        uint64_t mask = (bits == BITMAP_WORD) ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1) << bit;
+
+        _words[i / BITMAP_WORD] |= mask;
+        i += bits;
+    }
+}
+
+/**
+ *  clearRange
+ *
+ *  _words  the bitmap
+ *  _begin  the first bit to clear
+ *  _end    one past the last
+ *
+ *  Clears a run of bits a word at a time.
+ */
+inline void BitmapStrategy::clearRange (uint64_t* _words, size_t _begin, size_t _end) {
+    for (size_t i = _begin; i < _end; ) {
+        size_t   bit  = i % BITMAP_WORD;
+        size_t   bits = std::min (BITMAP_WORD - bit, _end - i);
+        uint64_t mask = (bits == BITMAP_WORD) ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1) << bit;
+
+        _words[i / BITMAP_WORD] &= ~mask;
+        i += bits;
+    }
+}
+
+#endif /* BitmapStrategy_hpp */
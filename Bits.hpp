@@ -0,0 +1,33 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Bits.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Bits_hpp
+#define Bits_hpp
+
+#include <cstdint>
+
+/** the index of the lowest set bit, _bits must not be zero */
+inline unsigned lowestBit (uint64_t _bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll (_bits);
+#else
+    unsigned index = 0;
+    while (!(_bits & 1)) _bits >>= 1, ++index;
+    return index;
+#endif
+}
+
+/** the index of the highest set bit, _bits must not be zero */
+inline unsigned highestBit (uint64_t _bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - (unsigned)__builtin_clzll (_bits);
+#else
+    unsigned index = 0;
+    while (_bits >>= 1) ++index;
+    return index;
+#endif
+}
+
+#endif /* Bits_hpp */
@@ -0,0 +1,124 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BlockTable.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "BlockTable.hpp"
+
+#include <algorithm>
+
+#define BLOCK_TABLE_MIN_SHIFT 6 // start with 64 slots
+
+/**
+ *  BlockTable Constructor
+ *
+ *  Constructs an empty table.
+ */
+BlockTable::BlockTable ()
+    : slots (size_t(1) << BLOCK_TABLE_MIN_SHIFT, Entry { nullptr, 0, 0 }),
+      entries (0), shift (64 - BLOCK_TABLE_MIN_SHIFT) {}
+
+/**
+ *  insert
+ *
+ *  _data       the address of the block
+ *  _size       the size of the block
+ *  _padding    the alignment padding in front of the block
+ *
+ *  Records a live block. Fails when a block at _data is already live.
+ */
+bool BlockTable::insert (BytePointer _data, size_t _size, size_t _padding) {
+    if ((entries + 1) * 2 > slots.size()) grow();
+
+    size_t mask = slots.size() - 1;
+    size_t i = slot (_data);
+    while (slots[i].data != nullptr) {
+        if (slots[i].data == _data) return false;
+        i = (i + 1) & mask;
+    }
+
+    slots[i].data    = _data;
+    slots[i].size    = _size;
+    slots[i].padding = _padding;
+    ++entries;
+    return true;
+}
+
+/**
+ *  remove
+ *
+ *  _data       the address of the block
+ *  _size       set to the size of the block on success
+ *  _padding    set to the padding in front of the block on success
+ *
+ *  Forgets a live block, shifting the rest of its probe run back so no
+ *  tombstones are left behind. Fails when no block lives at _data,
+ *  null included, which would match the first empty slot.
+ */
+bool BlockTable::remove (BytePointer _data, size_t& _size, size_t& _padding) {
+    if (_data == nullptr) return false;
+
+    size_t mask = slots.size() - 1;
+    size_t i = slot (_data);
+    while (slots[i].data != _data) {
+        if (slots[i].data == nullptr) return false;
+        i = (i + 1) & mask;
+    }
+    _size    = slots[i].size;
+    _padding = slots[i].padding;
+
+    // pull later entries of the run into the hole if they may live there
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; slots[j].data != nullptr; j = (j + 1) & mask) {
+        size_t home = slot (slots[j].data);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            slots[hole] = slots[j];
+            hole = j;
+        }
+    }
+    slots[hole] = Entry { nullptr, 0, 0 };
+
+    --entries;
+    return true;
+}
+
+/**
+ *  contains
+ *
+ *  _data   the address of the block
+ *
+ *  Whether a block at _data is live. Null never is.
+ */
+bool BlockTable::contains (BytePointer _data) const {
+    if (_data == nullptr) return false;
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = slot (_data); slots[i].data != nullptr; i = (i + 1) & mask) {
+        if (slots[i].data == _data) return true;
+    }
+    return false;
+}
+
+/**
+ *  clear
+ *
+ *  forgets every block, keeping the slots for reuse
+ */
+void BlockTable::clear () {
+    std::fill (slots.begin(), slots.end(), Entry { nullptr, 0, 0 });
+    entries = 0;
+}
+
+/**
+ *  grow
+ *
+ *  doubles the slot count and rehashes every live block
+ */
+void BlockTable::grow () {
+    std::vector<Entry> old (slots.size() * 2, Entry { nullptr, 0, 0 });
+    old.swap (slots);
+    --shift;
+    entries = 0;
+
+    for (const Entry& e : old) if (e.data != nullptr) insert (e.data, e.size, e.padding);
+}
@@ -0,0 +1,56 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BlockTable.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BlockTable_hpp
+#define BlockTable_hpp
+
+#include "BytePointer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  BlockTable
+ *
+ *  The live blocks of a pool, keyed by address, with the size of each
+ *  block and of the alignment padding in front of it. An open addressed hash
+ *  table with linear probing, so lookups are O(1) and adding a block
+ *  never allocates a node of its own; the slot array only grows when
+ *  the table gets more than half full.
+ */
+class BlockTable {
+    public:
+        BlockTable ();
+
+        /** return false on fail */
+        bool insert (BytePointer _data, size_t _size, size_t _padding = 0);
+        bool remove (BytePointer _data, size_t& _size, size_t& _padding);
+        void clear  ();
+
+        bool contains (BytePointer _data) const;
+
+        inline size_t count () const { return entries; }
+
+    private:
+        struct Entry {
+            BytePointer data;    // the address handed out, null when empty
+            size_t      size;    // the size of the block
+            size_t      padding; // bytes skipped in front of it to align it
+        };
+
+        inline size_t slot (BytePointer _data) const {
+            uint64_t key = (uint64_t)(uintptr_t)_data;
+            return (size_t)((key * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        void grow ();
+
+        std::vector<Entry> slots;  // empty slots have a null data pointer
+        size_t            entries; // the number of live blocks
+        unsigned          shift;   // 64 - log2 of the slot count
+};
+
+#endif /* BlockTable_hpp */
@@ -0,0 +1,353 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BuddyStrategy.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BuddyStrategy_hpp
+#define BuddyStrategy_hpp
+
+#include "BytePointer.hpp"
+#include "Bits.hpp"
+#include "Sanitizer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#define BUDDY_MIN_ORDER 4  // the smallest block, 16 bytes, holds a free list link
+#define BUDDY_LINE      64 // the blocks of a chunk start on a cache line at least
+#define BUDDY_SLACK     32 // and on a power of two up to this fraction of the chunk
+
+/**
+ *  BuddyStrategy
+ *
+ *  power of two blocks split from and merged back into the chunks of
+ *  the region. A request is rounded up to the next power of two, taken
+ *  from the free list of the smallest order that has a block and split
+ *  in halves down to size. A freed block merges with its buddy, the
+ *  other half of the block it was split from, for as long as the buddy
+ *  is free too, so free space never stays broken up into halves that
+ *  could be whole. Both are O(log size). Each chunk keeps its free list
+ *  heads and two bit trees, one marking split blocks and one free
+ *  blocks, at its end; the links of the lists live in the free blocks.
+ *  A chunk that is not a power of two is carved into the biggest blocks
+ *  that fit. The rounding counts as used, so no block wastes more than
+ *  it holds. Blocks are aligned to their size up to the alignment of
+ *  the first block of the chunk, the biggest power of two up to a
+ *  thirty-second of the chunk and a cache line at least. A bigger
+ *  alignment grows a chunk whose first block is aligned to it.
+ */
+class BuddyStrategy {
+    public:
+        template <class Region>
+        explicit BuddyStrategy (Region& _region) : steps (0) { format (_region.chunk (0)); }
+
+        /** return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocate (Region& _region, size_t _size, size_t _alignment) {
+            if (_size > size_t(-1) / 4) return nullptr;
+
+            size_t   need  = std::max (std::max (_size, _alignment), size_t(1) << BUDDY_MIN_ORDER);
+            unsigned order = highestBit (need - 1) + 1;
+            steps = 0;
+
+            for (size_t i = 0; i < _region.count(); ++i) {
+                BytePointer block = take (_region.chunk (i), order, _alignment);
+                if (block != nullptr) return place (_region, _region.chunk (i), block, order, _size);
+            }
+
+            auto chunk = grow (_region, order, _alignment);
+            BytePointer block = (chunk != nullptr) ? take (chunk, order, _alignment) : nullptr;
+            return (block != nullptr) ? place (_region, chunk, block, order, _size) : nullptr;
+        }
+
+        /** return false when _data is not a live block */
+        template <class Region>
+        inline bool deallocate (Region& _region, void* _data) {
+            auto   chunk = _region.chunkOf (_data);
+            Layout map   = layout (chunk);
+
+            unsigned order;
+            if (!live (map, (BytePointer)_data, order)) return false;
+
+            size_t offset = (BytePointer)_data - map.base;
+            _region.vacate (size_t(1) << order);
+            _region.freed (_data, size_t(1) << order);
+
+            // merge with the buddy for as long as it is free and whole
+            for (; order < map.top; ++order) {
+                size_t buddy = offset ^ (size_t(1) << order);
+                if (!test (map.free, node (map, order, buddy))) break;
+
+                unlink (map, order, buddy);
+                offset &= ~(size_t(1) << order);
+                clear (map.split, node (map, order + 1, offset));
+            }
+            push (map, order, offset);
+
+            if (_region.leave (chunk)) _region.drop (chunk);
+            return true;
+        }
+
+        /** all or nothing, return false on fail */
+        template <class Region>
+        bool allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out) {
+            for (size_t i = 0; i < _count; ++i) {
+                if ((_out[i] = allocate (_region, _size, _alignment)) == nullptr) {
+                    while (i > 0) deallocate (_region, _out[--i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** returns the number freed, moved to the front of _data */
+        template <class Region>
+        size_t deallocateBatch (Region& _region, void** _data, size_t _count) {
+            size_t freed = 0;
+            for (size_t i = 0; i < _count; ++i) {
+                if (deallocate (_region, _data[i])) std::swap (_data[i], _data[freed++]);
+            }
+            return freed;
+        }
+
+        template <class Region>
+        void release (Region& _region) {
+            _region.reset();
+            for (size_t i = 0; i < _region.count(); ++i) format (_region.chunk (i));
+        }
+
+        template <class Region>
+        inline bool freeable (Region& _region, void* _data) const {
+            unsigned order;
+            return live (layout (_region.chunkOf (_data)), (BytePointer)_data, order);
+        }
+
+        /** the biggest block that fits without growing */
+        template <class Region>
+        size_t largestFree (const Region& _region) const {
+            size_t largest = 0;
+            for (size_t i = 0; i < _region.count(); ++i) {
+                Layout map = layout (_region.chunk (i));
+                for (unsigned k = map.top; k >= BUDDY_MIN_ORDER && (size_t(1) << k) > largest; --k) {
+                    if (map.heads[k - BUDDY_MIN_ORDER] != nullptr) largest = size_t(1) << k;
+                }
+            }
+            return largest;
+        }
+
+        /** orders looked at by the last allocate */
+        inline size_t searchLength () const { return steps; }
+
+    private:
+        struct Link {
+            Link* next; // the next free block of the order
+            Link* prev; // the one before, null at the head
+        };
+
+        struct Layout {
+            BytePointer base;  // the first block
+            size_t      area;  // bytes the blocks may cover
+            unsigned    top;   // the largest order the chunk could hold
+            Link**      heads; // a free list per order from BUDDY_MIN_ORDER
+            uint64_t*   split; // a bit per block that has been split
+            uint64_t*   free;  // a bit per block on a free list
+        };
+
+        /**
+         *  where the blocks and metadata of _chunk are, worked out from
+         *  its size alone. Block k of order j is bit 2^(top + 1 - j) + k
+         *  of a tree, so every block of every order has a bit of its own.
+         */
+        template <class Chunk>
+        static inline Layout layout (const Chunk* _chunk) {
+            Layout map;
+            map.top  = (_chunk->size > 0) ? std::max (highestBit (_chunk->size), (unsigned)BUDDY_MIN_ORDER) : BUDDY_MIN_ORDER;
+            map.base = _chunk->begin + alignmentPadding (_chunk->begin, baseAlignment (_chunk->size));
+
+            size_t words = ((size_t(1) << (map.top + 2 - BUDDY_MIN_ORDER)) + 63) / 64;
+            size_t bytes = (map.top - BUDDY_MIN_ORDER + 1) * sizeof(Link*) + 2 * words * sizeof(uint64_t);
+
+            // too small for its metadata and a block, it has no orders at all
+            if (bytes + (map.base - _chunk->begin) + (1 << BUDDY_MIN_ORDER) > _chunk->size) {
+                map.top   = BUDDY_MIN_ORDER - 1;
+                map.area  = 0;
+                map.heads = nullptr;
+                map.split = map.free = nullptr;
+                return map;
+            }
+
+            BytePointer end = _chunk->begin + _chunk->size;
+            map.heads = (Link**)((uintptr_t)(end - bytes) & ~(uintptr_t)(sizeof(uint64_t) - 1));
+            map.split = (uint64_t*)(map.heads + (map.top - BUDDY_MIN_ORDER + 1));
+            map.free  = map.split + words;
+            map.area  = ((BytePointer)map.heads - map.base) & ~(size_t)((1 << BUDDY_MIN_ORDER) - 1);
+            return map;
+        }
+
+        /** what the first block of a chunk of _size is aligned to, and so every block as big */
+        static inline size_t baseAlignment (size_t _size) {
+            return (_size / BUDDY_SLACK > BUDDY_LINE) ? size_t(1) << highestBit (_size / BUDDY_SLACK) : BUDDY_LINE;
+        }
+
+        static inline size_t node (const Layout& _map, unsigned _order, size_t _offset) {
+            return (size_t(1) << (_map.top + 1 - _order)) + (_offset >> _order);
+        }
+
+        static inline bool test  (const uint64_t* _bits, size_t _index) { return (_bits[_index / 64] >> (_index % 64)) & 1; }
+        static inline void set   (uint64_t* _bits, size_t _index) { _bits[_index / 64] |= uint64_t(1) << (_index % 64); }
+        static inline void clear (uint64_t* _bits, size_t _index) { _bits[_index / 64] &= ~(uint64_t(1) << (_index % 64)); }
+
+        /**
+         *  whether _data starts a block in use, setting _order to its order.
+         *  Every bit inside a block in use is clear, so its order is the
+         *  first one, going up from the smallest, whose parent is split.
+         */
+        static inline bool live (const Layout& _map, BytePointer _data, unsigned& _order) {
+            if (_data < _map.base || _data >= _map.base + _map.area) return false;
+
+            size_t offset = _data - _map.base;
+            for (_order = BUDDY_MIN_ORDER; _order <= _map.top && (offset & ((size_t(1) << _order) - 1)) == 0; ++_order) {
+                if (!test (_map.split, node (_map, _order + 1, offset & ~((size_t(2) << _order) - 1)))) continue;
+
+                size_t index = node (_map, _order, offset);
+                return !test (_map.split, index) && !test (_map.free, index);
+            }
+            return false;
+        }
+
+        static inline void push (const Layout& _map, unsigned _order, size_t _offset) {
+            Link*  link = (Link*)(_map.base + _offset);
+            Link*& head = _map.heads[_order - BUDDY_MIN_ORDER];
+
+            sanitizerUnpoison (link, sizeof(Link));
+            link->next = head;
+            link->prev = nullptr;
+            if (head != nullptr) head->prev = link;
+            head = link;
+            set (_map.free, node (_map, _order, _offset));
+        }
+
+        static inline void unlink (const Layout& _map, unsigned _order, size_t _offset) {
+            Link* link = (Link*)(_map.base + _offset);
+
+            if (link->prev != nullptr) link->prev->next = link->next;
+            else _map.heads[_order - BUDDY_MIN_ORDER] = link->next;
+            if (link->next != nullptr) link->next->prev = link->prev;
+            clear (_map.free, node (_map, _order, _offset));
+            sanitizerPoison (link, sizeof(Link));
+        }
+
+        template <class Chunk>
+        BytePointer take (Chunk* _chunk, unsigned _order, size_t _alignment);
+
+        template <class Region>
+        inline BytePointer place (Region& _region, typename Region::Chunk* _chunk, BytePointer _block, unsigned _order, size_t _size) {
+            _region.enter (_chunk);
+            _region.occupy (size_t(1) << _order);
+            _region.allocated (_block, _size);
+            return _block;
+        }
+
+        template <class Region>
+        typename Region::Chunk* grow (Region& _region, unsigned _order, size_t _alignment);
+
+        template <class Chunk>
+        static void format (Chunk* _chunk);
+
+        size_t steps; // orders looked at by the last allocate
+};
+
+/**
+ *  take
+ *
+ *  _chunk      the chunk to look in
+ *  _order      the order of the block
+ *  _alignment  the power of two the address must be a multiple of
+ *
+ *  Pops a block from the smallest order at or above _order with one
+ *  free, then splits it, keeping the lower half and freeing the upper,
+ *  until it is the size asked for. _order is never below the order of
+ *  _alignment, so on a base aligned to it every block of the order is
+ *  too. returns a null pointer when no order has a block, or the base
+ *  of the chunk is not aligned enough.
+ */
+template <class Chunk>
+BytePointer BuddyStrategy::take (Chunk* _chunk, unsigned _order, size_t _alignment) {
+    Layout map = layout (_chunk);
+    if (_order > map.top || ((uintptr_t)map.base & (_alignment - 1)) != 0) return nullptr;
+
+    unsigned order = _order;
+    while (map.heads[order - BUDDY_MIN_ORDER] == nullptr) {
+        ++steps;
+        if (++order > map.top) return nullptr;
+    }
+    ++steps;
+
+    size_t offset = (BytePointer)map.heads[order - BUDDY_MIN_ORDER] - map.base;
+    unlink (map, order, offset);
+
+    for (; order > _order; --order) {
+        set (map.split, node (map, order, offset));
+        push (map, order - 1, offset + (size_t(1) << (order - 1)));
+    }
+    return map.base + offset;
+}
+
+/**
+ *  grow
+ *
+ *  _region     the region to grow
+ *  _order      the order of the block
+ *  _alignment  the power of two the address must be a multiple of
+ *
+ *  Chains a chunk big enough for a block of the order once its metadata
+ *  and the padding in front of its first block are taken out, and
+ *  carves it into blocks. The chunk is at least BUDDY_SLACK times
+ *  _alignment, so its first block is aligned to it. returns a null
+ *  pointer when the region cannot grow.
+ */
+template <class Region>
+typename Region::Chunk* BuddyStrategy::grow (Region& _region, unsigned _order, size_t _alignment) {
+    if (_order > 8 * sizeof(size_t) - 4 || _alignment > size_t(-1) / (4 * BUDDY_SLACK)) return nullptr;
+
+    // the metadata is under a sixteenth of the chunk and a list head per order, the padding a thirty-second
+    size_t block = size_t(1) << _order;
+    size_t bytes = block + block / 4 + 8 * sizeof(size_t) * sizeof(Link*) + BUDDY_LINE;
+    auto   chunk = _region.grow (std::max (bytes, BUDDY_SLACK * _alignment));
+    if (chunk != nullptr) format (chunk);
+    return chunk;
+}
+
+/**
+ *  format
+ *
+ *  _chunk  an empty chunk
+ *
+ *  Clears the metadata and frees the biggest blocks that fit, largest
+ *  first, so every block sits at a multiple of its size. The parent of
+ *  each of these blocks is marked split although it does not exist, so
+ *  finding the order of a block stops there and a block never merges
+ *  past it.
+ */
+template <class Chunk>
+void BuddyStrategy::format (Chunk* _chunk) {
+    Layout map = layout (_chunk);
+    if (map.area == 0) return;
+
+    sanitizerUnpoison (map.heads, (BytePointer)(map.free + (map.free - map.split)) - (BytePointer)map.heads);
+    std::memset (map.heads, 0, (BytePointer)(map.free + (map.free - map.split)) - (BytePointer)map.heads);
+
+    size_t offset = 0;
+    for (unsigned order = map.top; order >= BUDDY_MIN_ORDER; --order) {
+        if (offset + (size_t(1) << order) > map.area) continue;
+
+        set (map.split, node (map, order + 1, offset & ~((size_t(2) << order) - 1)));
+        push (map, order, offset);
+        offset += size_t(1) << order;
+    }
+}
+
+#endif /* BuddyStrategy_hpp */
@@ -6,6 +6,19 @@
 #ifndef BytePointer_hpp
 #define BytePointer_hpp
 
+#include <cstddef>
+#include <cstdint>
+
 typedef char* BytePointer;
 
+/**
+ *  alignmentPadding
+ *
+ *  the bytes to skip from _data to reach a multiple of _alignment,
+ *  which must be a power of two.
+ */
+inline size_t alignmentPadding (BytePointer _data, size_t _alignment) {
+    return (_alignment - ((uintptr_t)_data & (_alignment - 1))) & (_alignment - 1);
+}
+
 #endif /* BytePointer_hpp */
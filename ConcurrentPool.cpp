@@ -0,0 +1,452 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ConcurrentPool.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "ConcurrentPool.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#define CONCURRENT_LARGE SIZE_CLASS_COUNT // the size class of a large block
+
+namespace {
+    std::atomic<size_t> nextId (1);
+
+    // the ids of pools still alive, so exiting threads know which of
+    // their heaps can still be handed back
+    std::mutex& registryLock () { static std::mutex m; return m; }
+    std::unordered_set<size_t>& registry () { static std::unordered_set<size_t> r; return r; }
+}
+
+/**
+ *  HeapCache
+ *
+ *  the heaps a thread has attached to, one per pool. The last one used
+ *  is kept apart so the common case is a single compare. When the thread
+ *  exits its heaps are detached so a new thread can adopt them, pages
+ *  and all, and forgotten, so a block the thread frees later still, from
+ *  another thread local destructor say, goes on its page's remote list.
+ */
+struct HeapCache {
+    size_t                last;
+    ConcurrentPool::Heap* heap;
+    std::vector<std::pair<size_t, ConcurrentPool::Heap*>> heaps;
+
+    HeapCache () : last (0), heap (nullptr) {}
+
+    ~HeapCache () {
+        std::lock_guard<std::mutex> guard (registryLock());
+        for (auto& entry : heaps) {
+            if (registry().count (entry.first)) {
+                entry.second->attached.store (false, std::memory_order_release);
+            }
+        }
+
+        last = 0;
+        heap = nullptr;
+        std::vector<std::pair<size_t, ConcurrentPool::Heap*>> ().swap (heaps);
+    }
+};
+
+namespace {
+    thread_local HeapCache cache;
+}
+
+/**
+ *  ConcurrentPool Constructor
+ *
+ *  _size   the amount of memory to preallocate
+ *
+ *  Constructs a concurrent pool of _size bytes split into aligned
+ *  pages. Kills the executing program on malloc failure.
+ */
+ConcurrentPool::ConcurrentPool (size_t _size)
+    : id (nextId.fetch_add (1)), heaps (nullptr), used (0) {
+    size = _size & ~size_t(CONCURRENT_PAGE_SIZE - 1);
+
+    if (!(data = (BytePointer)malloc(size + CONCURRENT_PAGE_SIZE))) {
+        std::cout << "ERROR: malloc failure" << std::endl;
+        exit (1);
+    }
+
+    uintptr_t address = (uintptr_t)data;
+    begin = data + ((CONCURRENT_PAGE_SIZE - (address & (CONCURRENT_PAGE_SIZE - 1))) & (CONCURRENT_PAGE_SIZE - 1));
+    central.give (begin, size);
+
+    std::lock_guard<std::mutex> guard (registryLock());
+    registry().insert (id);
+}
+
+/**
+ *  ConcurrentPool Destructor
+ *
+ *  Forgets the pool so exiting threads leave its heaps alone, then frees
+ *  the heaps and the block of memory.
+ */
+ConcurrentPool::~ConcurrentPool () {
+    {
+        std::lock_guard<std::mutex> guard (registryLock());
+        registry().erase (id);
+    }
+
+    while (heaps != nullptr) {
+        Heap* next = heaps->next;
+        delete heaps;
+        heaps = next;
+    }
+
+    free (data);
+}
+
+/**
+ *  allocate
+ *
+ *  _size   the size of memory required
+ *
+ *  Pops a block from the head page of the calling thread's size class,
+ *  falling back to the slow path when that page has nothing left.
+ *  returns a null pointer on failure.
+ */
+void* ConcurrentPool::allocate (size_t _size) {
+    if (_size > SIZE_CLASS_MAX) return allocateLarge (_size);
+
+    Heap*    heap  = localHeap (true);
+    unsigned index = sizeClassIndex (_size);
+    Page*    page  = heap->pages[index];
+
+    if (page != nullptr) {
+        if (page->local != nullptr) {
+            Link* block = page->local;
+            page->local = block->next;
+            ++page->live;
+            return block;
+        }
+        if (page->fresh < page->end) {
+            BytePointer block = page->fresh;
+            page->fresh += sizeClassBytes (index);
+            ++page->live;
+            return block;
+        }
+    }
+
+    return allocateSlow (heap, index);
+}
+
+/**
+ *  deallocate
+ *
+ *  _data   a pointer to the data to free
+ *
+ *  Frees a block into its page. The owning thread pushes it onto the
+ *  page's local list, any other thread onto the lock free remote list.
+ *  The first block freed into a parked page brings it back. A page the
+ *  owner empties goes back to the central index unless it is the one
+ *  being allocated from. returns false when _data is not in the pool.
+ */
+bool ConcurrentPool::deallocate (void* _data) {
+    if (!contains (_data)) return false;
+
+    Page* page = pageOf (_data);
+    if (page->index == CONCURRENT_LARGE) {
+        returnPages (page, (page->end - (BytePointer)page) / CONCURRENT_PAGE_SIZE);
+        return true;
+    }
+
+    Link* block = (Link*)_data;
+    Heap* heap  = localHeap (false);
+
+    if (page->owner == heap) {
+        // a parked page comes back unless a remote free already took it to the delayed list
+        uintptr_t full = CONCURRENT_FULL;
+        if (page->remote.load (std::memory_order_relaxed) == CONCURRENT_FULL &&
+            page->remote.compare_exchange_strong (full, 0, std::memory_order_acq_rel)) link (heap, page);
+
+        block->next = page->local;
+        page->local = block;
+
+        if (--page->live == 0 && heap->pages[page->index] != page) {
+            // take remote frees first, the page must really be empty
+            collect (page);
+            if (page->live == 0) {
+                unlink (heap, page);
+                returnPages (page, 1);
+            }
+        }
+    } else {
+        uintptr_t head = page->remote.load (std::memory_order_relaxed);
+        do {
+            block->next = (Link*)(head & ~uintptr_t(CONCURRENT_FULL));
+        } while (!page->remote.compare_exchange_weak (head, (uintptr_t)block,
+                                                     std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed));
+
+        // whoever clears the bit of a parked page hands it back to its owner,
+        // which cannot give it up while this block is still out
+        if (head & CONCURRENT_FULL) {
+            Heap* owner = page->owner;
+            Page* top   = owner->delayed.load (std::memory_order_relaxed);
+            do {
+                page->next = top;
+            } while (!owner->delayed.compare_exchange_weak (top, page,
+                                                           std::memory_order_release,
+                                                           std::memory_order_relaxed));
+        }
+    }
+
+    return true;
+}
+
+/**
+ *  release
+ *
+ *  hands every page back to the central index at once. Heaps stay
+ *  attached to their threads but own nothing.
+ */
+void ConcurrentPool::release () {
+    std::lock_guard<std::mutex> guard (lock);
+
+    for (Heap* heap = heaps; heap != nullptr; heap = heap->next) {
+        for (Page*& page : heap->pages) page = nullptr;
+        heap->delayed.store (nullptr, std::memory_order_relaxed);
+    }
+
+    central.clear();
+    central.give (begin, size);
+    used.store (0, std::memory_order_relaxed);
+}
+
+/**
+ *  localHeap
+ *
+ *  _create whether to attach a heap if the thread has none yet
+ *
+ *  The calling thread's heap for this pool.
+ */
+ConcurrentPool::Heap* ConcurrentPool::localHeap (bool _create) {
+    if (cache.last == id) return cache.heap;
+
+    for (auto& entry : cache.heaps) {
+        if (entry.first == id) {
+            cache.last = id;
+            cache.heap = entry.second;
+            return entry.second;
+        }
+    }
+
+    if (!_create) return nullptr;
+
+    Heap* heap = attach();
+    cache.heaps.push_back ({id, heap});
+    cache.last = id;
+    cache.heap = heap;
+    return heap;
+}
+
+/**
+ *  attach
+ *
+ *  adopts a heap left behind by an exited thread, or makes a new one.
+ */
+ConcurrentPool::Heap* ConcurrentPool::attach () {
+    std::lock_guard<std::mutex> guard (lock);
+
+    for (Heap* heap = heaps; heap != nullptr; heap = heap->next) {
+        bool detached = false;
+        if (heap->attached.compare_exchange_strong (detached, true, std::memory_order_acquire)) {
+            return heap;
+        }
+    }
+
+    Heap* heap = new Heap;
+    for (Page*& page : heap->pages) page = nullptr;
+    heap->attached.store (true, std::memory_order_relaxed);
+    heap->delayed.store (nullptr, std::memory_order_relaxed);
+    heap->next = heaps;
+    heaps = heap;
+    return heap;
+}
+
+/**
+ *  allocateSlow
+ *
+ *  _heap   the calling thread's heap
+ *  _index  the size class required
+ *
+ *  Takes back parked pages other threads have freed into, then collects
+ *  remote frees on the heap's pages of a size class and moves the first
+ *  one with room to the front. A page still full is parked on the way,
+ *  so no page is walked past twice while it stays full. When every page
+ *  is full a new page is taken from the central index.
+ */
+BytePointer ConcurrentPool::allocateSlow (Heap* _heap, unsigned _index) {
+    adopt (_heap);
+
+    Page* page = _heap->pages[_index];
+    while (page != nullptr) {
+        collect (page);
+
+        Page* next = page->next;
+        unlink (_heap, page);
+        if (page->local != nullptr || page->fresh < page->end) break;
+
+        // parking fails only when a block came back since the collect
+        uintptr_t empty = 0;
+        if (!page->remote.compare_exchange_strong (empty, CONCURRENT_FULL, std::memory_order_acq_rel)) {
+            collect (page);
+            break;
+        }
+        page = next;
+    }
+
+    if (page == nullptr) {
+        if (!(page = takePages (1))) return nullptr;
+
+        page = new (page) Page;
+        page->remote.store (0, std::memory_order_relaxed);
+        page->owner = _heap;
+        page->local = nullptr;
+        page->fresh = (BytePointer)page + CONCURRENT_PAGE_HEADER;
+        page->end   = page->fresh + ((CONCURRENT_PAGE_SIZE - CONCURRENT_PAGE_HEADER) / sizeClassBytes (_index)) * sizeClassBytes (_index);
+        page->index = _index;
+        page->live  = 0;
+    }
+
+    // the page with room goes to the front of the list
+    link (_heap, page);
+
+    BytePointer block;
+    if (page->local != nullptr) {
+        block = (BytePointer)page->local;
+        page->local = page->local->next;
+    } else {
+        block = page->fresh;
+        page->fresh += sizeClassBytes (_index);
+    }
+
+    ++page->live;
+    return block;
+}
+
+/**
+ *  allocateLarge
+ *
+ *  _size   the size of memory required
+ *
+ *  Takes a run of whole pages from the central index for a request too
+ *  big for any size class. returns a null pointer on failure.
+ */
+BytePointer ConcurrentPool::allocateLarge (size_t _size) {
+    // the page count below rounds up past _size, which must not wrap
+    if (_size > size_t(-1) - CONCURRENT_PAGE_HEADER - CONCURRENT_PAGE_SIZE) return nullptr;
+
+    size_t count = (_size + CONCURRENT_PAGE_HEADER + CONCURRENT_PAGE_SIZE - 1) / CONCURRENT_PAGE_SIZE;
+
+    Page* page = takePages (count);
+    if (page == nullptr) return nullptr;
+
+    page = new (page) Page;
+    page->owner = nullptr;
+    page->end   = (BytePointer)page + count * CONCURRENT_PAGE_SIZE;
+    page->index = CONCURRENT_LARGE;
+    return (BytePointer)page + CONCURRENT_PAGE_HEADER;
+}
+
+/**
+ *  collect
+ *
+ *  _page   a page owned by the calling thread
+ *
+ *  Moves every block other threads have freed onto the local list.
+ */
+void ConcurrentPool::collect (Page* _page) {
+    Link* list = (Link*)_page->remote.exchange (0, std::memory_order_acquire);
+    if (list == nullptr) return;
+
+    Link* tail = list;
+    unsigned count = 1;
+    while (tail->next != nullptr) {
+        tail = tail->next;
+        ++count;
+    }
+
+    tail->next   = _page->local;
+    _page->local = list;
+    _page->live -= count;
+}
+
+/**
+ *  link
+ *
+ *  puts a page at the front of its heap's size class list.
+ */
+void ConcurrentPool::link (Heap* _heap, Page* _page) {
+    Page*& head = _heap->pages[_page->index];
+    _page->prev = nullptr;
+    _page->next = head;
+    if (head != nullptr) head->prev = _page;
+    head = _page;
+}
+
+/**
+ *  unlink
+ *
+ *  takes a page out of its heap's size class list.
+ */
+void ConcurrentPool::unlink (Heap* _heap, Page* _page) {
+    if (_page->prev != nullptr) _page->prev->next = _page->next;
+    else _heap->pages[_page->index] = _page->next;
+    if (_page->next != nullptr) _page->next->prev = _page->prev;
+}
+
+/**
+ *  adopt
+ *
+ *  _heap   the calling thread's heap
+ *
+ *  Takes every parked page other threads have freed into off the
+ *  delayed list, collects its remote frees and links it in again.
+ */
+void ConcurrentPool::adopt (Heap* _heap) {
+    Page* page = _heap->delayed.exchange (nullptr, std::memory_order_acquire);
+    while (page != nullptr) {
+        Page* next = page->next;
+        collect (page);
+        link (_heap, page);
+        page = next;
+    }
+}
+
+/**
+ *  takePages
+ *
+ *  _count  the number of contiguous pages required
+ *
+ *  Takes a run of pages from the central index.
+ */
+ConcurrentPool::Page* ConcurrentPool::takePages (size_t _count) {
+    std::lock_guard<std::mutex> guard (lock);
+
+    Page* page = (Page*)central.take (_count * CONCURRENT_PAGE_SIZE);
+    if (page != nullptr) used.fetch_add (_count * CONCURRENT_PAGE_SIZE, std::memory_order_relaxed);
+    return page;
+}
+
+/**
+ *  returnPages
+ *
+ *  _page   the first page of the run
+ *  _count  the number of pages in the run
+ *
+ *  Hands a run of pages back to the central index.
+ */
+void ConcurrentPool::returnPages (Page* _page, size_t _count) {
+    std::lock_guard<std::mutex> guard (lock);
+
+    central.give ((BytePointer)_page, _count * CONCURRENT_PAGE_SIZE);
+    used.fetch_sub (_count * CONCURRENT_PAGE_SIZE, std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ConcurrentPool.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef ConcurrentPool_hpp
+#define ConcurrentPool_hpp
+
+#include "BytePointer.hpp"
+#include "FreeIndex.hpp"
+#include "SizeClass.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+#define CONCURRENT_PAGE_SIZE   65536 // bytes handed to a thread at a time
+#define CONCURRENT_PAGE_HEADER 64    // page metadata, one cache line
+#define CONCURRENT_FULL        1     // the low bit of a remote list, set while its page is parked
+
+/**
+ *  ConcurrentPool
+ *
+ *  A thread safe pool in the spirit of tcmalloc and mimalloc. The block
+ *  is split into aligned pages and every thread gets a heap of its own
+ *  that owns whole pages, each page serving one size class. Allocating
+ *  and freeing on the owning thread never takes a lock; a thread only
+ *  visits the central page index, under a mutex, to take a fresh page
+ *  (a batch of blocks) or hand back a page that emptied. A block freed
+ *  by another thread is pushed onto a lock free list in its page header
+ *  that the owner collects when it next runs dry. A page found full is
+ *  parked off its class list, so running dry costs the same however
+ *  many pages a class has; the first block freed into it brings it
+ *  back, straight away on the owner, through the heap's delayed list
+ *  from any other thread. Requests bigger than SIZE_CLASS_MAX take
+ *  whole pages from the central index.
+ */
+class ConcurrentPool {
+    public:
+        ConcurrentPool (size_t _size);
+       ~ConcurrentPool ();
+
+        /** return nullptr on fail */
+        void* allocate (size_t _size);
+
+        /** return false on fail */
+        bool deallocate (void* _data);
+
+        /** only safe while no other thread is using the pool */
+        void release ();
+
+        /** whether _data lies in the pool's pages, never reading them */
+        inline bool contains (void* _data) const {
+            BytePointer p = (BytePointer)_data;
+            return p >= begin + CONCURRENT_PAGE_HEADER && p < begin + size;
+        }
+
+        /** memory held by thread heaps and large blocks */
+        inline size_t occupiedMemory () { return used.load (std::memory_order_relaxed); }
+        inline size_t totalMemory    () { return size; }
+        inline size_t freeMemory     () { return size - occupiedMemory(); }
+
+    private:
+        struct Link { Link* next; };
+        struct Heap;
+
+        struct Page {
+            std::atomic<uintptr_t> remote; // blocks freed by other threads, and CONCURRENT_FULL
+            Heap*       owner;         // the heap allocating from this page
+            Page*       prev;          // neighbours in the owner's class list
+            Page*       next;          // or the next on a delayed list once parked
+            Link*       local;         // blocks freed by the owner
+            BytePointer fresh;         // the first untouched block
+            BytePointer end;           // one past the last block, or the run
+            unsigned    index;         // the size class of every block
+            unsigned    live;          // blocks out, as seen by the owner
+        };
+
+        struct Heap {
+            Page*              pages[SIZE_CLASS_COUNT]; // head is allocated from, full pages are parked
+            Heap*              next;                    // every heap of the pool
+            std::atomic<bool>  attached;                // in use by a thread
+            std::atomic<Page*> delayed;                 // parked pages other threads freed into
+        };
+
+        static_assert (sizeof(Page) <= CONCURRENT_PAGE_HEADER, "page header too big");
+
+        ConcurrentPool (const ConcurrentPool&) = delete;
+        ConcurrentPool& operator= (const ConcurrentPool&) = delete;
+
+        Heap* localHeap (bool _create);
+        Heap* attach    ();
+
+        BytePointer allocateSlow  (Heap* _heap, unsigned _index);
+        BytePointer allocateLarge (size_t _size);
+
+        static void collect (Page* _page);
+        static void link    (Heap* _heap, Page* _page);
+        static void unlink  (Heap* _heap, Page* _page);
+        static void adopt   (Heap* _heap);
+
+        Page* takePages   (size_t _count);
+        void  returnPages (Page* _page, size_t _count);
+
+        inline Page* pageOf (void* _data) const {
+            return (Page*)(begin + (((BytePointer)_data - begin) & ~size_t(CONCURRENT_PAGE_SIZE - 1)));
+        }
+
+        const size_t id;        // tells thread caches of different pools apart
+        BytePointer  data;      // the handle to the preallocated memory
+        BytePointer  begin;     // the first aligned page
+        size_t       size;      // the total size of all the pages
+
+        std::mutex          lock;   // guards the central index and heap list
+        FreeIndex           central; // runs of pages no heap owns
+        Heap*               heaps;  // every heap ever attached
+        std::atomic<size_t> used;   // bytes of pages handed out
+
+        friend struct HeapCache;
+};
+
+#endif /* ConcurrentPool_hpp */
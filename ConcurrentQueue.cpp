@@ -0,0 +1,124 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ConcurrentQueue.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "ConcurrentQueue.hpp"
+#include "SystemQueries.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+/**
+ *  ConcurrentQueue Constructor
+ *
+ *  _size       the size of the ring
+ *  _backing    where the memory comes from
+ *
+ *  Preallocates the ring. Kills executing program on errors such as
+ *  malloc failure or too much memory requested.
+ */
+ConcurrentQueue::ConcurrentQueue (size_t _size, Backing _backing)
+    : backing (_backing), capacity (_size & ~(size_t)(QUEUE_RECORD - 1)),
+      write (0), pending (0), seenRead (0), read (0), seenWrite (0) {
+    if (capacity > memoryLimit()) {
+        std::cout << "ERROR: requested more RAM than system contains" << std::endl;
+        exit (1);
+    }
+
+    if (capacity < 2 * QUEUE_RECORD || !(ring = backing.acquire (capacity, QUEUE_LINE, base, reserved))) {
+        std::cout << "ERROR: malloc failure" << std::endl;
+        exit (1);
+    }
+}
+
+/**
+ *  ConcurrentQueue Destructor
+ *
+ *  Frees the ring
+ */
+ConcurrentQueue::~ConcurrentQueue () {
+    backing.dispose (base, reserved);
+}
+
+/**
+ *  allocate
+ *
+ *  _size   the size of the message
+ *
+ *  Reserves a record and the message behind it at the write end of the
+ *  ring, wrapping round to the start when it would not fit before the
+ *  end. The consumer cannot see the message until it is published.
+ *  Producer only. returns a null pointer when the ring is too full.
+ */
+void* ConcurrentQueue::allocate (size_t _size) {
+    if (_size > largest()) return nullptr;
+
+    size_t bytes  = recordBytes (_size);
+    size_t offset = pending % capacity;
+    size_t skip   = (offset + bytes > capacity) ? capacity - offset : 0;
+
+    // only look at the consumer's position when the ring seems full
+    if (pending + skip + bytes - seenRead > capacity) {
+        seenRead = read.load (std::memory_order_acquire);
+        if (pending + skip + bytes - seenRead > capacity) return nullptr;
+    }
+
+    if (skip != 0) {
+        ((Record*)(ring + offset))->size = Wrap;
+        pending += skip;
+        offset   = 0;
+    }
+
+    ((Record*)(ring + offset))->size = _size;
+    pending += bytes;
+    return ring + offset + QUEUE_RECORD;
+}
+
+/**
+ *  front
+ *
+ *  _size   set to the size of the message
+ *
+ *  The oldest published message, stepping over a wrap marker to the
+ *  start of the ring. Consumer only. returns a null pointer when no
+ *  message is waiting.
+ */
+void* ConcurrentQueue::front (size_t& _size) {
+    size_t position = read.load (std::memory_order_relaxed);
+
+    for (;;) {
+        // only look at the producer's position when the ring seems empty
+        if (position == seenWrite) {
+            seenWrite = write.load (std::memory_order_acquire);
+            if (position == seenWrite) return nullptr;
+        }
+
+        size_t  offset = position % capacity;
+        Record* record = (Record*)(ring + offset);
+        if (record->size != Wrap) {
+            _size = record->size;
+            return ring + offset + QUEUE_RECORD;
+        }
+
+        // the end of the ring is free as soon as the marker is passed
+        position += capacity - offset;
+        read.store (position, std::memory_order_release);
+    }
+}
+
+/**
+ *  deallocate
+ *
+ *  _data   the oldest message
+ *
+ *  Hands the oldest message's room back to the producer. Consumer only.
+ *  returns true on successful deallocation, false otherwise.
+ */
+bool ConcurrentQueue::deallocate (void* _data) {
+    size_t size;
+    if (_data == nullptr || front (size) != _data) return false;
+
+    read.store (read.load (std::memory_order_relaxed) + recordBytes (size), std::memory_order_release);
+    return true;
+}
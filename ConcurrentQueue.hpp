@@ -0,0 +1,80 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ConcurrentQueue.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef ConcurrentQueue_hpp
+#define ConcurrentQueue_hpp
+
+#include "BytePointer.hpp"
+#include "Backing.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+#define QUEUE_LINE   64 // keeps the two threads' counters off each other's cache line
+#define QUEUE_RECORD alignof(std::max_align_t) // every message starts on a multiple of this
+
+/**
+ *  ConcurrentQueue
+ *
+ *  Queue mode for exactly two threads, a producer and a consumer, with
+ *  no locks. The producer allocates a message in a ring, writes it in
+ *  place and publishes it; the consumer reads the oldest published
+ *  message where it lies and deallocates it, so nothing is ever copied.
+ *  Each message has a small record in front holding its size, and a
+ *  message that would run off the end of the ring wraps round to its
+ *  start behind a marker record. The write and read positions only ever
+ *  grow, each is stored by one thread alone, and each thread keeps its
+ *  last sight of the other's position so it only touches the shared
+ *  cache line when the ring looks full or empty.
+ */
+class ConcurrentQueue {
+    public:
+        ConcurrentQueue (size_t _size, Backing _backing = Backing());
+       ~ConcurrentQueue ();
+
+        /** producer: room for a message of _size bytes, return nullptr when full */
+        void* allocate (size_t _size);
+
+        /** producer: hands every message allocated since the last publish to the consumer */
+        inline void publish () { write.store (pending, std::memory_order_release); }
+
+        /** consumer: the oldest published message, return nullptr when empty */
+        void* front (size_t& _size);
+
+        /** consumer: frees the oldest message, return false unless _data is it */
+        bool deallocate (void* _data);
+
+        /** the most bytes a single message can have */
+        inline size_t largest () const { return capacity - QUEUE_RECORD; }
+
+        inline size_t totalMemory () const { return capacity; }
+
+    private:
+        struct Record { size_t size; }; // the message size, or Wrap
+
+        static constexpr size_t Wrap = size_t(-1);
+
+        ConcurrentQueue (const ConcurrentQueue&) = delete;
+        ConcurrentQueue& operator= (const ConcurrentQueue&) = delete;
+
+        static inline size_t recordBytes (size_t _size) {
+            return QUEUE_RECORD + ((_size + QUEUE_RECORD - 1) & ~(size_t)(QUEUE_RECORD - 1));
+        }
+
+        const Backing backing;  // where the ring came from
+        BytePointer   base;     // what the backing returned
+        size_t        reserved; // bytes the backing reserved
+        BytePointer   ring;     // the first byte of the ring
+        size_t        capacity; // its size, a multiple of QUEUE_RECORD
+
+        alignas(QUEUE_LINE) std::atomic<size_t> write; // bytes ever published, stored by the producer
+        size_t pending;   // bytes ever allocated, producer only
+        size_t seenRead;  // the producer's last sight of read
+
+        alignas(QUEUE_LINE) std::atomic<size_t> read;  // bytes ever freed, stored by the consumer
+        size_t seenWrite; // the consumer's last sight of write
+};
+
+#endif /* ConcurrentQueue_hpp */
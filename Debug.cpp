@@ -0,0 +1,153 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Debug.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "Debug.hpp"
+
+#include <atomic>
+#include <iostream>
+
+/**
+ *  printReport
+ *
+ *  _report what was found
+ *
+ *  The default handler, one line per report on the console.
+ */
+static void printReport (const DebugReport& _report) {
+    static const char* kinds[] = { "overrun past", "underrun before", "double free of", "invalid free of", "leak of" };
+
+    std::cout << "MEMORY ERROR: " << kinds[_report.kind] << " " << _report.data;
+    if (_report.kind != DebugReport::InvalidFree) std::cout << " (" << _report.size << " Bytes)";
+    if (_report.site.file != nullptr) std::cout << " allocated at " << _report.site.file << ":" << _report.site.line;
+    std::cout << std::endl;
+}
+
+static std::atomic<DebugHandler> handler (printReport);
+
+/**
+ *  debugHandler
+ *
+ *  _handler    the new handler, null for the default
+ *
+ *  Swaps the handler every Guarded manager reports to.
+ */
+DebugHandler debugHandler (DebugHandler _handler) {
+    return handler.exchange (_handler != nullptr ? _handler : printReport);
+}
+
+/**
+ *  debugReport
+ *
+ *  _report what was found
+ *
+ *  Passes a report to the current handler.
+ */
+void debugReport (const DebugReport& _report) {
+    handler.load() (_report);
+}
+
+/**
+ *  guard
+ *
+ *  _block      what the strategy handed out, span bytes or null
+ *  _size       the bytes asked for
+ *  _alignment  the power of two the data must be a multiple of
+ *  _site       where the allocation was made
+ *
+ *  Writes the record at the start of the block and its address just
+ *  before the front red zone, fills the red zones and the data, and
+ *  puts the record on the live list. returns the data, or null when
+ *  the strategy failed.
+ */
+void* Guarded::guard (void* _block, size_t _size, size_t _alignment, Site _site) {
+    if (_block == nullptr) return nullptr;
+
+    Record* record = (Record*)_block;
+    record->size   = _size;
+    record->site   = _site;
+    record->data   = (BytePointer)_block + front (_alignment);
+    record->state  = DEBUG_LIVE;
+    *(Record**)(record->data - DEBUG_REDZONE - sizeof(Record*)) = record;
+
+    std::memset (record->data - DEBUG_REDZONE, DEBUG_GUARD, DEBUG_REDZONE);
+    std::memset (record->data, DEBUG_FRESH, _size);
+    std::memset (record->data + _size, DEBUG_GUARD, DEBUG_REDZONE);
+
+    record->prev = nullptr;
+    record->next = live;
+    if (live != nullptr) live->prev = record;
+    live = record;
+    return record->data;
+}
+
+/**
+ *  dropped
+ *
+ *  _block  a block the strategy freed without a call to retire
+ *
+ *  Checks and forgets the record of a block freed by rolling a stack
+ *  back, which hands the strategy's own blocks out. returns the data
+ *  the caller saw.
+ */
+void* Guarded::dropped (void* _block) {
+    Record* record = (Record*)_block;
+
+    check (record);
+    unlink (record);
+    std::memset (record->data, DEBUG_FREED, record->size);
+    return record->data;
+}
+
+/**
+ *  released
+ *
+ *  Everything still live is about to go at once, so each is reported
+ *  as a leak with the site it came from.
+ */
+void Guarded::released () {
+    for (Record* record = live; record != nullptr; record = record->next) {
+        debugReport (DebugReport { DebugReport::Leak, record->data, record->size, record->site });
+    }
+    live = nullptr;
+}
+
+/**
+ *  check
+ *
+ *  _record a live record
+ *
+ *  Reports a red zone that no longer holds DEBUG_GUARD throughout.
+ */
+void Guarded::check (Record* _record) {
+    BytePointer before = _record->data - DEBUG_REDZONE;
+    BytePointer after  = _record->data + _record->size;
+
+    for (size_t i = 0; i < DEBUG_REDZONE; ++i) {
+        if ((unsigned char)before[i] != DEBUG_GUARD) {
+            debugReport (DebugReport { DebugReport::Underrun, _record->data, _record->size, _record->site });
+            break;
+        }
+    }
+    for (size_t i = 0; i < DEBUG_REDZONE; ++i) {
+        if ((unsigned char)after[i] != DEBUG_GUARD) {
+            debugReport (DebugReport { DebugReport::Overrun, _record->data, _record->size, _record->site });
+            break;
+        }
+    }
+}
+
+/**
+ *  unlink
+ *
+ *  _record a live record
+ *
+ *  Takes the record off the live list and marks it freed.
+ */
+void Guarded::unlink (Record* _record) {
+    if (_record->prev != nullptr) _record->prev->next = _record->next;
+    else live = _record->next;
+    if (_record->next != nullptr) _record->next->prev = _record->prev;
+    _record->state = DEBUG_DEAD;
+}
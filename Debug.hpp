@@ -0,0 +1,223 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Debug.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Debug_hpp
+#define Debug_hpp
+
+#include "BytePointer.hpp"
+#include "Sanitizer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define DEBUG_REDZONE 16                    // guard bytes either side of a block
+#define DEBUG_GUARD   0xAB                  // what the red zones hold
+#define DEBUG_FRESH   0xCD                  // what a new block holds
+#define DEBUG_FREED   0xDD                  // what a freed block holds
+#define DEBUG_LIVE    0x4D4D4C495645ULL     // the state of a block in use
+#define DEBUG_DEAD    0x4D4D44454144ULL     // the state of a freed block
+
+/** where an allocation was made, for MEMORY_MANAGER_SITE */
+struct Site {
+    const char* file; // null when not known
+    int         line;
+};
+
+#define MEMORY_MANAGER_SITE Site { __FILE__, __LINE__ }
+
+/**
+ *  DebugReport
+ *
+ *  a problem the Guarded policy found. data is the block as the caller
+ *  saw it; size and site are those it was allocated with, unknown for
+ *  an invalid free.
+ */
+struct DebugReport {
+    enum Kind { Overrun, Underrun, DoubleFree, InvalidFree, Leak };
+
+    Kind        kind;
+    const void* data;
+    size_t      size;
+    Site        site;
+};
+
+typedef void (*DebugHandler) (const DebugReport&);
+
+/**
+ *  debugHandler
+ *
+ *  _handler    what every Guarded manager calls with its reports, or
+ *              null for the default, which prints them
+ *
+ *  returns the handler it replaces.
+ */
+DebugHandler debugHandler (DebugHandler _handler);
+
+/** passes _report to the handler */
+void debugReport (const DebugReport& _report);
+
+/**
+ *  NoDebug
+ *
+ *  the debug policy of a manager that checks nothing. Blocks are what
+ *  the strategy hands out, every hook is empty or passes its argument
+ *  through, so they compile to nothing and the policy takes up no space.
+ */
+struct NoDebug {
+    static constexpr bool Enabled = false;
+
+    inline size_t span      (size_t _size, size_t _alignment) const { return _size; }
+    inline size_t alignment (size_t _alignment) const { return _alignment; }
+    inline void*  guard     (void* _block, size_t _size, size_t _alignment, Site _site) { return _block; }
+
+    template <class Region, class Freeable>
+    inline void* retire (Region& _region, void* _data, Freeable _freeable) { return _data; }
+
+    template <class Region>
+    inline void* block (Region& _region, void* _data) const { return _data; }
+
+    inline void* dropped  (void* _block) { return _block; }
+    inline void  released () {}
+};
+
+/**
+ *  Guarded
+ *
+ *  the debug policy of a hardened manager, cheap enough to leave on in
+ *  canaries. Every block carries a record of its size and allocation
+ *  site in front of it, and red zones of DEBUG_GUARD either side. New
+ *  blocks are filled with DEBUG_FRESH. A free checks both red zones,
+ *  reporting an overrun or underrun, and fills the block with
+ *  DEBUG_FREED so a stale read stands out. A free of a freed block is
+ *  reported as a double free until the block is handed out again, and
+ *  any other pointer that is no block as an invalid free; both are then
+ *  refused. Live records are kept on a list, so whatever is still live
+ *  at release or destruction is reported as a leak with its site.
+ *  Reports go to the debugHandler. The hooks run under the manager's
+ *  lock.
+ */
+class Guarded {
+    public:
+        static constexpr bool Enabled = true;
+
+        Guarded () : live (nullptr) {}
+
+        /** what to ask the strategy for: the record, the red zones and padding to keep _alignment */
+        inline size_t span (size_t _size, size_t _alignment) const {
+            if (_size > size_t(-1) / 4 || _alignment > size_t(-1) / 4) return size_t(-1) / 2;
+            return front (_alignment) + _size + DEBUG_REDZONE;
+        }
+
+        /** what to align the block to, so the record in front of the data is aligned as well */
+        inline size_t alignment (size_t _alignment) const {
+            return (_alignment > alignof(std::max_align_t)) ? _alignment : alignof(std::max_align_t);
+        }
+
+        void* guard (void* _block, size_t _size, size_t _alignment, Site _site);
+
+        /** checks and poisons _data for the strategy to free, return null to refuse it */
+        template <class Region, class Freeable>
+        void* retire (Region& _region, void* _data, Freeable _freeable);
+
+        /** the block the strategy handed out for _data, null when it is not live */
+        template <class Region>
+        inline void* block (Region& _region, void* _data) const {
+            Record* record = find (_region, _data);
+            return (record != nullptr && record->state == DEBUG_LIVE) ? record : nullptr;
+        }
+
+        /** _block was freed by the strategy itself, returns the data it held */
+        void* dropped (void* _block);
+
+        /** reports every live block as a leak and forgets them */
+        void released ();
+
+    private:
+        struct Record {
+            Record*     next;  // the next live record; the strategy may take these
+            Record*     prev;  // two words for links once the block is freed
+            size_t      size;  // the bytes asked for
+            Site        site;  // where they were asked for
+            BytePointer data;  // the block as the caller sees it
+            uint64_t    state; // DEBUG_LIVE or DEBUG_DEAD
+        };
+
+        /** the bytes in front of the data: the record, its address and a red zone */
+        static inline size_t front (size_t _alignment) {
+            size_t bytes = sizeof(Record) + sizeof(Record*) + DEBUG_REDZONE;
+            _alignment   = (_alignment > alignof(std::max_align_t)) ? _alignment : alignof(std::max_align_t);
+            return (bytes + _alignment - 1) & ~(_alignment - 1);
+        }
+
+        /** the record of _data, read only once it is known to lie inside the region */
+        template <class Region>
+        static inline Record* find (Region& _region, void* _data) {
+            BytePointer data  = (BytePointer)_data;
+            auto        chunk = _region.chunkOf (_data);
+            BytePointer end   = chunk->begin + chunk->size;
+
+            if ((uintptr_t)data % alignof(Record*) != 0) return nullptr;
+            if (data < chunk->begin + sizeof(Record) + sizeof(Record*) + DEBUG_REDZONE || data > end) return nullptr;
+
+            // a freed block may be poisoned, and then it has no record to read
+            Record** back = (Record**)(data - DEBUG_REDZONE - sizeof(Record*));
+            if (sanitizerPoisoned (back, sizeof(Record*))) return nullptr;
+
+            Record* record = *back;
+            if ((BytePointer)record < chunk->begin || (BytePointer)(record + 1) > data) return nullptr;
+            if ((uintptr_t)record % alignof(Record) != 0 || sanitizerPoisoned (record, sizeof(Record))) return nullptr;
+            if (record->data != data) return nullptr;
+            return (record->state == DEBUG_LIVE || record->state == DEBUG_DEAD) ? record : nullptr;
+        }
+
+        /** whether _data is inside the region and poisoned, so freed with its record */
+        template <class Region>
+        static inline bool poisoned (Region& _region, void* _data) {
+            auto chunk = _region.chunkOf (_data);
+            return (BytePointer)_data >= chunk->begin && (BytePointer)_data < chunk->begin + chunk->size && sanitizerPoisoned (_data, 1);
+        }
+
+        void check  (Record* _record);
+        void unlink (Record* _record);
+
+        Record* live; // the newest live record
+};
+
+/**
+ *  retire
+ *
+ *  _region     the region of the manager
+ *  _data       a block as the caller sees it
+ *  _freeable   whether the strategy would free a block it handed out
+ *
+ *  Finds the record of _data, reporting a double or invalid free when
+ *  there is none live. A block the sanitizers poisoned on free has no
+ *  record left to read, so it is a double free of unknown size. Null,
+ *  and a block the strategy will not free right now, out of order in
+ *  Stack mode say, are refused without a report. Other blocks have
+ *  their red zones checked, are poisoned and forgotten. returns the
+ *  block to hand back to the strategy, or null.
+ */
+template <class Region, class Freeable>
+void* Guarded::retire (Region& _region, void* _data, Freeable _freeable) {
+    if (_data == nullptr) return nullptr;
+
+    Record* record = find (_region, _data);
+    if (record == nullptr || record->state == DEBUG_DEAD) {
+        if (record != nullptr) debugReport (DebugReport { DebugReport::DoubleFree, _data, record->size, record->site });
+        else if (poisoned (_region, _data)) debugReport (DebugReport { DebugReport::DoubleFree, _data, 0, Site() });
+        else debugReport (DebugReport { DebugReport::InvalidFree, _data, 0, Site() });
+        return nullptr;
+    }
+    if (!_freeable (record)) return nullptr;
+
+    check (record);
+    unlink (record);
+    std::memset (record->data, DEBUG_FREED, record->size);
+    return record;
+}
+
+#endif /* Debug_hpp */
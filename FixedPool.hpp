@@ -0,0 +1,182 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  FixedPool.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef FixedPool_hpp
+#define FixedPool_hpp
+
+#include "BytePointer.hpp"
+
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ *  FixedPool
+ *
+ *  A pool of equally sized slots sliced from one preallocated block.
+ *  Free slots are threaded into a list through their own memory, so
+ *  allocate and deallocate are a couple of pointer moves and no memory
+ *  is spent on bookkeeping. Slots that have never been handed out are
+ *  taken from the end of a bump pointer, which keeps construction and
+ *  release O(1) however many slots there are. deallocate refuses null,
+ *  foreign and misaligned pointers, but freeing a slot twice is
+ *  undefined unless built with MEMORY_MANAGER_DEBUG, which walks the
+ *  free list and refuses the second free.
+ */
+template <size_t BlockSize, size_t Align = alignof(std::max_align_t)>
+class FixedPool {
+    static_assert ((Align & (Align - 1)) == 0, "alignment must be a power of two");
+
+    public:
+        // every slot must hold the free list link and keep the alignment
+        static constexpr size_t SlotSize =
+            ((BlockSize < sizeof(void*) ? sizeof(void*) : BlockSize) + Align - 1) & ~(Align - 1);
+
+        FixedPool (size_t _count);
+        FixedPool (void* _data, size_t _size);
+       ~FixedPool ();
+
+        /** return nullptr on fail */
+        inline void* allocate () {
+            BytePointer slot;
+            if (head != nullptr) {
+                slot = (BytePointer)head;
+                head = head->next;
+            } else if (fresh + SlotSize <= end) {
+                slot = fresh;
+                fresh += SlotSize;
+            } else return nullptr;
+
+            used += SlotSize;
+            return slot;
+        }
+
+        /** return false on fail */
+        inline bool deallocate (void* _data) {
+            if (!contains (_data)) return false;
+#ifdef MEMORY_MANAGER_DEBUG
+            if (freed (_data)) return false;
+#endif
+
+            Link* link = (Link*)_data;
+            link->next = head;
+            head = link;
+
+            used -= SlotSize;
+            return true;
+        }
+
+        inline bool contains (void* _data) const {
+            BytePointer p = (BytePointer)_data;
+            return p >= begin && p < fresh && (size_t)(p - begin) % SlotSize == 0;
+        }
+
+        void release ();
+
+        inline size_t occupiedMemory () { return used; }
+        inline size_t totalMemory    () { return size; }
+        inline size_t freeMemory     () { return size - used; }
+        inline size_t capacity       () { return size / SlotSize; }
+
+    private:
+        struct Link { Link* next; };
+
+        FixedPool (const FixedPool&) = delete;
+        FixedPool& operator= (const FixedPool&) = delete;
+
+        void slice (BytePointer _data, size_t _size);
+
+        /** whether _data is on the free list already, O(free slots) */
+        inline bool freed (void* _data) const {
+            for (Link* link = head; link != nullptr; link = link->next)
+                if (link == _data) return true;
+            return false;
+        }
+
+        BytePointer data;   // the handle to the preallocated memory, if owned
+        BytePointer begin;  // the first aligned slot
+        BytePointer end;    // one past the last whole slot
+        BytePointer fresh;  // the first slot never handed out
+        Link*       head;   // the most recently freed slot
+        size_t      size;   // the total size of all the slots
+        size_t      used;   // the total size of slots handed out
+};
+
+/**
+ *  FixedPool Constructor
+ *
+ *  _count  the number of slots to preallocate
+ *
+ *  Constructs a pool owning enough memory for _count slots. Kills the
+ *  executing program on malloc failure.
+ */
+template <size_t BlockSize, size_t Align>
+FixedPool<BlockSize, Align>::FixedPool (size_t _count) {
+    size_t bytes = _count * SlotSize + Align;
+    if (!(data = (BytePointer)malloc(bytes))) {
+        std::cout << "ERROR: malloc failure" << std::endl;
+        exit (1);
+    }
+    slice (data, bytes);
+}
+
+/**
+ *  FixedPool Constructor
+ *
+ *  _data   memory owned by someone else, e.g. a MemoryManager block
+ *  _size   the size of that memory
+ *
+ *  Constructs a pool over borrowed memory. The memory is never freed by
+ *  the pool and must outlive it.
+ */
+template <size_t BlockSize, size_t Align>
+FixedPool<BlockSize, Align>::FixedPool (void* _data, size_t _size) : data (nullptr) {
+    slice ((BytePointer)_data, _size);
+}
+
+/**
+ *  FixedPool Destructor
+ *
+ *  Frees the block of memory if the pool owns it
+ */
+template <size_t BlockSize, size_t Align>
+FixedPool<BlockSize, Align>::~FixedPool () {
+    free (data);
+}
+
+/**
+ *  release
+ *
+ *  hands every slot back at once by resetting the bump pointer.
+ */
+template <size_t BlockSize, size_t Align>
+void FixedPool<BlockSize, Align>::release () {
+    fresh = begin;
+    head  = nullptr;
+    used  = 0;
+}
+
+/**
+ *  slice
+ *
+ *  _data   the memory to slice
+ *  _size   the size of that memory
+ *
+ *  Aligns the first slot and works out how many whole slots fit.
+ */
+template <size_t BlockSize, size_t Align>
+void FixedPool<BlockSize, Align>::slice (BytePointer _data, size_t _size) {
+    uintptr_t address = (uintptr_t)_data;
+    size_t    padding = (Align - (address & (Align - 1))) & (Align - 1);
+    size_t    slots   = (_size > padding) ? (_size - padding) / SlotSize : 0;
+
+    begin = _data + padding;
+    end   = begin + slots * SlotSize;
+    size  = slots * SlotSize;
+    release ();
+}
+
+#endif /* FixedPool_hpp */
@@ -0,0 +1,424 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  FreeIndex.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "FreeIndex.hpp"
+
+/**
+ *  FreeIndex Constructor
+ *
+ *  _policy the placement policy used to pick a gap on take
+ *
+ *  Constructs an empty index.
+ */
+FreeIndex::FreeIndex (Policy _policy)
+    : placement (_policy), root (nullptr), rover (nullptr), nodes (0), steps (0), seed (2463534242u) {}
+
+/**
+ *  FreeIndex Destructor
+ *
+ *  Frees every gap node in the tree
+ */
+FreeIndex::~FreeIndex () {
+    destroy (root);
+}
+
+/**
+ *  take
+ *
+ *  _size   the size of memory required
+ *
+ *  Finds a gap of at least _size bytes using the placement policy and
+ *  carves the allocation from its front. Whatever is left of the gap
+ *  stays in the index. Returns a null pointer when no gap is big enough.
+ */
+BytePointer FreeIndex::take (size_t _size) {
+    size_t padding;
+    return take (_size, 1, padding);
+}
+
+/**
+ *  take
+ *
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *  _padding    set to the bytes skipped in front of the block
+ *
+ *  Finds a gap with room for an aligned block of _size bytes and carves
+ *  the padding and the block from its front. The padding goes with the
+ *  block, so it must be given back along with it. Returns a null pointer
+ *  when no gap is big enough.
+ */
+BytePointer FreeIndex::take (size_t _size, size_t _alignment, size_t& _padding) {
+    steps = 0;
+
+    Gap* gap = find (_size, _alignment);
+    if (gap == nullptr) return nullptr;
+
+    _padding = alignmentPadding (gap->data, _alignment);
+
+    BytePointer result = gap->data + _padding;
+    size_t      taken  = _padding + _size;
+
+    if (gap->size > taken) {
+        // the rest of the gap keeps its place in address order, so only
+        // the sizes along the path down to it need fixing
+        if (placement == BestFit) bySize.erase ({gap->size, gap->data});
+        gap->data += taken;
+        gap->size -= taken;
+        if (placement == BestFit) bySize[{gap->size, gap->data}] = gap;
+        shrink (root, gap->data);
+    } else {
+        erase (gap);
+        delete gap;
+    }
+
+    rover = result + _size;
+    return result;
+}
+
+/**
+ *  give
+ *
+ *  _data   the start of the memory being freed
+ *  _size   the size of the memory being freed
+ *
+ *  Returns a range of memory to the index, merging it with the gaps
+ *  directly before and after it when they touch.
+ */
+void FreeIndex::give (BytePointer _data, size_t _size) {
+    if (_size == 0) return;
+
+    Gap* left;
+    Gap* right;
+    split (root, _data, left, right);
+    root = nullptr;
+
+    Gap* gap = nullptr;
+
+    // merge with the gap ending at _data...
+    if (left != nullptr) {
+        Gap* before = left;
+        while (before->right != nullptr) before = before->right;
+        if (before->data + before->size == _data) {
+            gap = popMax (left);
+            if (placement == BestFit) bySize.erase ({gap->size, gap->data});
+            --nodes;
+            gap->size += _size;
+        }
+    }
+
+    // ...and the gap starting where this range ends
+    if (right != nullptr) {
+        Gap* after = right;
+        while (after->left != nullptr) after = after->left;
+        if (_data + _size == after->data) {
+            Gap* next = popMin (right);
+            if (placement == BestFit) bySize.erase ({next->size, next->data});
+            --nodes;
+            if (gap != nullptr) {
+                gap->size += next->size;
+                delete next;
+            } else {
+                gap = next;
+                gap->data  = _data;
+                gap->size += _size;
+            }
+        }
+    }
+
+    if (gap == nullptr) {
+        gap = new Gap;
+        gap->data     = _data;
+        gap->size     = _size;
+        gap->priority = random();
+    }
+
+    gap->left = gap->right = nullptr;
+    update (gap);
+
+    root = merge (merge (left, gap), right);
+    if (placement == BestFit) bySize[{gap->size, gap->data}] = gap;
+    ++nodes;
+}
+
+/**
+ *  clear
+ *
+ *  empties the index
+ */
+void FreeIndex::clear () {
+    destroy (root);
+    bySize.clear();
+    root  = nullptr;
+    rover = nullptr;
+    nodes = 0;
+}
+
+/**
+ *  withdraw
+ *
+ *  _data   the start of the gap
+ *  _size   the size of the gap
+ *
+ *  Takes a whole gap out of the index, so the memory under it can be
+ *  handed back to the system. Nothing changes unless a gap starts at
+ *  _data and is exactly _size bytes.
+ */
+bool FreeIndex::withdraw (BytePointer _data, size_t _size) {
+    Gap* left;
+    Gap* middle;
+    Gap* right;
+    split (root, _data, left, right);
+    split (right, _data + 1, middle, right);
+
+    if (middle == nullptr || middle->size != _size) {
+        root = merge (merge (left, middle), right);
+        return false;
+    }
+
+    root = merge (left, right);
+    if (placement == BestFit) bySize.erase ({middle->size, middle->data});
+    --nodes;
+    delete middle;
+    return true;
+}
+
+/**
+ *  find
+ *
+ *  _size   the size of memory required
+ *
+ *  Picks a gap of at least _size bytes according to the placement policy.
+ */
+FreeIndex::Gap* FreeIndex::find (size_t _size) {
+    switch (placement) {
+        case FirstFit: return firstFit (root, _size, steps);
+        case NextFit: {
+            Gap* gap = firstFitFrom (root, rover, _size, steps);
+            return (gap != nullptr) ? gap : firstFit (root, _size, steps);
+        }
+        case BestFit: {
+            // one probe of the size index
+            ++steps;
+            auto it = bySize.lower_bound ({_size, nullptr});
+            return (it != bySize.end()) ? it->second : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ *  find
+ *
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *
+ *  Tries the gap the policy picks for _size first, since most gaps are
+ *  already aligned. If the padding does not fit, searches again for a
+ *  gap big enough to hold the block wherever the alignment falls.
+ */
+FreeIndex::Gap* FreeIndex::find (size_t _size, size_t _alignment) {
+    Gap* gap = find (_size);
+    if (gap == nullptr || _alignment <= 1) return gap;
+    if (alignmentPadding (gap->data, _alignment) + _size <= gap->size) return gap;
+
+    return find (_size + _alignment - 1);
+}
+
+/**
+ *  insert
+ *
+ *  _gap    a detached gap node
+ *
+ *  Links a gap into the treap at its address.
+ */
+void FreeIndex::insert (Gap* _gap) {
+    Gap* left;
+    Gap* right;
+    split (root, _gap->data, left, right);
+
+    _gap->left = _gap->right = nullptr;
+    update (_gap);
+
+    root = merge (merge (left, _gap), right);
+    if (placement == BestFit) bySize[{_gap->size, _gap->data}] = _gap;
+    ++nodes;
+}
+
+/**
+ *  erase
+ *
+ *  _gap    a gap node in the treap
+ *
+ *  Unlinks a gap from the treap without freeing the node.
+ */
+void FreeIndex::erase (Gap* _gap) {
+    Gap* left;
+    Gap* middle;
+    Gap* right;
+    split (root, _gap->data, left, right);
+    split (right, _gap->data + 1, middle, right);
+
+    root = merge (left, right);
+    if (placement == BestFit) bySize.erase ({_gap->size, _gap->data});
+    --nodes;
+}
+
+/**
+ *  update
+ *
+ *  recomputes the largest gap in a subtree from its children.
+ */
+void FreeIndex::update (Gap* _gap) {
+    size_t largest = _gap->size;
+    if (_gap->left  != nullptr && _gap->left->largest  > largest) largest = _gap->left->largest;
+    if (_gap->right != nullptr && _gap->right->largest > largest) largest = _gap->right->largest;
+    _gap->largest = largest;
+}
+
+/**
+ *  shrink
+ *
+ *  refreshes the largest gap of every subtree on the path down to _key
+ *  after the gap there got smaller.
+ */
+void FreeIndex::shrink (Gap* _root, BytePointer _key) {
+    if (_root == nullptr) return;
+    if      (_key < _root->data) shrink (_root->left,  _key);
+    else if (_root->data < _key) shrink (_root->right, _key);
+    update (_root);
+}
+
+/**
+ *  merge
+ *
+ *  joins two treaps where every address in _left is below every
+ *  address in _right.
+ */
+FreeIndex::Gap* FreeIndex::merge (Gap* _left, Gap* _right) {
+    if (_left  == nullptr) return _right;
+    if (_right == nullptr) return _left;
+
+    if (_left->priority > _right->priority) {
+        _left->right = merge (_left->right, _right);
+        update (_left);
+        return _left;
+    } else {
+        _right->left = merge (_left, _right->left);
+        update (_right);
+        return _right;
+    }
+}
+
+/**
+ *  split
+ *
+ *  divides a treap into the gaps below _key and the gaps at or above it.
+ */
+void FreeIndex::split (Gap* _root, BytePointer _key, Gap*& _left, Gap*& _right) {
+    if (_root == nullptr) {
+        _left = _right = nullptr;
+    } else if (_root->data < _key) {
+        split (_root->right, _key, _root->right, _right);
+        update (_root);
+        _left = _root;
+    } else {
+        split (_root->left, _key, _left, _root->left);
+        update (_root);
+        _right = _root;
+    }
+}
+
+/**
+ *  popMin
+ *
+ *  detaches the lowest addressed gap of a treap.
+ */
+FreeIndex::Gap* FreeIndex::popMin (Gap*& _root) {
+    if (_root->left == nullptr) {
+        Gap* gap = _root;
+        _root = _root->right;
+        return gap;
+    }
+    Gap* gap = popMin (_root->left);
+    update (_root);
+    return gap;
+}
+
+/**
+ *  popMax
+ *
+ *  detaches the highest addressed gap of a treap.
+ */
+FreeIndex::Gap* FreeIndex::popMax (Gap*& _root) {
+    if (_root->right == nullptr) {
+        Gap* gap = _root;
+        _root = _root->left;
+        return gap;
+    }
+    Gap* gap = popMax (_root->right);
+    update (_root);
+    return gap;
+}
+
+/**
+ *  firstFit
+ *
+ *  the lowest addressed gap of at least _size bytes. Subtrees whose
+ *  largest gap is too small are never visited. Every gap looked at is
+ *  counted in _steps.
+ */
+FreeIndex::Gap* FreeIndex::firstFit (Gap* _root, size_t _size, size_t& _steps) {
+    Gap* gap = _root;
+    while (gap != nullptr && gap->largest >= _size) {
+        ++_steps;
+        if (gap->left != nullptr && gap->left->largest >= _size) gap = gap->left;
+        else if (gap->size >= _size) return gap;
+        else gap = gap->right;
+    }
+    return nullptr;
+}
+
+/**
+ *  firstFitFrom
+ *
+ *  the lowest addressed gap of at least _size bytes that starts at or
+ *  after _from.
+ */
+FreeIndex::Gap* FreeIndex::firstFitFrom (Gap* _root, BytePointer _from, size_t _size, size_t& _steps) {
+    if (_root == nullptr || _root->largest < _size) return nullptr;
+
+    ++_steps;
+    if (_root->data < _from) return firstFitFrom (_root->right, _from, _size, _steps);
+
+    Gap* gap = firstFitFrom (_root->left, _from, _size, _steps);
+    if (gap != nullptr) return gap;
+    if (_root->size >= _size) return _root;
+    return firstFit (_root->right, _size, _steps);
+}
+
+/**
+ *  destroy
+ *
+ *  frees every node of a treap.
+ */
+void FreeIndex::destroy (Gap* _root) {
+    if (_root == nullptr) return;
+    destroy (_root->left);
+    destroy (_root->right);
+    delete _root;
+}
+
+/**
+ *  random
+ *
+ *  xorshift generator for treap priorities.
+ */
+unsigned FreeIndex::random () {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
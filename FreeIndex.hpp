@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  FreeIndex.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef FreeIndex_hpp
+#define FreeIndex_hpp
+
+#include "BytePointer.hpp"
+
+#include <cstddef>
+#include <map>
+#include <utility>
+
+/**
+ *  FreeIndex
+ *
+ *  An address ordered index of the free gaps in a block of memory. The
+ *  gaps are held in a treap keyed by address where every node also knows
+ *  the largest gap in its subtree, so first fit and next fit are a single
+ *  descent of the tree. Best fit uses a second index ordered by size.
+ *  Adjacent gaps are merged as they are given back, so the index only
+ *  ever holds as many nodes as there are holes in the memory.
+ */
+class FreeIndex {
+    public:
+        enum Policy { FirstFit, BestFit, NextFit };
+
+        FreeIndex (Policy _policy = FirstFit);
+       ~FreeIndex ();
+
+        /** return nullptr on fail */
+        BytePointer take (size_t _size);
+        BytePointer take (size_t _size, size_t _alignment, size_t& _padding);
+
+        void give  (BytePointer _data, size_t _size);
+        void clear ();
+
+        /** return false when no gap is exactly _data and _size */
+        bool withdraw (BytePointer _data, size_t _size);
+
+        inline size_t largest () const { return (root != nullptr) ? root->largest : 0; }
+        inline size_t count   () const { return nodes; }
+        inline Policy policy  () const { return placement; }
+
+        /** gaps looked at by the last take */
+        inline size_t searchLength () const { return steps; }
+
+    private:
+        struct Gap {
+            BytePointer data;     // start of the free gap
+            size_t      size;     // size of the free gap in bytes
+            size_t      largest;  // largest gap in this subtree
+            unsigned    priority; // heap order of the treap
+            Gap*        left;
+            Gap*        right;
+        };
+
+        FreeIndex (const FreeIndex&) = delete;
+        FreeIndex& operator= (const FreeIndex&) = delete;
+
+        static void update  (Gap* _gap);
+        static void shrink  (Gap* _root, BytePointer _key);
+        static Gap* merge   (Gap* _left, Gap* _right);
+        static void split   (Gap* _root, BytePointer _key, Gap*& _left, Gap*& _right);
+        static Gap* popMin  (Gap*& _root);
+        static Gap* popMax  (Gap*& _root);
+        static Gap* firstFit (Gap* _root, size_t _size, size_t& _steps);
+        static Gap* firstFitFrom (Gap* _root, BytePointer _from, size_t _size, size_t& _steps);
+        static void destroy (Gap* _root);
+
+        Gap* find   (size_t _size);
+        Gap* find   (size_t _size, size_t _alignment);
+        void insert (Gap* _gap);
+        void erase  (Gap* _gap);
+
+        unsigned random ();
+
+        const Policy placement; // the placement policy used by take
+        Gap*         root;      // the root of the address ordered treap
+        BytePointer  rover;     // where the next fit search resumes
+        size_t       nodes;     // the number of gaps in the index
+        size_t       steps;     // gaps looked at by the last take
+        unsigned     seed;      // state of the priority generator
+
+        std::map<std::pair<size_t, BytePointer>, Gap*> bySize; // best fit only
+};
+
+#endif /* FreeIndex_hpp */
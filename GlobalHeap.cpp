@@ -0,0 +1,181 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  GlobalHeap.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "GlobalHeap.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    // the pool once made, read by deallocate without making it
+    std::atomic<ConcurrentPool*> instance (nullptr);
+
+    // set while the calling thread is inside the pool, whose own page
+    // index and thread caches allocate and must not come back to it
+    thread_local bool busy = false;
+}
+
+/**
+ *  pool
+ *
+ *  The process wide pool, made by the first allocation.
+ */
+ConcurrentPool& GlobalHeap::pool () {
+    ConcurrentPool* made = instance.load (std::memory_order_acquire);
+    if (made != nullptr) return *made;
+
+    alignas(ConcurrentPool) static unsigned char storage[sizeof(ConcurrentPool)];
+    static ConcurrentPool* first = [] () {
+        ConcurrentPool* pool = new (storage) ConcurrentPool (GLOBAL_HEAP_SIZE);
+        instance.store (pool, std::memory_order_release);
+        return pool;
+    } ();
+    return *first;
+}
+
+/**
+ *  system
+ *
+ *  _size       the size of memory required
+ *  _alignment  a power of two
+ *
+ *  The system malloc, or aligned_alloc for alignments malloc does not
+ *  promise. returns a null pointer on failure.
+ */
+void* GlobalHeap::system (size_t _size, size_t _alignment) {
+    if (_alignment <= alignof(std::max_align_t)) return malloc (_size ? _size : 1);
+
+    // aligned_alloc takes only whole multiples of the alignment, which must not wrap
+    if (_size > size_t(-1) - _alignment + 1) return nullptr;
+    size_t size = (_size + _alignment - 1) & ~(_alignment - 1);
+    return aligned_alloc (_alignment, size ? size : _alignment);
+}
+
+/**
+ *  allocate
+ *
+ *  _size       the size of memory required
+ *  _alignment  a power of two
+ *
+ *  Rounds a small request up to a size class at least as big as its
+ *  alignment, whose blocks sit on a multiple of it, and takes it from
+ *  the calling thread's heap. Everything else, and whatever the pool
+ *  cannot serve, goes to the system. returns a null pointer on failure.
+ */
+void* GlobalHeap::allocate (size_t _size, size_t _alignment) {
+    if (!busy && _size <= SIZE_CLASS_MAX && _alignment <= GLOBAL_HEAP_ALIGNMENT) {
+        busy = true;
+        void* block = pool().allocate (std::max ({_size, _alignment, alignof(std::max_align_t)}));
+        busy = false;
+
+        if (block != nullptr) return block;
+    }
+
+    return system (_size, _alignment);
+}
+
+/**
+ *  deallocate
+ *
+ *  _data   a pointer to the data to free
+ *
+ *  Frees a block into the pool when it came from there, and to the
+ *  system otherwise. Nothing is in the pool before it is made.
+ */
+void GlobalHeap::deallocate (void* _data) {
+    if (_data == nullptr) return;
+
+    ConcurrentPool* made = instance.load (std::memory_order_acquire);
+    if (made != nullptr && made->contains (_data)) {
+        bool nested = busy;
+        busy = true;
+        made->deallocate (_data);
+        busy = nested;
+        return;
+    }
+
+    free (_data);
+}
+
+/**
+ *  contains
+ *
+ *  _data   a pointer to any memory
+ *
+ *  Whether _data lies in the pool, which never reads it.
+ */
+bool GlobalHeap::contains (void* _data) {
+    ConcurrentPool* made = instance.load (std::memory_order_acquire);
+    return made != nullptr && made->contains (_data);
+}
+
+/**
+ *  occupiedMemory
+ *
+ *  The bytes of pages the pool has handed to thread heaps.
+ */
+size_t GlobalHeap::occupiedMemory () {
+    ConcurrentPool* made = instance.load (std::memory_order_acquire);
+    return made != nullptr ? made->occupiedMemory() : 0;
+}
+
+#ifdef MEMORY_MANAGER_GLOBAL
+
+namespace {
+    /**
+     *  allocateOrThrow
+     *
+     *  _size       the size of memory required
+     *  _alignment  a power of two
+     *
+     *  what operator new promises: calls the new handler until the
+     *  allocation succeeds, and throws std::bad_alloc when there is none.
+     */
+    void* allocateOrThrow (size_t _size, size_t _alignment) {
+        for (;;) {
+            void* block = GlobalHeap::allocate (_size, _alignment);
+            if (block != nullptr) return block;
+
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void* allocateOrNull (size_t _size, size_t _alignment) noexcept {
+        try {
+            return allocateOrThrow (_size, _alignment);
+        } catch (...) {
+            return nullptr;
+        }
+    }
+}
+
+// the size a sized delete passes is not needed, the page knows it
+void* operator new   (size_t _size) { return allocateOrThrow (_size, alignof(std::max_align_t)); }
+void* operator new[] (size_t _size) { return allocateOrThrow (_size, alignof(std::max_align_t)); }
+void* operator new   (size_t _size, const std::nothrow_t&) noexcept { return allocateOrNull (_size, alignof(std::max_align_t)); }
+void* operator new[] (size_t _size, const std::nothrow_t&) noexcept { return allocateOrNull (_size, alignof(std::max_align_t)); }
+void* operator new   (size_t _size, std::align_val_t _alignment) { return allocateOrThrow (_size, (size_t)_alignment); }
+void* operator new[] (size_t _size, std::align_val_t _alignment) { return allocateOrThrow (_size, (size_t)_alignment); }
+void* operator new   (size_t _size, std::align_val_t _alignment, const std::nothrow_t&) noexcept { return allocateOrNull (_size, (size_t)_alignment); }
+void* operator new[] (size_t _size, std::align_val_t _alignment, const std::nothrow_t&) noexcept { return allocateOrNull (_size, (size_t)_alignment); }
+
+void operator delete   (void* _data) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete[] (void* _data) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete   (void* _data, size_t) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete[] (void* _data, size_t) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete   (void* _data, const std::nothrow_t&) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete[] (void* _data, const std::nothrow_t&) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete   (void* _data, std::align_val_t) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete[] (void* _data, std::align_val_t) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete   (void* _data, size_t, std::align_val_t) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete[] (void* _data, size_t, std::align_val_t) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete   (void* _data, std::align_val_t, const std::nothrow_t&) noexcept { GlobalHeap::deallocate (_data); }
+void operator delete[] (void* _data, std::align_val_t, const std::nothrow_t&) noexcept { GlobalHeap::deallocate (_data); }
+
+#endif
@@ -0,0 +1,52 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  GlobalHeap.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef GlobalHeap_hpp
+#define GlobalHeap_hpp
+
+#include "ConcurrentPool.hpp"
+
+#include <cstddef>
+
+#define GLOBAL_HEAP_SIZE      (size_t(256) << 20)    // bytes the process wide pool preallocates
+#define GLOBAL_HEAP_ALIGNMENT CONCURRENT_PAGE_HEADER // the most alignment a size class block is sure of
+
+/**
+ *  GlobalHeap
+ *
+ *  the whole process's heap routed through one ConcurrentPool, so every
+ *  thread allocates from heaps of its own by size class without a lock.
+ *  Requests bigger than SIZE_CLASS_MAX, aligned past
+ *  GLOBAL_HEAP_ALIGNMENT, made once the pool is full, or made by the
+ *  pool itself while it is busy go to the system malloc instead, and
+ *  deallocate hands anything outside the pool back to free. Built with
+ *  MEMORY_MANAGER_GLOBAL, GlobalHeap.cpp replaces the global operator
+ *  new and delete, sized and aligned forms included, so a program gets
+ *  it without touching a call site. The pool is made on first use and
+ *  never destroyed, since blocks may be freed after static destructors
+ *  have run.
+ */
+class GlobalHeap {
+    public:
+        /** return nullptr on fail */
+        static void* allocate (size_t _size, size_t _alignment = alignof(std::max_align_t));
+
+        /** anything allocate returned, or from malloc, or nullptr */
+        static void deallocate (void* _data);
+
+        /** whether _data was served by the pool rather than the system */
+        static bool contains (void* _data);
+
+        /** memory held by thread heaps, zero before the first allocation */
+        static size_t occupiedMemory ();
+
+    private:
+        GlobalHeap () = delete;
+
+        static ConcurrentPool& pool ();
+        static void*           system (size_t _size, size_t _alignment);
+};
+
+#endif /* GlobalHeap_hpp */
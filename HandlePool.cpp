@@ -0,0 +1,278 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  HandlePool.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "HandlePool.hpp"
+#include "SystemQueries.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#define HANDLE_NO_SLOT uint32_t(-1) // the end of the free slot list
+
+/**
+ *  HandlePool Constructor
+ *
+ *  _size       the amount of memory to preallocate
+ *  _backing    where the memory comes from
+ *
+ *  Preallocates the block and hands all of it to the free index. Kills
+ *  executing program on errors such as malloc failure or too much
+ *  memory requested.
+ */
+HandlePool::HandlePool (size_t _size, Backing _backing)
+    : backing (_backing), size (_size & ~(size_t)(HANDLE_ALIGNMENT - 1)),
+      freeSlot (HANDLE_NO_SLOT), used (0) {
+    if (size > memoryLimit()) {
+        std::cout << "ERROR: requested more RAM than system contains" << std::endl;
+        exit (1);
+    }
+
+    if (size == 0 || !(data = backing.acquire (size, HANDLE_ALIGNMENT, base, reserved))) {
+        std::cout << "ERROR: malloc failure" << std::endl;
+        exit (1);
+    }
+    release();
+}
+
+/**
+ *  HandlePool Destructor
+ *
+ *  Frees the block of memory
+ */
+HandlePool::~HandlePool () {
+    backing.dispose (base, reserved);
+}
+
+/**
+ *  allocate
+ *
+ *  _size   the size of memory required
+ *
+ *  Takes the first gap the rounded up block fits and gives it a slot in
+ *  the handle table, reusing the most recently freed slot if there is
+ *  one. returns Null on failure.
+ */
+HandlePool::Handle HandlePool::allocate (size_t _size) {
+    if (_size == 0) _size = 1;
+    if (_size > size) return Null;
+    _size = (_size + HANDLE_ALIGNMENT - 1) & ~(size_t)(HANDLE_ALIGNMENT - 1);
+
+    std::lock_guard<std::mutex> guard (lock);
+    if (holes.largest() < _size) return Null;
+
+    uint32_t index = freeSlot;
+    if (index == HANDLE_NO_SLOT) {
+        if (slots.size() == HANDLE_NO_SLOT) return Null;
+
+        index = (uint32_t)slots.size();
+        slots.push_back (Slot { nullptr, 0, 1, 0, HANDLE_NO_SLOT });
+    } else freeSlot = slots[index].next;
+
+    Slot& slot = slots[index];
+    slot.data = holes.take (_size);
+    slot.size = _size;
+    slot.pins = 0;
+
+    blocks[slot.data] = index;
+    used += _size;
+    return ((Handle)slot.generation << 32) | index;
+}
+
+/**
+ *  deallocate
+ *
+ *  _handle a handle from allocate
+ *
+ *  Frees the block and retires the handle, bumping the slot's generation
+ *  so the handle no longer resolves. A pinned block can still be freed.
+ *  returns true on successful deallocation, false otherwise.
+ */
+bool HandlePool::deallocate (Handle _handle) {
+    std::lock_guard<std::mutex> guard (lock);
+    Slot* slot = find (_handle);
+    if (slot == nullptr) return false;
+
+    holes.give (slot->data, slot->size);
+    blocks.erase (slot->data);
+    used -= slot->size;
+
+    // the new gap is behind the compaction, which has to come back for it
+    if (slot->data < cursor) cursor = slot->data;
+
+    uint32_t index = (uint32_t)(_handle & 0xFFFFFFFF);
+    if (++slot->generation == 0) slot->generation = 1;
+    slot->data = nullptr;
+    slot->next = freeSlot;
+    freeSlot   = index;
+    return true;
+}
+
+/**
+ *  resolve
+ *
+ *  _handle a handle from allocate
+ *
+ *  The address of the block right now. It holds until the next step of
+ *  a compaction, so a thread that compacts while others use the pool
+ *  wants pin instead. returns a null pointer when the handle is stale.
+ */
+void* HandlePool::resolve (Handle _handle) {
+    std::lock_guard<std::mutex> guard (lock);
+    Slot* slot = find (_handle);
+    return (slot != nullptr) ? slot->data : nullptr;
+}
+
+/**
+ *  pin
+ *
+ *  _handle a handle from allocate
+ *
+ *  The address of the block, which compaction leaves alone until every
+ *  pin has been matched by an unpin. returns a null pointer when the
+ *  handle is stale.
+ */
+void* HandlePool::pin (Handle _handle) {
+    std::lock_guard<std::mutex> guard (lock);
+    Slot* slot = find (_handle);
+    if (slot == nullptr) return nullptr;
+
+    ++slot->pins;
+    return slot->data;
+}
+
+/**
+ *  unpin
+ *
+ *  _handle a handle from allocate
+ *
+ *  Lets compaction move the block again once its last pin is gone.
+ *  returns false when the handle is stale or the block is not pinned.
+ */
+bool HandlePool::unpin (Handle _handle) {
+    std::lock_guard<std::mutex> guard (lock);
+    Slot* slot = find (_handle);
+    if (slot == nullptr || slot->pins == 0) return false;
+
+    // compaction stepped over the block, and the gap in front of it
+    if (--slot->pins == 0 && slot->data < cursor) cursor = slot->data;
+    return true;
+}
+
+/**
+ *  compact
+ *
+ *  _budget the time compaction may take
+ *
+ *  Slides live blocks down over the gaps in front of them, lowest
+ *  address first, until the budget is spent or the pool is dense. The
+ *  lock is taken once per block, so allocations carry on in between,
+ *  and at least one block is looked at per call. returns the number of
+ *  bytes moved.
+ */
+size_t HandlePool::compact (std::chrono::nanoseconds _budget) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + _budget;
+
+    size_t moved = 0;
+    for (;;) {
+        bool more;
+        {
+            std::lock_guard<std::mutex> guard (lock);
+            more = step (moved);
+        }
+        if (!more || Clock::now() >= deadline) return moved;
+    }
+}
+
+/**
+ *  release
+ *
+ *  Frees every block and retires every handle.
+ */
+void HandlePool::release () {
+    std::lock_guard<std::mutex> guard (lock);
+    holes.clear();
+    holes.give (data, size);
+    blocks.clear();
+
+    freeSlot = HANDLE_NO_SLOT;
+    for (size_t i = slots.size(); i > 0; --i) {
+        Slot& slot = slots[i - 1];
+        if (slot.data != nullptr && ++slot.generation == 0) slot.generation = 1;
+        slot.data = nullptr;
+        slot.next = freeSlot;
+        freeSlot  = (uint32_t)(i - 1);
+    }
+
+    cursor = data;
+    used   = 0;
+}
+
+size_t HandlePool::occupiedMemory () {
+    std::lock_guard<std::mutex> guard (lock);
+    return used;
+}
+
+size_t HandlePool::largestFree () {
+    std::lock_guard<std::mutex> guard (lock);
+    return holes.largest();
+}
+
+/**
+ *  find
+ *
+ *  _handle a handle from allocate
+ *
+ *  The live slot the handle names, or a null pointer when its slot is
+ *  out of range, free, or has been reused since.
+ */
+HandlePool::Slot* HandlePool::find (Handle _handle) {
+    uint32_t index = (uint32_t)(_handle & 0xFFFFFFFF);
+    if (index >= slots.size()) return nullptr;
+
+    Slot& slot = slots[index];
+    if (slot.data == nullptr || slot.generation != (uint32_t)(_handle >> 32)) return nullptr;
+    return &slot;
+}
+
+/**
+ *  step
+ *
+ *  _moved  increased by the bytes moved
+ *
+ *  Takes the first live block at or past the cursor and moves it down
+ *  to the end of the live block before it. Gaps are merged as they are
+ *  given back, so the space between two live blocks is always a single
+ *  gap in the index and the block leaves a single gap behind, joined to
+ *  whatever was free after it. Pinned blocks are stepped over. returns
+ *  false once there is no block left past the cursor.
+ */
+bool HandlePool::step (size_t& _moved) {
+    auto it = blocks.lower_bound (cursor);
+    if (it == blocks.end()) return false;
+
+    Slot&       slot  = slots[it->second];
+    BytePointer start = data;
+    if (it != blocks.begin()) {
+        auto before = std::prev (it);
+        start = before->first + slots[before->second].size;
+    }
+
+    if (start != slot.data && slot.pins == 0 && holes.withdraw (start, slot.data - start)) {
+        size_t gap = slot.data - start;
+        std::memmove (start, slot.data, slot.size);
+        holes.give (start + slot.size, gap);
+
+        blocks.erase (it);
+        blocks[start] = (uint32_t)(&slot - slots.data());
+        slot.data = start;
+        _moved   += slot.size;
+    }
+
+    cursor = slot.data + slot.size;
+    return true;
+}
@@ -0,0 +1,98 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  HandlePool.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef HandlePool_hpp
+#define HandlePool_hpp
+
+#include "BytePointer.hpp"
+#include "Backing.hpp"
+#include "FreeIndex.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#define HANDLE_ALIGNMENT alignof(std::max_align_t) // every block is a multiple of this, so any can move anywhere
+
+/**
+ *  HandlePool
+ *
+ *  variable size blocks reached through handles rather than addresses,
+ *  so the pool is free to move them. Blocks are placed first fit in a
+ *  single block of memory like Pool mode, and compact() slides live
+ *  blocks down over the gaps in front of them a block at a time until
+ *  its time budget runs out, so an idle thread can keep the pool dense
+ *  without ever stopping the callers for long. A handle stays valid
+ *  until its block is freed, after which it resolves to nothing, even
+ *  once its slot is reused. The address a handle resolves to only holds
+ *  until the next compaction step; pin a block to keep it in place
+ *  while it is used from another thread.
+ */
+class HandlePool {
+    public:
+        typedef uint64_t Handle; // the slot in the low half, its generation in the high
+
+        static constexpr Handle Null = 0;
+
+        HandlePool (size_t _size, Backing _backing = Backing());
+       ~HandlePool ();
+
+        /** return Null on fail */
+        Handle allocate (size_t _size);
+
+        /** return false when _handle is not live */
+        bool deallocate (Handle _handle);
+
+        /** where the block is now, return nullptr when _handle is not live */
+        void* resolve (Handle _handle);
+
+        /** keeps the block where it is until unpinned, return nullptr when _handle is not live */
+        void* pin   (Handle _handle);
+        bool  unpin (Handle _handle);
+
+        /** moves blocks until _budget runs out or nothing is left to move, returns the bytes moved */
+        size_t compact (std::chrono::nanoseconds _budget);
+
+        void release ();
+
+        size_t occupiedMemory ();
+        size_t largestFree    ();
+        inline size_t totalMemory () const { return size; }
+        inline size_t freeMemory  () { return size - occupiedMemory(); }
+
+    private:
+        struct Slot {
+            BytePointer data;       // the block, null while the slot is free
+            size_t      size;       // its size rounded up to HANDLE_ALIGNMENT
+            uint32_t    generation; // bumped every time the block is freed
+            uint32_t    pins;       // pin calls not yet unpinned
+            uint32_t    next;       // the next free slot, while this one is free
+        };
+
+        HandlePool (const HandlePool&) = delete;
+        HandlePool& operator= (const HandlePool&) = delete;
+
+        Slot* find (Handle _handle);
+        bool  step (size_t& _moved);
+
+        const Backing backing;  // where the block came from
+        BytePointer   base;     // what the backing returned
+        size_t        reserved; // bytes the backing reserved
+        BytePointer   data;     // the handle to the preallocated memory
+        size_t        size;     // the total size of the preallocated memory
+
+        std::mutex                         lock;     // every call takes it, compaction once per step
+        FreeIndex                          holes;    // free gaps in the block
+        std::map<BytePointer, uint32_t>    blocks;   // live blocks in address order, to their slot
+        std::vector<Slot>                  slots;    // the handle table
+        uint32_t                           freeSlot; // the most recently freed slot
+        BytePointer                        cursor;   // where the next compaction step looks from
+        size_t                             used;     // bytes in live blocks
+};
+
+#endif /* HandlePool_hpp */
@@ -9,59 +9,93 @@
 /**
  *  MemoryManager Constructor
  *
- *  _mode   the type of the allocator object
- *  _size   the amount of memory to preallocate
+ *  _mode       the type of the allocator object
+ *  _size       the amount of memory to preallocate
+ *  _policy     where Pool mode places new blocks in its free gaps
+ *  _growth     how to grow once the preallocated memory is full
+ *  _backing    where the memory comes from
  *
  *  Constructs a Memory Manager object of the given mode and size.
  *  Reports system memory and kills executing program on errors such as
  *  malloc failure or too much memory requested.
  */
-MemoryManager::MemoryManager (Mode _mode, size_t _size)
-    : mode (_mode), size (_size), used (0) {
+MemoryManager::MemoryManager (Mode _mode, size_t _size, FreeIndex::Policy _policy, Growth _growth, Backing _backing)
+    : mode (_mode) {
     std::cout << std::endl;
     std::cout << "SYSTEM MEMORY: " << totalSystemMemory() << " Bytes";
     std::cout << std::endl;
-    
-    if (size > totalSystemMemory()) {
-        std::cout << "ERROR: requested more RAM than system contains" << std::endl;
-        exit (1);
-    }
- 
-    if (!(data = (char*)malloc(size))) {
-        std::cout << "ERROR: malloc failure" << std::endl;
-        exit (1);
+
+    switch (mode) {
+        case Stack:  new (&stack)  StackManager  (_size, _growth, _backing); break;
+        case Queue:  new (&queue)  QueueManager  (_size, _growth, _backing); break;
+        case Pool:   new (&pool)   PoolManager   (_size, _growth, _backing, _policy); break;
+        case Bitmap: new (&bitmap) BitmapManager (_size, _growth, _backing); break;
+        case Buddy:  new (&buddy)  BuddyManager  (_size, _growth, _backing); break;
+        case TLSF:   new (&tlsf)   TLSFManager   (_size, _growth, _backing); break;
     }
 }
 
+/**
+ *  MemoryManager Constructor
+ *
+ *  _mode       the type of the allocator object
+ *  _size       the amount of memory to preallocate
+ *  _growth     how to grow once the preallocated memory is full
+ *  _backing    where the memory comes from
+ *
+ *  A growable manager with first fit placement.
+ */
+MemoryManager::MemoryManager (Mode _mode, size_t _size, Growth _growth, Backing _backing)
+    : MemoryManager (_mode, _size, FreeIndex::FirstFit, _growth, _backing) {}
+
+/**
+ *  MemoryManager Constructor
+ *
+ *  _mode       the type of the allocator object
+ *  _size       the amount of memory to preallocate
+ *  _backing    where the memory comes from
+ *
+ *  A fixed size manager with first fit placement.
+ */
+MemoryManager::MemoryManager (Mode _mode, size_t _size, Backing _backing)
+    : MemoryManager (_mode, _size, FreeIndex::FirstFit, Growth { Growth::None, 0, 0 }, _backing) {}
+
 /**
  *  MemoryManager Destructor
  *
- *  Frees the block of memory
+ *  Destroys the manager for the mode, which frees the memory
  */
 MemoryManager::~MemoryManager () {
-    free (data);
+    switch (mode) {
+        case Stack:  stack.~StackManager();   break;
+        case Queue:  queue.~QueueManager();   break;
+        case Pool:   pool.~PoolManager();     break;
+        case Bitmap: bitmap.~BitmapManager(); break;
+        case Buddy:  buddy.~BuddyManager();   break;
+        case TLSF:   tlsf.~TLSFManager();     break;
+    }
 }
 
 /**
  *  allocate
  *
- *  _size   the size of memory required
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *  _site       where the call was made, for debug reports
  *
  *  Passes the size to the appropriate allocation function with a kind
  *  of enum based manual polymorphism. returns a null pointer on failure.
  */
-void* MemoryManager::allocate (size_t _size) {
-    if ((used + _size) < size) {
-        // allocataion is safe, continue
-        switch (mode) {
-            case Stack: return StackMalloc(_size);
-            case Queue: return QueueMalloc(_size);
-            case Pool:  return PoolMalloc (_size);
-        }
-    } else {
-        // allocation will overflow data, fail
-        return nullptr;
+void* MemoryManager::allocate (size_t _size, size_t _alignment, Site _site) {
+    switch (mode) {
+        case Stack:  return stack.allocate  (_size, _alignment, _site);
+        case Queue:  return queue.allocate  (_size, _alignment, _site);
+        case Pool:   return pool.allocate   (_size, _alignment, _site);
+        case Bitmap: return bitmap.allocate (_size, _alignment, _site);
+        case Buddy:  return buddy.allocate  (_size, _alignment, _site);
+        case TLSF:   return tlsf.allocate   (_size, _alignment, _site);
     }
+    return nullptr;
 }
 
 /**
@@ -75,220 +109,199 @@ void* MemoryManager::allocate (size_t _size) {
  */
 bool MemoryManager::deallocate (void* _data) {
     switch (mode) {
-        case Stack: return StackFree(_data);
-        case Queue: return QueueFree(_data);
-        case Pool:  return PoolFree (_data);
+        case Stack:  return stack.deallocate  (_data);
+        case Queue:  return queue.deallocate  (_data);
+        case Pool:   return pool.deallocate   (_data);
+        case Bitmap: return bitmap.deallocate (_data);
+        case Buddy:  return buddy.deallocate  (_data);
+        case TLSF:   return tlsf.deallocate   (_data);
     }
+    return false;
 }
 
 /**
- *  release
+ *  allocateBatch
  *
- *  cleares all data from the pool, using a switch statement to call the
- *  implementation appropriate method.
+ *  _size       the size of every block
+ *  _count      the number of blocks
+ *  _out        set to the blocks
+ *  _alignment  the power of two every address must be a multiple of
+ *
+ *  Allocates _count equal blocks in one call. Pool mode carves them as
+ *  one run from a single gap when it can. returns false, having
+ *  allocated nothing, on failure.
  */
-void MemoryManager::release () {
+bool MemoryManager::allocateBatch (size_t _size, size_t _count, void** _out, size_t _alignment) {
     switch (mode) {
-        case Stack: return StackRelease();
-        case Queue: return QueueRelease();
-        case Pool:  return PoolRelease();
+        case Stack:  return stack.allocateBatch  (_size, _count, _out, _alignment);
+        case Queue:  return queue.allocateBatch  (_size, _count, _out, _alignment);
+        case Pool:   return pool.allocateBatch   (_size, _count, _out, _alignment);
+        case Bitmap: return bitmap.allocateBatch (_size, _count, _out, _alignment);
+        case Buddy:  return buddy.allocateBatch  (_size, _count, _out, _alignment);
+        case TLSF:   return tlsf.allocateBatch   (_size, _count, _out, _alignment);
     }
+    return false;
 }
 
 /**
- *  reportStatus
+ *  deallocate
  *
- *  outputs the status of the memory manager to the console.
+ *  _data   the blocks to free, reordered
+ *  _count  the number of blocks
+ *
+ *  Frees a batch of blocks in one call. Pool mode sorts them and gives
+ *  each run of neighbours back to the free index at once; Stack and
+ *  Queue free them in the order given, as far as their order allows.
+ *  returns the number freed, which are moved to the front of _data.
  */
-void MemoryManager::reportStatus() {
-    std::cout << "free memory:     " << freeMemory() << " Bytes" << std::endl;
-    std::cout << "occupied memory: " << occupiedMemory() << " Bytes" << std::endl;
-    std::cout << "total memory:    " << size << " Bytes" << std::endl;
-    std::cout << std::endl;
+size_t MemoryManager::deallocate (void** _data, size_t _count) {
+    switch (mode) {
+        case Stack:  return stack.deallocate  (_data, _count);
+        case Queue:  return queue.deallocate  (_data, _count);
+        case Pool:   return pool.deallocate   (_data, _count);
+        case Bitmap: return bitmap.deallocate (_data, _count);
+        case Buddy:  return buddy.deallocate  (_data, _count);
+        case TLSF:   return tlsf.deallocate   (_data, _count);
+    }
+    return 0;
 }
 
 /**
- *  StackMalloc
- *
- *  _size   the size of memory required
+ *  release
  *
- *  Allocates memory using the stack implementation.
+ *  cleares all data from the pool, using a switch statement to call the
+ *  implementation appropriate method. Mapped memory then hands its pages
+ *  back to the system until they are next touched.
  */
-BytePointer MemoryManager::StackMalloc (size_t _size) {
-    Node n;
-    n.size = _size;
-    n.data = data + used;
-    used += _size;
-    stack.push(n);
-    return stack.top().data;
+void MemoryManager::release () {
+    switch (mode) {
+        case Stack:  return stack.release();
+        case Queue:  return queue.release();
+        case Pool:   return pool.release();
+        case Bitmap: return bitmap.release();
+        case Buddy:  return buddy.release();
+        case TLSF:   return tlsf.release();
+    }
 }
 
 /**
- *  QueueMalloc
- *
- *  _size   the size of memory required
+ *  getMarker
  *
- *  Allocates memory using the queue implementation.
+ *  How deep the stack is right now, for freeToMarker. Only Stack mode
+ *  has markers; the other modes return a marker freeToMarker refuses.
  */
-BytePointer MemoryManager::QueueMalloc (size_t _size) {
-    Node n;
-    n.size = _size;
-    n.data = data + used;
-    used += _size;
-    queue.push_back (n);
-    return queue.back().data;
+MemoryManager::Marker MemoryManager::getMarker () {
+    return (mode == Stack) ? stack.getMarker() : Marker { size_t(-1) };
 }
 
 /**
- *  PoolMalloc
+ *  freeToMarker
  *
- *  _size   the size of memory required
+ *  _marker a marker from getMarker
  *
- *  Allocates memory using the pool implemenation
+ *  Pops every block allocated since the marker was taken, rolling the
+ *  stack back in one step. returns false outside Stack mode, or when
+ *  blocks below the marker have been freed since.
  */
-BytePointer MemoryManager::PoolMalloc  (size_t _size) {
-    // if the pool is empty we can just throw it in...
-    if (pool.empty()) {
-        Node n;
-        n.size = _size;
-        n.data = data + used;
-        used += _size;
-        pool.push_back (n);
-        return n.data;
-    }
-    
-    // likewise if there's space free at the back...
-    else if ((data + size) - (pool.back().data + pool.back().size + _size) >= size) {
-        Node n;
-        n.size = _size;
-        n.data = data + used;
-        used += _size;
-        pool.push_back (n);
-        return n.data;
-    }
-    
-    // ... or the front...
-    else if ((pool.front().data) - (data) >= _size) {
-        Node n;
-        n.size = _size;
-        n.data = data + used;
-        used += _size;
-        pool.insert(pool.begin(), n);
-        return n.data;
-    }
-    
-    // ...otherwise, try find space elsewhere
-    else {
-        // find the biggest gap in the block
-        std::vector<Node>::iterator it;
-        for (it = pool.begin(); it != pool.end(); ++it) {
-            size_t gap = (*(it + 1)).data - ((*it).data + (*it).size);
-            if (gap >= _size) {
-                Node n;
-                n.size = _size;
-                n.data = data + used;
-                used += _size;
-                pool.insert (it, n);
-                return n.data;
-            }
-        }
-    }
-    
-    // if we get to here there's no space, give em null
-    return nullptr;
+bool MemoryManager::freeToMarker (Marker _marker) {
+    return (mode == Stack) && stack.freeToMarker (_marker);
 }
 
 /**
- *  StackFree
+ *  allocateHigh
  *
- *  _data   a pointer to the data to free
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *  _site       where the call was made, for debug reports
  *
- *  Deallocates memory using the stack method. _data must be the
- *  address of the top node in the data, otherwise deallocation fails.
+ *  Bumps a block down from the top of the preallocated memory, the
+ *  other end from the one allocate bumps up from. Stack mode only.
+ *  returns a null pointer on failure.
  */
-bool MemoryManager::StackFree (void* _data) {
-    if (!stack.empty()) {
-        if (_data == stack.top().data) {
-            used -= stack.top().size;
-            stack.pop();
-            return true;
-        } else return false;
-    } else return false;
+void* MemoryManager::allocateHigh (size_t _size, size_t _alignment, Site _site) {
+    return (mode == Stack) ? stack.allocateHigh (_size, _alignment, _site) : nullptr;
 }
 
 /**
- *  QueueFree
+ *  freeable
  *
- *  _data   a pointer to the data to free
+ *  _data   a pointer to the data to check
  *
- *  Deallocates memory using the queue method. _data must be the
- *  address of the front of back node in the data, otherwise deallocation
- *  fails.
+ *  Whether deallocate would accept _data right now, so objects are only
+ *  destroyed when their memory can actually be freed.
  */
-bool MemoryManager::QueueFree (void* _data) {
-    if (!queue.empty()) {
-        if (_data == queue.back().data) {
-            used -= queue.back().size;
-            queue.pop_back();
-            return true;
-        }
-        else if (_data == queue.front().data) {
-            used -= queue.front().size;
-            queue.pop_front();
-            return true;
-        } else return false;
-    } else return false;
+bool MemoryManager::freeable (void* _data) {
+    switch (mode) {
+        case Stack:  return stack.freeable  (_data);
+        case Queue:  return queue.freeable  (_data);
+        case Pool:   return pool.freeable   (_data);
+        case Bitmap: return bitmap.freeable (_data);
+        case Buddy:  return buddy.freeable  (_data);
+        case TLSF:   return tlsf.freeable   (_data);
+    }
+    return false;
 }
 
 /**
- *  PoolFree
- *
- *  _data   a pointer to the data to free
+ *  occupiedMemory
  *
- *  Deallocates memory using the queue method. Deallocation fails
- *  when _data is not the pointer for any Node in the structure.
+ *  the bytes handed out, padding and all.
  */
-bool MemoryManager::PoolFree  (void* _data) {
-    if (!pool.empty()) {
-        // search the pool for a node that starts at _data
-        std::vector<Node>::iterator it;
-        for (it = pool.begin(); it != pool.end(); ++it) {
-            if ((*it).data == _data) {
-                used -= (*it).size;
-                pool.erase(it);
-                return true;
-            }
-        }
-        return false;
-    } else return false;
+size_t MemoryManager::occupiedMemory () {
+    switch (mode) {
+        case Stack:  return stack.occupiedMemory();
+        case Queue:  return queue.occupiedMemory();
+        case Pool:   return pool.occupiedMemory();
+        case Bitmap: return bitmap.occupiedMemory();
+        case Buddy:  return buddy.occupiedMemory();
+        case TLSF:   return tlsf.occupiedMemory();
+    }
+    return 0;
 }
 
 /**
- *  StackRelease
+ *  totalMemory
  *
- *  pops all Node's from the stack
+ *  the bytes in every chunk of the manager.
  */
-void MemoryManager::StackRelease () {
-    used = 0;
-    while (!stack.empty()) stack.pop();
+size_t MemoryManager::totalMemory () {
+    switch (mode) {
+        case Stack:  return stack.totalMemory();
+        case Queue:  return queue.totalMemory();
+        case Pool:   return pool.totalMemory();
+        case Bitmap: return bitmap.totalMemory();
+        case Buddy:  return buddy.totalMemory();
+        case TLSF:   return tlsf.totalMemory();
+    }
+    return 0;
 }
 
 /**
- *  QueueRelease
+ *  statistics
  *
- *  clears the queue
+ *  a snapshot of the manager's counters and memory. The counters are
+ *  only kept when built with MEMORY_MANAGER_STATS.
  */
-void MemoryManager::QueueRelease () {
-    used = 0;
-    queue.clear();
+Statistics MemoryManager::statistics () {
+    switch (mode) {
+        case Stack:  return stack.statistics();
+        case Queue:  return queue.statistics();
+        case Pool:   return pool.statistics();
+        case Bitmap: return bitmap.statistics();
+        case Buddy:  return buddy.statistics();
+        case TLSF:   return tlsf.statistics();
+    }
+    return Statistics {};
 }
 
 /**
- *  PoolRelease
+ *  reportStatus
  *
- *  clears the pool
+ *  outputs the status of the memory manager to the console.
  */
-void MemoryManager::PoolRelease  () {
-    used = 0;
-    pool.clear();
+void MemoryManager::reportStatus() {
+    std::cout << "free memory:     " << freeMemory() << " Bytes" << std::endl;
+    std::cout << "occupied memory: " << occupiedMemory() << " Bytes" << std::endl;
+    std::cout << "total memory:    " << totalMemory() << " Bytes" << std::endl;
+    std::cout << std::endl;
 }
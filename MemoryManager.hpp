@@ -7,54 +7,216 @@
 #define MemoryManager_hpp
 
 #include "BytePointer.hpp"
-#include "Node.hpp"
+#include "FreeIndex.hpp"
+#include "Backing.hpp"
+#include "Region.hpp"
+#include "Stats.hpp"
+#include "Trace.hpp"
+#include "Debug.hpp"
+#include "BasicMemoryManager.hpp"
+#include "StackStrategy.hpp"
+#include "QueueStrategy.hpp"
+#include "PoolStrategy.hpp"
+#include "BitmapStrategy.hpp"
+#include "BuddyStrategy.hpp"
+#include "TLSFStrategy.hpp"
 
 #include <iostream>
-#include <vector>
-#include <stack>
-#include <deque>
+#include <cstddef>
+#include <new>
+#include <utility>
 
+/**
+ *  MemoryManager
+ *
+ *  the strategy picked at run time. A thin facade over the six
+ *  BasicMemoryManager instantiations that only ever holds the one its
+ *  mode asks for, and switches on the mode to reach it. Code that knows
+ *  its strategy up front should use BasicMemoryManager directly. Built
+ *  with MEMORY_MANAGER_STATS it keeps Stats, built with
+ *  MEMORY_MANAGER_TRACE it writes every call to the global TraceRecorder,
+ *  and built with MEMORY_MANAGER_DEBUG every block is Guarded.
+ */
 class MemoryManager {
     public:
-        enum Mode { Stack, Queue, Pool };
+        enum Mode { Stack, Queue, Pool, Bitmap, Buddy, TLSF };
+        enum Alignment : size_t {
+            Default   = alignof(std::max_align_t),
+            CacheLine = 64,   // keeps neighbouring blocks off each other's lines
+            Page      = 4096  // the smallest page on every supported platform
+        };
+
+        typedef ::Growth Growth;
+        typedef StackStrategy::Marker Marker;
     
-        MemoryManager (Mode _mode, size_t _size);
+        MemoryManager (Mode _mode, size_t _size, FreeIndex::Policy _policy = FreeIndex::FirstFit,
+                       Growth _growth = Growth { Growth::None, 0, 0 }, Backing _backing = Backing());
+        MemoryManager (Mode _mode, size_t _size, Growth _growth, Backing _backing = Backing());
+        MemoryManager (Mode _mode, size_t _size, Backing _backing);
        ~MemoryManager ();
 
-        void*  allocate (size_t _size);
+        /** _site, MEMORY_MANAGER_SITE say, is kept for reports when built with MEMORY_MANAGER_DEBUG */
+        void*  allocate (size_t _size, size_t _alignment = Default, Site _site = Site());
         bool deallocate (void*  _data);
+
+        /** _count blocks at once, all or nothing, return false on fail */
+        bool   allocateBatch (size_t _size, size_t _count, void** _out, size_t _alignment = Default);
+        size_t deallocate    (void** _data, size_t _count);
         void release ();
+
+        /** Stack mode only: roll back to a marker, or bump from the other end */
+        Marker getMarker    ();
+        bool   freeToMarker (Marker _marker);
+        void*  allocateHigh (size_t _size, size_t _alignment = Default, Site _site = Site());
+    
+        /** construct objects in place, return nullptr on fail */
+        template <class T, class... Args>
+        T* create (Args&&... _args);
+        template <class T>
+        T* createArray (size_t _count);
     
-        inline size_t occupiedMemory () { return used; }
-        inline size_t totalMemory    () { return size; }
-        inline size_t freeMemory     () { return size - used; }
+        /** destroy objects and free their memory, return false on fail */
+        template <class T>
+        bool destroy (T* _data);
+        template <class T>
+        bool destroyArray (T* _data, size_t _count);
+    
+        size_t occupiedMemory ();
+        size_t totalMemory    ();
+        inline size_t freeMemory () { return totalMemory() - occupiedMemory(); }
+
+        Statistics statistics ();
+
+        /** whether blocks carry Guarded records and red zones, so they are bigger than asked for */
+        static constexpr bool guarded () { return DebugPolicy::Enabled; }
+
+        /** what a block of _size takes from the strategy, record and red zones included */
+        static size_t span (size_t _size, size_t _alignment = Default) { return DebugPolicy().span (_size, _alignment); }
 
         void reportStatus ();
     
     private:
+        // counting and tracing are opt in, so the default build has no overhead
+#ifdef MEMORY_MANAGER_STATS
+        typedef Stats   CountPolicy;
+#else
+        typedef NoStats CountPolicy;
+#endif
+#ifdef MEMORY_MANAGER_TRACE
+        typedef Traced<CountPolicy> StatsPolicy;
+#else
+        typedef CountPolicy         StatsPolicy;
+#endif
+#ifdef MEMORY_MANAGER_DEBUG
+        typedef Guarded DebugPolicy;
+#else
+        typedef NoDebug DebugPolicy;
+#endif
+
+        typedef BasicMemoryManager<StackStrategy,  SingleThreaded, Backing, StatsPolicy, DebugPolicy> StackManager;
+        typedef BasicMemoryManager<QueueStrategy,  SingleThreaded, Backing, StatsPolicy, DebugPolicy> QueueManager;
+        typedef BasicMemoryManager<PoolStrategy,   SingleThreaded, Backing, StatsPolicy, DebugPolicy> PoolManager;
+        typedef BasicMemoryManager<BitmapStrategy, SingleThreaded, Backing, StatsPolicy, DebugPolicy> BitmapManager;
+        typedef BasicMemoryManager<BuddyStrategy,  SingleThreaded, Backing, StatsPolicy, DebugPolicy> BuddyManager;
+        typedef BasicMemoryManager<TLSFStrategy,   SingleThreaded, Backing, StatsPolicy, DebugPolicy> TLSFManager;
+
+        MemoryManager (const MemoryManager&) = delete;
+        MemoryManager& operator= (const MemoryManager&) = delete;
     
-        /** return nullptr on fail */
-        BytePointer StackMalloc (size_t _size);
-        BytePointer QueueMalloc (size_t _size);
-        BytePointer PoolMalloc  (size_t _size);
-    
-        /** return false on fail */
-        bool StackFree (void* _data);
-        bool QueueFree (void* _data);
-        bool PoolFree  (void* _data);
-    
-        void StackRelease ();
-        void QueueRelease ();
-        void PoolRelease  ();
+        /** whether deallocate would accept _data right now */
+        bool freeable (void* _data);
     
-        const Mode  mode;    // the strategy employed by this instance of a manager
-        BytePointer data;    // the handle to the preallocated memory
-
-        std::vector<Node> pool;
-        std::stack <Node> stack;
-        std::deque <Node> queue;
-        size_t   size;      // the total size of the preallocated memory
-        size_t   used;      // the total size of used memory
+        const Mode mode; // the strategy employed by this instance of a manager
+
+        // only the member for the mode is ever constructed
+        union {
+            StackManager  stack;
+            QueueManager  queue;
+            PoolManager   pool;
+            BitmapManager bitmap;
+            BuddyManager  buddy;
+            TLSFManager   tlsf;
+        };
 };
 
+/**
+ *  create
+ *
+ *  _args   forwarded to the constructor of T
+ *
+ *  Allocates memory aligned for a T and constructs one in it. If the
+ *  constructor throws the memory is freed before the exception leaves.
+ */
+template <class T, class... Args>
+T* MemoryManager::create (Args&&... _args) {
+    void* block = allocate (sizeof(T), alignof(T));
+    if (block == nullptr) return nullptr;
+
+    try {
+        return new (block) T (std::forward<Args>(_args)...);
+    } catch (...) {
+        deallocate (block);
+        throw;
+    }
+}
+
+/**
+ *  createArray
+ *
+ *  _count  the number of objects
+ *
+ *  Allocates memory for _count objects of type T and value initialises
+ *  each of them. Objects already built are destroyed if one throws.
+ */
+template <class T>
+T* MemoryManager::createArray (size_t _count) {
+    if (_count > size_t(-1) / sizeof(T)) return nullptr;
+
+    T* block = (T*)allocate (_count * sizeof(T), alignof(T));
+    if (block == nullptr) return nullptr;
+
+    size_t built = 0;
+    try {
+        for (; built < _count; ++built) new (block + built) T ();
+    } catch (...) {
+        while (built > 0) block[--built].~T();
+        deallocate (block);
+        throw;
+    }
+    return block;
+}
+
+/**
+ *  destroy
+ *
+ *  _data   an object made by create
+ *
+ *  Runs the destructor of T and frees its memory. Like deallocate this
+ *  fails when the mode will not free _data, in which case the object
+ *  is left alone.
+ */
+template <class T>
+bool MemoryManager::destroy (T* _data) {
+    if (!freeable ((void*)_data)) return false;
+
+    _data->~T();
+    return deallocate ((void*)_data);
+}
+
+/**
+ *  destroyArray
+ *
+ *  _data   an array made by createArray
+ *  _count  the number of objects it was made with
+ *
+ *  Runs the destructors in reverse order and frees the memory.
+ */
+template <class T>
+bool MemoryManager::destroyArray (T* _data, size_t _count) {
+    if (!freeable ((void*)_data)) return false;
+
+    while (_count > 0) _data[--_count].~T();
+    return deallocate ((void*)_data);
+}
+
 #endif /* MemoryManager_hpp */
@@ -0,0 +1,59 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  MemoryManagerAllocator.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef MemoryManagerAllocator_hpp
+#define MemoryManagerAllocator_hpp
+
+#include "MemoryManager.hpp"
+
+#include <cstddef>
+#include <new>
+
+/**
+ *  MemoryManagerAllocator
+ *
+ *  A standard allocator drawing from a MemoryManager, so containers such
+ *  as std::vector and std::unordered_map keep their nodes and buffers in
+ *  a preallocated block instead of the global heap. Copies share the
+ *  manager, which must outlive every container using it. Pool mode is
+ *  the natural fit; Stack and Queue only work for containers that free
+ *  in the order those modes allow.
+ */
+template <class T>
+class MemoryManagerAllocator {
+    public:
+        typedef T value_type;
+
+        MemoryManagerAllocator (MemoryManager& _manager) noexcept : manager (&_manager) {}
+
+        template <class U>
+        MemoryManagerAllocator (const MemoryManagerAllocator<U>& _other) noexcept : manager (_other.manager) {}
+
+        /** throws std::bad_alloc on fail, as containers expect */
+        T* allocate (size_t _count) {
+            if (_count > size_t(-1) / sizeof(T)) throw std::bad_alloc();
+
+            void* block = manager->allocate (_count * sizeof(T), alignof(T));
+            if (block == nullptr) throw std::bad_alloc();
+            return (T*)block;
+        }
+
+        void deallocate (T* _data, size_t) noexcept {
+            manager->deallocate (_data);
+        }
+
+        template <class U>
+        bool operator== (const MemoryManagerAllocator<U>& _other) const noexcept { return manager == _other.manager; }
+
+        template <class U>
+        bool operator!= (const MemoryManagerAllocator<U>& _other) const noexcept { return manager != _other.manager; }
+
+    private:
+        template <class U> friend class MemoryManagerAllocator;
+
+        MemoryManager* manager; // the manager every copy draws from
+};
+
+#endif /* MemoryManagerAllocator_hpp */
@@ -0,0 +1,251 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  PoolStrategy.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef PoolStrategy_hpp
+#define PoolStrategy_hpp
+
+#include "BytePointer.hpp"
+#include "FreeIndex.hpp"
+#include "BlockTable.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+/**
+ *  PoolStrategy
+ *
+ *  variable size blocks freed in any order. The free gaps are kept in an
+ *  address ordered index so finding one is O(log n) whatever the number
+ *  of live blocks, and live blocks are found by address in a hash table.
+ *  The padding needed to align a block counts as used until the block
+ *  is freed. When no gap fits the region grows and the new chunk is
+ *  given to the index; a chunk left empty is withdrawn again once the
+ *  region wants it back. Batches of equal blocks are carved from one
+ *  gap and batches of frees are merged before they reach the index.
+ */
+class PoolStrategy {
+    public:
+        template <class Region>
+        explicit PoolStrategy (Region& _region, FreeIndex::Policy _policy = FreeIndex::FirstFit)
+            : holes (_policy), failedSize (size_t(-1)), failedAlignment (0) {
+            holes.give (_region.chunk (0)->begin, _region.chunk (0)->size);
+        }
+
+        /** return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocate (Region& _region, size_t _size, size_t _alignment) {
+            // every block needs an address of its own, even an empty one
+            if (_size == 0) _size = 1;
+
+            // nothing has been freed since a block this size and alignment
+            // failed, and allocating only makes the gaps smaller
+            if (_size >= failedSize && _alignment >= failedAlignment) return nullptr;
+
+            // no gap is even big enough for the block, skip the search
+            size_t      padding;
+            BytePointer block = (holes.largest() >= _size) ? holes.take (_size, _alignment, padding) : nullptr;
+            if (block == nullptr && !(block = grow (_region, _size, _alignment, padding))) {
+                failedSize      = _size;
+                failedAlignment = _alignment;
+                return nullptr;
+            }
+
+            _region.enter (_region.chunkOf (block));
+            pool.insert (block, _size, padding);
+            _region.occupy (padding + _size);
+            _region.allocated (block, _size);
+            return block;
+        }
+
+        /** return false when _data is not a live block */
+        template <class Region>
+        inline bool deallocate (Region& _region, void* _data) {
+            size_t blockSize, padding;
+            if (!pool.remove ((BytePointer)_data, blockSize, padding)) return false;
+
+            holes.give ((BytePointer)_data - padding, padding + blockSize);
+            _region.vacate (padding + blockSize);
+            _region.freed (_data, blockSize);
+            failedSize = size_t(-1);
+
+            // the chunk header keeps its gap from merging with a neighbour,
+            // so an empty chunk is always exactly one gap
+            auto chunk = _region.chunkOf (_data);
+            if (_region.leave (chunk) && holes.withdraw (chunk->begin, chunk->size)) _region.drop (chunk);
+            return true;
+        }
+
+        /** all or nothing, return false on fail */
+        template <class Region>
+        bool allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out);
+
+        /** returns the number freed, moved to the front of _data */
+        template <class Region>
+        size_t deallocateBatch (Region& _region, void** _data, size_t _count);
+
+        template <class Region>
+        void release (Region& _region);
+
+        template <class Region>
+        inline bool freeable (Region& _region, void* _data) const { return pool.contains ((BytePointer)_data); }
+
+        /** the biggest block that fits without growing */
+        template <class Region>
+        inline size_t largestFree (const Region& _region) const { return holes.largest(); }
+
+        /** gaps looked at by the last successful allocate */
+        inline size_t searchLength () const { return holes.searchLength(); }
+
+    private:
+        template <class Region>
+        BytePointer grow (Region& _region, size_t _size, size_t _alignment, size_t& _padding);
+
+        BlockTable pool;            // live blocks by address
+        FreeIndex  holes;           // free gaps in every chunk
+        size_t     failedSize;      // the last request to fail since a block was freed
+        size_t     failedAlignment; // and its alignment
+};
+
+/**
+ *  allocateBatch
+ *
+ *  _region     the region the pool allocates from
+ *  _size       the size of every block
+ *  _alignment  the power of two every address must be a multiple of
+ *  _count      the number of blocks
+ *  _out        set to the blocks, in address order when carved
+ *
+ *  Carves the blocks as one run from a single gap, each block padded
+ *  to the alignment, so the whole batch costs one search. The padding
+ *  between blocks belongs to the block after it, and each block can
+ *  be freed on its own. Falls back to one allocation per block when no
+ *  gap holds the run, freeing them again if one fails.
+ */
+template <class Region>
+bool PoolStrategy::allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out) {
+    if (_count == 0) return true;
+    if (_size == 0) _size = 1;
+
+    size_t stride = (_size + _alignment - 1) & ~(_alignment - 1);
+    if (stride < _size || _count > (size_t(-1) - _size) / stride) return false;
+
+    size_t      bytes = (_count - 1) * stride + _size;
+    size_t      padding;
+    BytePointer run = (holes.largest() >= bytes) ? holes.take (bytes, _alignment, padding) : nullptr;
+    if (run == nullptr) run = grow (_region, bytes, _alignment, padding);
+
+    if (run != nullptr) {
+        auto chunk = _region.chunkOf (run);
+        for (size_t i = 0; i < _count; ++i) {
+            _out[i] = run + i * stride;
+            _region.enter (chunk);
+            pool.insert ((BytePointer)_out[i], _size, (i == 0) ? padding : stride - _size);
+            _region.allocated (_out[i], _size);
+        }
+        _region.occupy (padding + bytes);
+        return true;
+    }
+
+    for (size_t i = 0; i < _count; ++i) {
+        if ((_out[i] = allocate (_region, _size, _alignment)) == nullptr) {
+            while (i > 0) deallocate (_region, _out[--i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ *  deallocateBatch
+ *
+ *  _region the region the pool allocates from
+ *  _data   the blocks to free, sorted in place
+ *  _count  the number of blocks
+ *
+ *  Sorts the blocks by address and frees them in one pass, merging
+ *  neighbours into runs so the index sees one gap per run instead of
+ *  one per block. Blocks of a chunk are next to each other once sorted,
+ *  so a chunk that empties is handed back when the pass leaves it.
+ *  Anything that is not a live block, or is in the batch twice, is
+ *  skipped and left behind the freed blocks.
+ */
+template <class Region>
+size_t PoolStrategy::deallocateBatch (Region& _region, void** _data, size_t _count) {
+    std::sort (_data, _data + _count);
+
+    size_t      freed = 0;
+    BytePointer begin = nullptr, end = nullptr;
+    typename Region::Chunk *chunk = nullptr, *emptied = nullptr;
+
+    for (size_t i = 0; i <= _count; ++i) {
+        bool        last  = (i == _count);
+        BytePointer block = last ? nullptr : (BytePointer)_data[i];
+        size_t      blockSize = 0, padding = 0;
+        if (!last && (block == nullptr || !pool.remove (block, blockSize, padding))) continue;
+
+        // a run ends at a block in use, a chunk boundary or the end of the batch
+        auto owner = last ? nullptr : _region.chunkOf (block);
+        if (last || block - padding != end || owner != chunk) {
+            if (begin != nullptr) holes.give (begin, end - begin);
+            if (emptied != nullptr && holes.withdraw (emptied->begin, emptied->size)) _region.drop (emptied);
+            if (last) break;
+
+            begin   = block - padding;
+            chunk   = owner;
+            emptied = nullptr;
+        }
+
+        end = block + blockSize;
+        _region.vacate (padding + blockSize);
+        _region.freed (block, blockSize);
+        if (_region.leave (chunk)) emptied = chunk;
+
+        // the freed blocks gather at the front, still in address order
+        std::swap (_data[i], _data[freed++]);
+    }
+
+    if (freed > 0) failedSize = size_t(-1);
+    return freed;
+}
+
+/**
+ *  release
+ *
+ *  _region the region the pool allocates from
+ *
+ *  clears the pool and hands every chunk the region keeps back to the
+ *  index.
+ */
+template <class Region>
+void PoolStrategy::release (Region& _region) {
+    pool.clear();
+    holes.clear();
+    _region.reset();
+    failedSize = size_t(-1);
+
+    for (size_t i = 0; i < _region.count(); ++i) holes.give (_region.chunk (i)->begin, _region.chunk (i)->size);
+}
+
+/**
+ *  grow
+ *
+ *  _region     the region the pool allocates from
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *  _padding    set to the bytes skipped in front of the block
+ *
+ *  Chains a chunk big enough for the block onto the region and takes
+ *  the block from it. returns a null pointer when the region cannot grow.
+ */
+template <class Region>
+BytePointer PoolStrategy::grow (Region& _region, size_t _size, size_t _alignment, size_t& _padding) {
+    auto chunk = _region.grow (_size + _alignment);
+    if (chunk == nullptr) return nullptr;
+
+    holes.give (chunk->begin, chunk->size);
+    return holes.take (_size, _alignment, _padding);
+}
+
+#endif /* PoolStrategy_hpp */
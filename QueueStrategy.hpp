@@ -0,0 +1,258 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  QueueStrategy.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef QueueStrategy_hpp
+#define QueueStrategy_hpp
+
+#include "BytePointer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+/**
+ *  QueueStrategy
+ *
+ *  a circular allocator freed from either end. Blocks are placed one
+ *  after another in a ring, the chunk new blocks go to: once the end of
+ *  the chunk is reached the next block wraps round to its start, as long
+ *  as the oldest block in the ring has been popped out of the way. So a
+ *  FIFO that pops as fast as it pushes runs round the same memory for
+ *  ever. When the ring is full a growable region gives the queue a new
+ *  chunk to ring in while the old one drains, and a chunk left empty
+ *  goes back like a Pool chunk, through the live counts of the region.
+ *  The padding needed to align a block counts as used until the block
+ *  is popped.
+ */
+class QueueStrategy {
+    public:
+        template <class Region>
+        explicit QueueStrategy (Region& _region) { reset (_region); }
+
+        /** return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocate (Region& _region, size_t _size, size_t _alignment) {
+            auto chunk = _region.chunkOf (base);
+            if (chunk->live == 0) head = tail = 0, wrapped = false;
+
+            BytePointer start = nullptr;
+            BytePointer block = place (_size, _alignment, start);
+            if (block == nullptr) {
+                if (_size > size_t(-1) - _alignment || !(chunk = next (_region, _size + _alignment))) return nullptr;
+
+                base     = chunk->begin;
+                capacity = chunk->size;
+                head     = tail = 0;
+                wrapped  = false;
+                block    = place (_size, _alignment, start);
+            }
+
+            _region.enter (chunk);
+            _region.occupy (block + _size - start);
+
+            Entry e;
+            e.start = start;
+            e.data  = block;
+            e.size  = _size;
+            queue.push_back (e);
+            _region.allocated (block, _size);
+            return block;
+        }
+
+        /** return false unless _data is the front or back of the queue */
+        template <class Region>
+        inline bool deallocate (Region& _region, void* _data) {
+            if (queue.empty()) return false;
+
+            Entry e;
+            if (_data == queue.back().data) {
+                e = queue.back();
+                queue.pop_back();
+
+                // the back is always in the ring, so the ring rolls back
+                if (queue.empty() || _region.chunkOf (queue.back().data) != _region.chunkOf (base)) retarget (_region);
+                else {
+                    tail    = queue.back().data + queue.back().size - base;
+                    wrapped = queue.back().start - base < (ptrdiff_t)head;
+                }
+            } else if (_data == queue.front().data) {
+                e = queue.front();
+                queue.pop_front();
+
+                if (queue.empty()) retarget (_region);
+                else if (e.start >= base && e.start < base + capacity) {
+                    // once the head comes round to the start the ring is no longer wrapped
+                    size_t front = queue.front().start - base;
+                    if (front < head) wrapped = false;
+                    head = front;
+                }
+            } else return false;
+
+            auto chunk = _region.chunkOf (e.data);
+            _region.vacate (e.data + e.size - e.start);
+            _region.freed (e.data, e.size);
+            if (_region.leave (chunk) && chunk->begin != base) _region.drop (chunk);
+            return true;
+        }
+
+        /** all or nothing, return false on fail */
+        template <class Region>
+        bool allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out) {
+            for (size_t i = 0; i < _count; ++i) {
+                if ((_out[i] = allocate (_region, _size, _alignment)) == nullptr) {
+                    while (i > 0) deallocate (_region, _out[--i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** pops each block from whichever end it is at, returns the number freed, moved to the front of _data */
+        template <class Region>
+        size_t deallocateBatch (Region& _region, void** _data, size_t _count) {
+            size_t freed = 0;
+            for (size_t i = 0; i < _count; ++i) {
+                if (deallocate (_region, _data[i])) std::swap (_data[i], _data[freed++]);
+            }
+            return freed;
+        }
+
+        template <class Region>
+        void release (Region& _region) {
+            queue.clear();
+            _region.reset();
+            reset (_region);
+        }
+
+        template <class Region>
+        inline bool freeable (Region& _region, void* _data) const {
+            return !queue.empty() && (queue.front().data == _data || queue.back().data == _data);
+        }
+
+        /** the biggest block that fits without growing */
+        template <class Region>
+        size_t largestFree (Region& _region) const {
+            size_t largest = wrapped ? head - tail : std::max (capacity - tail, head);
+            if (_region.chunkOf (base)->live == 0) largest = capacity;
+
+            for (size_t i = 0; i < _region.count(); ++i) {
+                auto chunk = _region.chunk (i);
+                if (chunk->live == 0 && chunk->size > largest) largest = chunk->size;
+            }
+            return largest;
+        }
+
+        /** gaps looked at by the last allocate, placing never searches */
+        inline size_t searchLength () const { return 0; }
+
+    private:
+        struct Entry {
+            BytePointer start; // the first byte the block took up, padding and all
+            BytePointer data;  // the block handed out
+            size_t      size;  // its size
+        };
+
+        /** the block in the ring at the tail, or wrapped to the start, return nullptr on fail */
+        inline BytePointer place (size_t _size, size_t _alignment, BytePointer& _start) {
+            size_t padding = alignmentPadding (base + tail, _alignment);
+            size_t limit   = wrapped ? head : capacity;
+
+            // by subtraction, so a size near the top of size_t cannot wrap past the limit
+            if (padding > limit - tail || _size > limit - tail - padding) {
+                // wrap round, leaving the rest of the chunk unused until the tail comes back
+                padding = alignmentPadding (base, _alignment);
+                if (wrapped || padding > head || _size > head - padding) return nullptr;
+
+                wrapped = true;
+                tail    = 0;
+            }
+
+            _start = base + tail;
+            tail  += padding + _size;
+            return _start + padding;
+        }
+
+        template <class Region>
+        typename Region::Chunk* next (Region& _region, size_t _size);
+
+        template <class Region>
+        void retarget (Region& _region);
+
+        template <class Region>
+        void reset (Region& _region);
+
+        std::deque<Entry> queue;    // live blocks, oldest at the front
+        BytePointer       base;     // the start of the ring
+        size_t            capacity; // its size
+        size_t            head;     // the offset of the oldest block in the ring
+        size_t            tail;     // the offset just past the newest block
+        bool              wrapped;  // whether the tail has come round behind the head
+};
+
+/**
+ *  next
+ *
+ *  _region the region the queue allocates from
+ *  _size   the bytes the new ring needs at least
+ *
+ *  an empty chunk of the region big enough for the block, growing the
+ *  region when there is none. returns a null pointer when it cannot grow.
+ */
+template <class Region>
+typename Region::Chunk* QueueStrategy::next (Region& _region, size_t _size) {
+    for (size_t i = 0; i < _region.count(); ++i) {
+        auto chunk = _region.chunk (i);
+        if (chunk->live == 0 && chunk->begin != base && chunk->size >= _size) return chunk;
+    }
+    return _region.grow (_size);
+}
+
+/**
+ *  retarget
+ *
+ *  _region the region the queue allocates from
+ *
+ *  the ring emptied from the back while older chunks still hold blocks,
+ *  or the queue emptied, so the ring moves to the chunk of the newest
+ *  block, or back to the first chunk. Finding the oldest block in the
+ *  new ring walks the queue, but only once per change of ring.
+ */
+template <class Region>
+void QueueStrategy::retarget (Region& _region) {
+    if (queue.empty()) return reset (_region);
+
+    auto chunk = _region.chunkOf (queue.back().data);
+    base     = chunk->begin;
+    capacity = chunk->size;
+    tail     = queue.back().data + queue.back().size - base;
+    head     = 0;
+
+    for (const Entry& e : queue) {
+        if (e.start >= base && e.start < base + capacity) {
+            head = e.start - base;
+            break;
+        }
+    }
+    wrapped = queue.back().start - base < (ptrdiff_t)head;
+}
+
+/**
+ *  reset
+ *
+ *  _region the region the queue allocates from
+ *
+ *  starts the ring afresh at the beginning of the first chunk.
+ */
+template <class Region>
+void QueueStrategy::reset (Region& _region) {
+    base     = _region.chunk (0)->begin;
+    capacity = _region.chunk (0)->size;
+    head     = 0;
+    tail     = 0;
+    wrapped  = false;
+}
+
+#endif /* QueueStrategy_hpp */
@@ -0,0 +1,431 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Region.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Region_hpp
+#define Region_hpp
+
+#include "BytePointer.hpp"
+#include "Backing.hpp"
+#include "SystemQueries.hpp"
+#include "Sanitizer.hpp"
+
+#include <iostream>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <unordered_map>
+
+#define CHUNK_GRANULE 65536 // the smallest extra chunk, chunks are aligned to it
+#define CHUNK_HEADER  64    // chunk metadata in front of every extra chunk
+
+/**
+ *  Growth
+ *
+ *  how a region grows once the preallocated block is full. Extra chunks
+ *  are chained on rather than moving anything, so pointers stay put.
+ *  Empty chunks beyond highWater bytes go back to the system.
+ */
+struct Growth {
+    enum Kind { None, Fixed, Geometric };
+
+    Kind   kind;      // None fails at capacity
+    size_t chunk;     // bytes per chunk, the first one when Geometric
+    size_t highWater; // idle chunk bytes kept for reuse
+};
+
+/**
+ *  Region
+ *
+ *  the memory a manager hands out, whatever its strategy: the block
+ *  preallocated up front followed by a chain of extra chunks as the
+ *  manager grows. Every chunk comes from the BackingStore, which needs
+ *  acquire, dispose and discard like Backing. Extra chunks are whole
+ *  granules aligned to the granule size with their header in front, so
+ *  the granule number of an address finds its chunk in one hash lookup.
+ *  Stack bumps across the chain through bump and rewind, and down from
+ *  the top of the preallocated block through bumpHigh and rewindHigh.
+ *  Pool and Queue keep a count of live blocks per chunk through enter
+ *  and leave. Strategies report blocks handed out and freed through
+ *  allocated and freed, which under MEMORY_MANAGER_SANITIZE tell the
+ *  sanitizers, to whom the usable memory of a chunk starts out poisoned.
+ */
+template <class BackingStore = Backing>
+class Region {
+    public:
+        struct Chunk {
+            BytePointer data;     // what the backing returned, the chunk is aligned inside it
+            size_t      reserved; // bytes the backing reserved
+            BytePointer begin;    // the first usable byte
+            size_t      size;     // usable bytes
+            size_t      offset;   // bytes bumped off in Stack mode
+            size_t      high;     // bytes bumped off the top in Stack mode, preallocated block only
+            size_t      live;     // blocks out in Pool mode
+            size_t      index;    // position in the chain
+        };
+
+        static_assert (sizeof(Chunk) <= CHUNK_HEADER, "chunk header too big");
+
+        Region (size_t _size, Growth _growth, BackingStore _backing);
+       ~Region ();
+
+        /** return nullptr on fail */
+        Chunk* grow (size_t _size);
+        void   drop (Chunk* _chunk);
+
+        inline Chunk* chunkOf (void* _data) {
+            if (directory.empty()) return &primary;
+
+            auto it = directory.find ((uintptr_t)_data >> shift);
+            return (it != directory.end()) ? it->second : &primary;
+        }
+
+        /** bump allocation and LIFO rollback across the chain, return nullptr on fail */
+        inline BytePointer bump (size_t _size, size_t _alignment) {
+            Chunk* chunk   = chunks[active];
+            size_t padding = alignmentPadding (chunk->begin + chunk->offset, _alignment);
+            size_t room    = chunk->size - chunk->high - chunk->offset;
+            if (padding > room || _size > room - padding) return bumpSlow (_size, _alignment);
+
+            chunk->offset += padding + _size;
+            used          += padding + _size;
+            return chunk->begin + chunk->offset - _size;
+        }
+        void rewind (BytePointer _data, size_t _size);
+
+        /** bump allocation down from the top of the preallocated block, return nullptr on fail */
+        inline BytePointer bumpHigh (size_t _size, size_t _alignment) {
+            BytePointer top = primary.begin + primary.size - primary.high;
+            if (_size > (size_t)(top - primary.begin)) return nullptr;
+
+            // the padding goes above the block, between it and the one before
+            BytePointer block = (BytePointer)((uintptr_t)(top - _size) & ~(uintptr_t)(_alignment - 1));
+            if (block < primary.begin + primary.offset) return nullptr;
+
+            primary.high += top - block;
+            used         += top - block;
+            return block;
+        }
+        /** _data is the newest block left at the top, null when there are none */
+        inline void rewindHigh (BytePointer _data) {
+            size_t high = (_data != nullptr) ? primary.begin + primary.size - _data : 0;
+            used        -= primary.high - high;
+            primary.high = high;
+        }
+
+        /** a Pool block came out of or went back to _chunk */
+        inline void enter (Chunk* _chunk) {
+            if (_chunk->live++ == 0 && _chunk != &primary) idle -= _chunk->size;
+        }
+        /** true when _chunk emptied and should go back to the system */
+        inline bool leave (Chunk* _chunk) {
+            if (--_chunk->live > 0 || _chunk == &primary) return false;
+
+            idle += _chunk->size;
+            return idle > growth.highWater;
+        }
+
+        void reset   ();
+        void discard ();
+
+        inline void occupy (size_t _size) { used += _size; }
+        inline void vacate (size_t _size) { used -= _size; }
+
+        /** _size bytes at _block were handed out or went back, for the sanitizers */
+        inline void allocated (void* _block, size_t _size) { sanitizerAllocate (this, _block, _size); }
+        inline void freed     (void* _block, size_t _size) { sanitizerFree (this, _block, _size); }
+
+        size_t largestTail () const;
+
+        inline bool   growable () const { return growth.kind != Growth::None; }
+        inline size_t occupied () const { return used; }
+        inline size_t total    () const { return size; }
+        inline size_t count    () const { return chunks.size(); }
+        inline Chunk* chunk    (size_t _index) const { return chunks[_index]; }
+
+    private:
+        Region (const Region&) = delete;
+        Region& operator= (const Region&) = delete;
+
+        BytePointer bumpSlow (size_t _size, size_t _alignment);
+        void        retreat  (size_t _index, size_t _offset);
+
+        const Growth        growth;  // how extra chunks are sized
+        const BackingStore  backing; // where every chunk's memory comes from
+        Chunk               primary; // the preallocated memory, first in the chain
+        unsigned            shift;   // log2 of the chunk granule
+        size_t              next;    // the size of the next chunk when Geometric
+        size_t              active;  // the chunk Stack mode bumps from
+        size_t              idle;    // usable bytes in extra chunks holding nothing
+        size_t              size;    // the total size of every chunk
+        size_t              used;    // the total size of used memory
+        std::vector<Chunk*>                   chunks;    // the chain, in order made
+        std::unordered_map<uintptr_t, Chunk*> directory; // granule number to extra chunk
+};
+
+/**
+ *  Region Constructor
+ *
+ *  _size       the amount of memory to preallocate
+ *  _growth     how to grow once the preallocated memory is full
+ *  _backing    where the memory comes from
+ *
+ *  Preallocates the first chunk. Kills executing program on errors such
+ *  as malloc failure or too much memory requested.
+ */
+template <class BackingStore>
+Region<BackingStore>::Region (size_t _size, Growth _growth, BackingStore _backing)
+    : growth (_growth), backing (_backing), shift (0), active (0), idle (0), size (_size), used (0) {
+    if (size > memoryLimit()) {
+        std::cout << "ERROR: requested more RAM than system contains" << std::endl;
+        exit (1);
+    }
+
+    if (!(primary.begin = backing.acquire (size, alignof(std::max_align_t), primary.data, primary.reserved))) {
+        std::cout << "ERROR: malloc failure" << std::endl;
+        exit (1);
+    }
+
+    while ((size_t(1) << shift) < CHUNK_GRANULE || (size_t(1) << shift) < growth.chunk) ++shift;
+    next = size_t(1) << shift;
+
+    primary.size   = size;
+    primary.offset = 0;
+    primary.high   = 0;
+    primary.live   = 0;
+    primary.index  = 0;
+    chunks.push_back (&primary);
+
+    sanitizerCreate (this);
+    sanitizerPoison (primary.begin, primary.size);
+}
+
+/**
+ *  Region Destructor
+ *
+ *  Frees every extra chunk and the preallocated memory
+ */
+template <class BackingStore>
+Region<BackingStore>::~Region () {
+    sanitizerDestroy (this);
+    for (Chunk* chunk : chunks) sanitizerUnpoison (chunk->begin, chunk->size);
+
+    for (size_t i = 1; i < chunks.size(); ++i) backing.dispose (chunks[i]->data, chunks[i]->reserved);
+    backing.dispose (primary.data, primary.reserved);
+}
+
+/**
+ *  grow
+ *
+ *  _size   the usable bytes the new chunk must have
+ *
+ *  Chains a new chunk onto the region and enters every granule it
+ *  covers in the directory. A new chunk starts out idle. returns a null
+ *  pointer when the region cannot grow or the backing is out of memory.
+ */
+template <class BackingStore>
+typename Region<BackingStore>::Chunk* Region<BackingStore>::grow (size_t _size) {
+    if (growth.kind == Growth::None) return nullptr;
+
+    size_t granule = size_t(1) << shift;
+    if (_size > size_t(-1) / 2 - CHUNK_HEADER - granule) return nullptr;
+
+    size_t bytes = (growth.kind == Growth::Geometric) ? next : granule;
+    if (bytes < _size + CHUNK_HEADER) bytes = (_size + CHUNK_HEADER + granule - 1) & ~(granule - 1);
+
+    // never grow past what the machine, or the container, can hold
+    if (size + bytes > memoryLimit()) return nullptr;
+
+    BytePointer base;
+    size_t      reserved;
+    BytePointer raw = backing.acquire (bytes, granule, base, reserved);
+    if (raw == nullptr) return nullptr;
+
+    // the backing may round up to whole pages, use every granule of them
+    bytes = (reserved - (raw - base)) & ~(granule - 1);
+
+    Chunk* chunk    = new (raw) Chunk;
+    chunk->data     = base;
+    chunk->reserved = reserved;
+    chunk->begin    = (BytePointer)chunk + CHUNK_HEADER;
+    chunk->size     = bytes - CHUNK_HEADER;
+    chunk->offset   = 0;
+    chunk->high     = 0;
+    chunk->live     = 0;
+    chunk->index    = chunks.size();
+    chunks.push_back (chunk);
+
+    uintptr_t first = (uintptr_t)chunk >> shift;
+    for (uintptr_t g = first; g < first + (bytes >> shift); ++g) directory[g] = chunk;
+
+    if (growth.kind == Growth::Geometric) next = bytes * 2;
+    size += chunk->size;
+    idle += chunk->size;
+    sanitizerPoison (chunk->begin, chunk->size);
+    return chunk;
+}
+
+/**
+ *  drop
+ *
+ *  _chunk  an idle extra chunk
+ *
+ *  Unchains a chunk and hands its memory back to the backing.
+ */
+template <class BackingStore>
+void Region<BackingStore>::drop (Chunk* _chunk) {
+    size_t bytes = _chunk->size + CHUNK_HEADER;
+
+    uintptr_t first = (uintptr_t)_chunk >> shift;
+    for (uintptr_t g = first; g < first + (bytes >> shift); ++g) directory.erase (g);
+
+    chunks.erase (chunks.begin() + _chunk->index);
+    for (size_t i = _chunk->index; i < chunks.size(); ++i) chunks[i]->index = i;
+
+    size -= _chunk->size;
+    idle -= _chunk->size;
+    sanitizerUnpoison (_chunk->begin, _chunk->size);
+    backing.dispose (_chunk->data, _chunk->reserved);
+}
+
+/**
+ *  bumpSlow
+ *
+ *  _size       the size of memory required
+ *  _alignment  the power of two the address must be a multiple of
+ *
+ *  The block did not fit the active chunk, so the next chunk in the
+ *  chain becomes active, and a new one is grown once the chain runs
+ *  out. The tail left in the chunk moved off is not reused until the
+ *  blocks after it are popped.
+ */
+template <class BackingStore>
+BytePointer Region<BackingStore>::bumpSlow (size_t _size, size_t _alignment) {
+    // the chunk grown is asked for _size + _alignment, which must not wrap
+    if (_size > size_t(-1) - _alignment) return nullptr;
+
+    size_t from  = active;
+    Chunk* chunk = chunks[active];
+
+    size_t padding;
+    do {
+        if (active + 1 < chunks.size()) chunk = chunks[active + 1];
+        else if (!(chunk = grow (_size + _alignment))) {
+            retreat (from, chunks[from]->offset);
+            return nullptr;
+        }
+
+        active  = chunk->index;
+        idle   -= chunk->size;
+        padding = alignmentPadding (chunk->begin, _alignment);
+    } while (padding > chunk->size - chunk->high || _size > chunk->size - chunk->high - padding);
+
+    chunk->offset = padding + _size;
+    used         += padding + _size;
+    return chunk->begin + padding;
+}
+
+/**
+ *  rewind
+ *
+ *  _data   the newest live block, null when there are none
+ *  _size   the size of the block
+ *
+ *  Rolls the chain back so the end of the block is the end of used
+ *  memory.
+ */
+template <class BackingStore>
+void Region<BackingStore>::rewind (BytePointer _data, size_t _size) {
+    if (_data == nullptr) return retreat (0, 0);
+
+    Chunk* chunk = chunkOf (_data);
+    retreat (chunk->index, (_data + _size) - chunk->begin);
+}
+
+/**
+ *  retreat
+ *
+ *  _index  the chunk to make active
+ *  _offset its new bump offset
+ *
+ *  Empties every chunk after _index and makes it the active one again.
+ *  Emptied extra chunks are idle and the last ones in the chain go back
+ *  to the system once there are more than the high water mark.
+ */
+template <class BackingStore>
+void Region<BackingStore>::retreat (size_t _index, size_t _offset) {
+    for (; active > _index; --active) {
+        used -= chunks[active]->offset;
+        idle += chunks[active]->size;
+        chunks[active]->offset = 0;
+    }
+
+    used += _offset;
+    used -= chunks[_index]->offset;
+    chunks[_index]->offset = _offset;
+
+    while (idle > growth.highWater && chunks.size() > active + 1) drop (chunks.back());
+}
+
+/**
+ *  reset
+ *
+ *  empties every chunk at once, keeping no more extra chunks than the
+ *  high water mark allows, and lets the backing reclaim the pages of
+ *  those it keeps. Every block still out goes with them, so the
+ *  sanitizers start over with the whole of every chunk poisoned.
+ */
+template <class BackingStore>
+void Region<BackingStore>::reset () {
+    used   = 0;
+    idle   = 0;
+    active = 0;
+
+    sanitizerDestroy (this);
+    sanitizerCreate (this);
+
+    for (Chunk* chunk : chunks) {
+        chunk->offset = 0;
+        chunk->high   = 0;
+        chunk->live   = 0;
+        if (chunk != &primary) idle += chunk->size;
+        sanitizerPoison (chunk->begin, chunk->size);
+    }
+    while (idle > growth.highWater && chunks.size() > 1) drop (chunks.back());
+
+    // before the strategy writes its lists and tags, which dropped pages would zero
+    discard ();
+}
+
+/**
+ *  discard
+ *
+ *  lets the backing reclaim the pages of every chunk, which must all
+ *  be empty.
+ */
+template <class BackingStore>
+void Region<BackingStore>::discard () {
+    for (Chunk* chunk : chunks) backing.discard (chunk->begin, chunk->size);
+}
+
+/**
+ *  largestTail
+ *
+ *  the biggest block Stack mode could bump right now without growing:
+ *  the rest of the active chunk below whatever was bumped off its top,
+ *  or a whole chunk after it. The tails of chunks before the active one
+ *  are not counted, since nothing is bumped there until the blocks
+ *  after them are popped.
+ */
+template <class BackingStore>
+size_t Region<BackingStore>::largestTail () const {
+    size_t largest = chunks[active]->size - chunks[active]->high - chunks[active]->offset;
+    for (size_t i = active + 1; i < chunks.size(); ++i) {
+        if (chunks[i]->size > largest) largest = chunks[i]->size;
+    }
+    return largest;
+}
+
+#endif /* Region_hpp */
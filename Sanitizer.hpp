@@ -0,0 +1,114 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Sanitizer.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Sanitizer_hpp
+#define Sanitizer_hpp
+
+#include <cstddef>
+
+/**
+ *  Every block comes out of a chunk the region got in one piece, so to
+ *  AddressSanitizer and Valgrind the whole chunk is valid memory and a
+ *  use after free inside it goes unseen. Built with
+ *  MEMORY_MANAGER_SANITIZE, the region poisons its chunks and keeps a
+ *  Valgrind memory pool, and the strategies tell them which blocks are
+ *  handed out and which are freed. Metadata a strategy keeps inside
+ *  free memory is unpoisoned while it is live, so only the strategy
+ *  itself may touch it. Each tool is only told when it is there: ASan
+ *  when the build is instrumented, Valgrind when its headers are found.
+ *  Without the flag every hook is empty and compiles to nothing.
+ */
+#ifdef MEMORY_MANAGER_SANITIZE
+    #if defined __SANITIZE_ADDRESS__
+        #define SANITIZER_ASAN
+    #elif defined __has_feature
+        #if __has_feature(address_sanitizer)
+            #define SANITIZER_ASAN
+        #endif
+    #endif
+
+    #if defined __has_include
+        #if __has_include(<valgrind/memcheck.h>)
+            #define SANITIZER_VALGRIND
+        #endif
+    #endif
+#endif
+
+#ifdef SANITIZER_ASAN
+    #include <sanitizer/asan_interface.h>
+#endif
+
+#ifdef SANITIZER_VALGRIND
+    #include <valgrind/memcheck.h>
+#endif
+
+/** _pool is the memory pool of a new region, its chunks poisoned */
+inline void sanitizerCreate (const void* _pool) {
+#ifdef SANITIZER_VALGRIND
+    VALGRIND_CREATE_MEMPOOL (_pool, 0, 0);
+#endif
+}
+
+/** _pool is gone, along with every block in it */
+inline void sanitizerDestroy (const void* _pool) {
+#ifdef SANITIZER_VALGRIND
+    VALGRIND_DESTROY_MEMPOOL (_pool);
+#endif
+}
+
+/** _size bytes at _block were handed out from _pool */
+inline void sanitizerAllocate (const void* _pool, const void* _block, size_t _size) {
+#ifdef SANITIZER_ASAN
+    ASAN_UNPOISON_MEMORY_REGION (_block, _size);
+#endif
+#ifdef SANITIZER_VALGRIND
+    VALGRIND_MEMPOOL_ALLOC (_pool, _block, _size);
+#endif
+}
+
+/** the block of _size bytes at _block went back to _pool */
+inline void sanitizerFree (const void* _pool, const void* _block, size_t _size) {
+#ifdef SANITIZER_ASAN
+    ASAN_POISON_MEMORY_REGION (_block, _size);
+#endif
+#ifdef SANITIZER_VALGRIND
+    VALGRIND_MEMPOOL_FREE (_pool, _block);
+#endif
+}
+
+/** nothing may touch _size bytes at _data until they are handed out */
+inline void sanitizerPoison (const void* _data, size_t _size) {
+#ifdef SANITIZER_ASAN
+    ASAN_POISON_MEMORY_REGION (_data, _size);
+#endif
+#ifdef SANITIZER_VALGRIND
+    VALGRIND_MAKE_MEM_NOACCESS (_data, _size);
+#endif
+}
+
+/** _size bytes at _data are about to hold metadata */
+inline void sanitizerUnpoison (const void* _data, size_t _size) {
+#ifdef SANITIZER_ASAN
+    ASAN_UNPOISON_MEMORY_REGION (_data, _size);
+#endif
+#ifdef SANITIZER_VALGRIND
+    VALGRIND_MAKE_MEM_UNDEFINED (_data, _size);
+#endif
+}
+
+/**
+ *  whether any of _size bytes at _data is poisoned, so a check of a
+ *  pointer that is no block can refuse it rather than read freed
+ *  memory. Only ASan can say; under Valgrind it is never poisoned.
+ */
+inline bool sanitizerPoisoned (const void* _data, size_t _size) {
+#ifdef SANITIZER_ASAN
+    return __asan_region_is_poisoned ((void*)_data, _size) != nullptr;
+#else
+    return false;
+#endif
+}
+
+#endif /* Sanitizer_hpp */
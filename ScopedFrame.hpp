@@ -0,0 +1,42 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ScopedFrame.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef ScopedFrame_hpp
+#define ScopedFrame_hpp
+
+#include "StackStrategy.hpp"
+
+#include <cstddef>
+
+/**
+ *  ScopedFrame
+ *
+ *  scratch memory for one scope. Takes a marker from a Stack mode
+ *  manager, either MemoryManager or a BasicMemoryManager over a
+ *  StackStrategy, and frees back to it when the scope ends, so every
+ *  block allocated in between goes at once however many there were.
+ *  Frames nest like the scopes they belong to. Objects in the frame
+ *  are not destroyed, only their memory is reclaimed.
+ */
+template <class Manager>
+class ScopedFrame {
+    public:
+        explicit ScopedFrame (Manager& _manager) : manager (_manager), marker (_manager.getMarker()) {}
+       ~ScopedFrame () { manager.freeToMarker (marker); }
+
+        /** return nullptr on fail */
+        inline void* allocate (size_t _size, size_t _alignment = alignof(std::max_align_t)) {
+            return manager.allocate (_size, _alignment);
+        }
+
+    private:
+        ScopedFrame (const ScopedFrame&) = delete;
+        ScopedFrame& operator= (const ScopedFrame&) = delete;
+
+        Manager&                    manager; // the stack the frame is on
+        const StackStrategy::Marker marker;  // where the frame began
+};
+
+#endif /* ScopedFrame_hpp */
@@ -0,0 +1,43 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SizeClass.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef SizeClass_hpp
+#define SizeClass_hpp
+
+#include <cstddef>
+
+#define SIZE_CLASS_MAX   4096 // largest request with a size class
+#define SIZE_CLASS_COUNT 10   // 8, 16, 32 ... 4096
+
+/**
+ *  SizeClassTable
+ *
+ *  maps a request, in 8 byte steps, to its power of two size class.
+ *  Built by the compiler so looking up a class is a single load.
+ */
+struct SizeClassTable {
+    unsigned char index[SIZE_CLASS_MAX / 8 + 1];
+
+    constexpr SizeClassTable () : index () {
+        for (size_t step = 0; step <= SIZE_CLASS_MAX / 8; ++step) {
+            unsigned char c = 0;
+            while ((size_t(8) << c) < step * 8) ++c;
+            index[step] = c;
+        }
+    }
+};
+
+constexpr SizeClassTable sizeClassTable;
+
+/** _size must be at most SIZE_CLASS_MAX */
+inline unsigned sizeClassIndex (size_t _size) {
+    return sizeClassTable.index[(_size + 7) >> 3];
+}
+
+inline size_t sizeClassBytes (unsigned _index) {
+    return size_t(8) << _index;
+}
+
+#endif /* SizeClass_hpp */
@@ -0,0 +1,201 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SlabAllocator.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "SlabAllocator.hpp"
+
+#include <cstring>
+
+/**
+ *  SlabAllocator Constructor
+ *
+ *  _size       the amount of memory to preallocate
+ *  _slabSize   the amount of memory carved for a size class at a time
+ *
+ *  Constructs a slab allocator over a pool manager of _size bytes.
+ */
+SlabAllocator::SlabAllocator (size_t _size, size_t _slabSize)
+    : manager (_size),
+      slabSize (_slabSize < SIZE_CLASS_MAX ? SIZE_CLASS_MAX : _slabSize), used (0) {
+    release();
+}
+
+/**
+ *  SlabAllocator Destructor
+ *
+ *  the manager frees the block of memory
+ */
+SlabAllocator::~SlabAllocator () {}
+
+/**
+ *  classSize
+ *
+ *  _size   the size of memory required
+ *
+ *  The number of bytes a request of _size actually takes up.
+ */
+size_t SlabAllocator::classSize (size_t _size) {
+    return (_size <= SIZE_CLASS_MAX) ? sizeClassBytes (sizeClassIndex (_size)) : _size;
+}
+
+/**
+ *  allocate
+ *
+ *  _size   the size of memory required
+ *
+ *  Small requests pop a slot from their size class, refilling it with
+ *  a new slab when it runs dry. Large requests go straight to the pool.
+ *  returns a null pointer on failure.
+ */
+void* SlabAllocator::allocate (size_t _size) {
+    if (_size > SIZE_CLASS_MAX) {
+        size_t before = manager.occupiedMemory();
+        void*  block  = manager.allocate (_size);
+
+        // alignment padding in front of the block counts too
+        used += manager.occupiedMemory() - before;
+        return block;
+    }
+
+    unsigned   index = sizeClassIndex (_size);
+    SizeClass& c     = classes[index];
+    size_t     bytes = sizeClassBytes (index);
+
+    // fresh slots come from the newest slab, which ends at the class's end
+    BytePointer slot, slab;
+    if (c.head != nullptr) {
+        slot   = (BytePointer)c.head;
+        slab   = slabOf (slot);
+        c.head = c.head->next;
+    } else if ((size_t)(c.end - c.fresh) >= bytes || refill (index)) {
+        slot     = c.fresh;
+        slab     = c.end - slabSize;
+        c.fresh += bytes;
+    } else return nullptr;
+
+    uint64_t bit;
+    word (slab, slot, index, bit) |= bit;
+    used += bytes;
+    return slot;
+}
+
+/**
+ *  deallocate
+ *
+ *  _data   a pointer to the data to free
+ *
+ *  Finds the slab holding _data to learn its size class, or hands it to
+ *  the pool when it is not in any slab. returns true on successful
+ *  deallocation, false otherwise.
+ */
+bool SlabAllocator::deallocate (void* _data) {
+    BytePointer slab = slabOf (_data);
+    if (slab != nullptr) return push (slab, slabs.at (slab), _data);
+
+    return deallocate (_data, SIZE_CLASS_MAX + 1);
+}
+
+/**
+ *  deallocate
+ *
+ *  _data   a pointer to the data to free
+ *  _size   the size _data was allocated with
+ *
+ *  Sized deallocation. A large block skips the slab lookup entirely, a
+ *  small one must be a slot of a slab of its size class. returns true
+ *  on successful deallocation, false otherwise.
+ */
+bool SlabAllocator::deallocate (void* _data, size_t _size) {
+    if (_size <= SIZE_CLASS_MAX) {
+        BytePointer slab  = slabOf (_data);
+        unsigned    index = sizeClassIndex (_size);
+        return slab != nullptr && slabs.at (slab) == index && push (slab, index, _data);
+    }
+
+    size_t before = manager.occupiedMemory();
+    if (!manager.deallocate (_data)) return false;
+
+    used -= before - manager.occupiedMemory();
+    return true;
+}
+
+/**
+ *  release
+ *
+ *  clears every slab and large block at once.
+ */
+void SlabAllocator::release () {
+    manager.release();
+    slabs.clear();
+    used = 0;
+
+    for (SizeClass& c : classes) {
+        c.head  = nullptr;
+        c.fresh = nullptr;
+        c.end   = nullptr;
+    }
+}
+
+/**
+ *  slabOf
+ *
+ *  _data   the pointer to look up
+ *
+ *  returns the slab holding _data, or a null pointer when it lies in none.
+ */
+BytePointer SlabAllocator::slabOf (void* _data) const {
+    BytePointer p = (BytePointer)_data;
+
+    auto it = slabs.upper_bound (p);
+    if (it != slabs.begin() && p < (--it)->first + slabSize) return it->first;
+    return nullptr;
+}
+
+/**
+ *  refill
+ *
+ *  _index  the size class that ran out of slots
+ *
+ *  Carves a new slab from the manager for a size class and clears the
+ *  bits in front of its slots. returns the slab, or a null pointer when
+ *  the manager is full.
+ */
+BytePointer SlabAllocator::refill (unsigned _index) {
+    BytePointer slab = (BytePointer)manager.allocate (slabSize);
+    if (slab == nullptr) return nullptr;
+
+    slabs.emplace (slab, _index);
+    std::memset (slab, 0, first (_index));
+
+    SizeClass& c = classes[_index];
+    c.fresh = slab + first (_index);
+    c.end   = slab + slabSize;
+    return slab;
+}
+
+/**
+ *  push
+ *
+ *  _index  the size class of the slot
+ *  _data   the slot being freed
+ *
+ *  threads a freed slot onto the front of its class's free list.
+ *  returns false, leaving the list alone, when _data is not the start
+ *  of a slot of its slab handed out and not yet freed.
+ */
+bool SlabAllocator::push (BytePointer _slab, unsigned _index, void* _data) {
+    size_t offset = (BytePointer)_data - _slab;
+    if (offset < first (_index) || (offset & (sizeClassBytes (_index) - 1)) != 0) return false;
+
+    uint64_t  bit;
+    uint64_t& bits = word (_slab, (BytePointer)_data, _index, bit);
+    if ((bits & bit) == 0) return false;
+    bits &= ~bit;
+
+    Link* link = (Link*)_data;
+    link->next = classes[_index].head;
+    classes[_index].head = link;
+    used -= sizeClassBytes (_index);
+    return true;
+}
@@ -0,0 +1,91 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SlabAllocator.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef SlabAllocator_hpp
+#define SlabAllocator_hpp
+
+#include "BytePointer.hpp"
+#include "BasicMemoryManager.hpp"
+#include "PoolStrategy.hpp"
+#include "SizeClass.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+#define SLAB_SIZE 65536 // bytes carved from the manager per slab
+
+/**
+ *  SlabAllocator
+ *
+ *  A size class front end over a pool strategy manager. Requests up
+ *  to SIZE_CLASS_MAX bytes are rounded up to the next power of two and
+ *  served from slabs of equal slots carved from the manager's block,
+ *  anything larger goes to the manager's own variable size pool. The
+ *  size class comes from a table built at compile time and each class
+ *  keeps its free slots in an intrusive list, so a small allocation is
+ *  a table lookup and a pointer pop. Each slab starts with a bit per
+ *  slot, set while the slot is handed out, in slots of its own.
+ *  Either deallocate refuses a pointer that is not a slot handed out,
+ *  so a double free is caught rather than threaded onto the list twice.
+ */
+class SlabAllocator {
+    public:
+        SlabAllocator (size_t _size, size_t _slabSize = SLAB_SIZE);
+       ~SlabAllocator ();
+
+        /** return nullptr on fail */
+        void* allocate (size_t _size);
+
+        /** return false on fail */
+        bool deallocate (void* _data);
+        bool deallocate (void* _data, size_t _size);
+
+        void release ();
+
+        inline size_t occupiedMemory () { return used; }
+        inline size_t totalMemory    () { return manager.totalMemory(); }
+        inline size_t freeMemory     () { return manager.totalMemory() - used; }
+
+        static size_t classSize (size_t _size);
+
+    private:
+        struct Link { Link* next; };
+
+        struct SizeClass {
+            Link*       head;  // the most recently freed slot
+            BytePointer fresh; // the first untouched slot of the newest slab
+            BytePointer end;   // the end of the newest slab
+        };
+
+        SlabAllocator (const SlabAllocator&) = delete;
+        SlabAllocator& operator= (const SlabAllocator&) = delete;
+
+        BytePointer refill (unsigned _index);
+        bool        push   (BytePointer _slab, unsigned _index, void* _data);
+
+        BytePointer slabOf (void* _data) const;
+
+        /** the bytes in front of the first slot, whole slots covering a bit per slot */
+        inline size_t first (unsigned _index) const {
+            size_t bytes = (slabSize / sizeClassBytes (_index) + 63) / 64 * sizeof(uint64_t);
+            return (bytes + sizeClassBytes (_index) - 1) & ~(sizeClassBytes (_index) - 1);
+        }
+
+        /** the word holding the bit of _slot, and the bit */
+        inline uint64_t& word (BytePointer _slab, BytePointer _slot, unsigned _index, uint64_t& _bit) const {
+            size_t slot = (size_t)(_slot - _slab) >> (3 + _index);
+            _bit = uint64_t(1) << (slot % 64);
+            return ((uint64_t*)_slab)[slot / 64];
+        }
+
+        BasicMemoryManager<PoolStrategy> manager; // backs every slab and large block
+        const size_t                     slabSize; // bytes carved per slab
+        SizeClass                        classes[SIZE_CLASS_COUNT];
+        std::map<BytePointer, unsigned>  slabs;    // slab start to size class
+        size_t                           used;     // bytes handed out to callers
+};
+
+#endif /* SlabAllocator_hpp */
@@ -7,20 +7,196 @@
 #define SmartPointer_hpp
 
 #include "BytePointer.hpp"
+#include "MemoryManager.hpp"
 
-// UNFINISHED, couldn't crack the generics
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ *  BlockHeader
+ *
+ *  sits right in front of an object owned by a smart pointer, so the
+ *  handle itself only needs the object's address. The block starts Size
+ *  bytes before the object, enough for the header at the object's
+ *  alignment.
+ */
+template <class T>
+struct BlockHeader {
+    MemoryManager* owner; // the manager the block came from
+    size_t         count; // references to the object, shared pointers only
+
+    static constexpr size_t Alignment = alignof(T) > alignof(BlockHeader*) ? alignof(T) : alignof(BlockHeader*);
+    static constexpr size_t Size      = (sizeof(MemoryManager*) + sizeof(size_t) + Alignment - 1) & ~(Alignment - 1);
+
+    static inline BlockHeader* of (T* _data) { return (BlockHeader*)((BytePointer)_data - sizeof(BlockHeader)); }
+
+    /** allocates a header and an object, return nullptr on fail */
+    template <class... Args>
+    static T* make (MemoryManager& _manager, Args&&... _args) {
+        BytePointer block = (BytePointer)_manager.allocate (Size + sizeof(T), Alignment);
+        if (block == nullptr) return nullptr;
+
+        BlockHeader* header = (BlockHeader*)(block + Size - sizeof(BlockHeader));
+        header->owner = &_manager;
+        header->count = 1;
+
+        try {
+            return new (block + Size) T (std::forward<Args>(_args)...);
+        } catch (...) {
+            _manager.deallocate (block);
+            throw;
+        }
+    }
+
+    /** destroys the object and hands the block back to its manager */
+    static void unmake (T* _data) {
+        MemoryManager* owner = of (_data)->owner;
+        _data->~T();
+        owner->deallocate ((BytePointer)_data - Size);
+    }
+};
+
+/**
+ *  SmartPointer
+ *
+ *  A move only handle owning an object in a MemoryManager block. The
+ *  handle is a single pointer; the owning manager is found through the
+ *  header in front of the object, and the block goes back to it when the
+ *  handle is destroyed. Nothing touches the global heap. In Stack and
+ *  Queue mode the handles must die in the order the mode frees in,
+ *  otherwise the block stays allocated until the manager is released.
+ */
 template <class T>
 class SmartPointer {
     public:
-        SmartPointer ();
-       ~SmartPointer ();
-    
-        inline T load () { return *data; }
-        inline void store (T val) { *data = val; }
-    
+        SmartPointer () : data (nullptr) {}
+        SmartPointer (SmartPointer&& _other) : data (_other.data) { _other.data = nullptr; }
+       ~SmartPointer () { reset(); }
+
+        SmartPointer& operator= (SmartPointer&& _other) {
+            if (this != &_other) {
+                reset();
+                data = _other.data;
+                _other.data = nullptr;
+            }
+            return *this;
+        }
+
+        inline const T& load () const { return *data; }
+        inline void store (const T& _val) { *data = _val; }
+
+        inline T* get        () const { return data; }
+        inline T& operator*  () const { return *data; }
+        inline T* operator-> () const { return data; }
+        inline explicit operator bool () const { return data != nullptr; }
+
+        inline MemoryManager* owner () const { return data ? BlockHeader<T>::of (data)->owner : nullptr; }
+
+        void reset () {
+            if (data != nullptr) BlockHeader<T>::unmake (data);
+            data = nullptr;
+        }
+
+        template <class U, class... Args>
+        friend SmartPointer<U> makeSmartPointer (MemoryManager& _manager, Args&&... _args);
+
     private:
-        T* data;
-    
+        SmartPointer (const SmartPointer&) = delete;
+        SmartPointer& operator= (const SmartPointer&) = delete;
+
+        explicit SmartPointer (T* _data) : data (_data) {}
+
+        T* data; // the owned object, null when empty
 };
 
-#endif /* SmartPointer_h */
+/**
+ *  SharedPointer
+ *
+ *  A reference counted handle to an object in a MemoryManager block.
+ *  The count lives in the block header next to the owning manager, so
+ *  there is no separate control block and the handle is a single
+ *  pointer. The count is not atomic, in keeping with the manager.
+ */
+template <class T>
+class SharedPointer {
+    public:
+        SharedPointer () : data (nullptr) {}
+        SharedPointer (const SharedPointer& _other) : data (_other.data) { retain(); }
+        SharedPointer (SharedPointer&& _other) : data (_other.data) { _other.data = nullptr; }
+       ~SharedPointer () { reset(); }
+
+        SharedPointer& operator= (const SharedPointer& _other) {
+            if (data != _other.data) {
+                reset();
+                data = _other.data;
+                retain();
+            }
+            return *this;
+        }
+
+        SharedPointer& operator= (SharedPointer&& _other) {
+            if (this != &_other) {
+                reset();
+                data = _other.data;
+                _other.data = nullptr;
+            }
+            return *this;
+        }
+
+        inline const T& load () const { return *data; }
+        inline void store (const T& _val) { *data = _val; }
+
+        inline T* get        () const { return data; }
+        inline T& operator*  () const { return *data; }
+        inline T* operator-> () const { return data; }
+        inline explicit operator bool () const { return data != nullptr; }
+
+        inline size_t count () const { return data ? BlockHeader<T>::of (data)->count : 0; }
+        inline MemoryManager* owner () const { return data ? BlockHeader<T>::of (data)->owner : nullptr; }
+
+        void reset () {
+            if (data != nullptr && --BlockHeader<T>::of (data)->count == 0) BlockHeader<T>::unmake (data);
+            data = nullptr;
+        }
+
+        template <class U, class... Args>
+        friend SharedPointer<U> makeSharedPointer (MemoryManager& _manager, Args&&... _args);
+
+    private:
+        explicit SharedPointer (T* _data) : data (_data) {}
+
+        inline void retain () { if (data != nullptr) ++BlockHeader<T>::of (data)->count; }
+
+        T* data; // the shared object, null when empty
+};
+
+/**
+ *  makeSmartPointer
+ *
+ *  _manager    the manager to allocate the object from
+ *  _args       forwarded to the constructor of T
+ *
+ *  Constructs a T in a block from _manager owned by a SmartPointer. The
+ *  pointer is empty when the manager is full.
+ */
+template <class T, class... Args>
+SmartPointer<T> makeSmartPointer (MemoryManager& _manager, Args&&... _args) {
+    return SmartPointer<T> (BlockHeader<T>::make (_manager, std::forward<Args>(_args)...));
+}
+
+/**
+ *  makeSharedPointer
+ *
+ *  _manager    the manager to allocate the object from
+ *  _args       forwarded to the constructor of T
+ *
+ *  Constructs a T in a block from _manager shared by SharedPointers.
+ *  The pointer is empty when the manager is full.
+ */
+template <class T, class... Args>
+SharedPointer<T> makeSharedPointer (MemoryManager& _manager, Args&&... _args) {
+    return SharedPointer<T> (BlockHeader<T>::make (_manager, std::forward<Args>(_args)...));
+}
+
+#endif /* SmartPointer_hpp */
@@ -0,0 +1,157 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  StackStrategy.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef StackStrategy_hpp
+#define StackStrategy_hpp
+
+#include "BytePointer.hpp"
+#include "Node.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ *  StackStrategy
+ *
+ *  bump allocation freed in LIFO order. Blocks are bumped off the
+ *  region and only the newest one can be freed, which rolls the region
+ *  back to the end of the block below it. A marker remembers how deep
+ *  the stack is, and freeing to it pops every block above it with one
+ *  rollback. A second stack grows down from the top of the preallocated
+ *  block, so long lived blocks can sit at one end while scratch blocks
+ *  come and go at the other. The padding needed to align a block counts
+ *  as used until the block is popped.
+ */
+class StackStrategy {
+    public:
+        struct Marker {
+            size_t depth; // the blocks on the stack when it was taken
+        };
+
+        template <class Region>
+        explicit StackStrategy (Region& _region) {}
+
+        /** return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocate (Region& _region, size_t _size, size_t _alignment) {
+            BytePointer block = _region.bump (_size, _alignment);
+            if (block == nullptr) return nullptr;
+
+            Node n;
+            n.size = _size;
+            n.data = block;
+            stack.push_back (n);
+            _region.allocated (block, _size);
+            return block;
+        }
+
+        /** return false unless _data is the newest block at either end */
+        template <class Region>
+        inline bool deallocate (Region& _region, void* _data) {
+            if (!stack.empty() && _data == stack.back().data) {
+                _region.freed (_data, stack.back().size);
+                stack.pop_back();
+                rewind (_region);
+                return true;
+            }
+            if (high.empty() || _data != high.back()) return false;
+
+            // the block reaches up to the one before it, or the top
+            high.pop_back();
+            BytePointer above = high.empty() ? _region.chunk (0)->begin + _region.chunk (0)->size : high.back();
+            _region.freed (_data, above - (BytePointer)_data);
+            _region.rewindHigh (high.empty() ? nullptr : high.back());
+            return true;
+        }
+
+        inline Marker marker () const { return Marker { stack.size() }; }
+
+        /** pops every block above _marker, each given to _freed, return false when they are already gone */
+        template <class Region, class Visit>
+        inline bool freeToMarker (Region& _region, Marker _marker, Visit _freed) {
+            if (_marker.depth > stack.size()) return false;
+
+            for (size_t i = _marker.depth; i < stack.size(); ++i) {
+                _freed (stack[i].data);
+                _region.freed (stack[i].data, stack[i].size);
+            }
+            stack.resize (_marker.depth);
+            rewind (_region);
+            return true;
+        }
+
+        /** from the top of the preallocated block down, freed by deallocate, return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocateHigh (Region& _region, size_t _size, size_t _alignment) {
+            BytePointer block = _region.bumpHigh (_size, _alignment);
+            if (block == nullptr) return nullptr;
+
+            high.push_back (block);
+            _region.allocated (block, _size);
+            return block;
+        }
+
+        /** all or nothing, return false on fail */
+        template <class Region>
+        bool allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out) {
+            for (size_t i = 0; i < _count; ++i) {
+                if ((_out[i] = allocate (_region, _size, _alignment)) == nullptr) {
+                    while (i > 0) deallocate (_region, _out[--i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** pops the blocks given newest first, returns the number freed, moved to the front of _data */
+        template <class Region>
+        size_t deallocateBatch (Region& _region, void** _data, size_t _count) {
+            size_t freed = 0;
+            for (size_t i = 0; i < _count; ++i) {
+                if (stack.empty() || _data[i] != stack.back().data) continue;
+
+                _region.freed (_data[i], stack.back().size);
+                stack.pop_back();
+                std::swap (_data[i], _data[freed++]);
+            }
+
+            // one rollback for the whole batch
+            rewind (_region);
+            return freed;
+        }
+
+        template <class Region>
+        void release (Region& _region) {
+            stack.clear();
+            high.clear();
+            _region.reset();
+        }
+
+        template <class Region>
+        inline bool freeable (Region& _region, void* _data) const {
+            return (!stack.empty() && stack.back().data == _data) || (!high.empty() && high.back() == _data);
+        }
+
+        /** the biggest block that fits without growing */
+        template <class Region>
+        inline size_t largestFree (const Region& _region) const { return _region.largestTail(); }
+
+        /** gaps looked at by the last allocate, bumping never searches */
+        inline size_t searchLength () const { return 0; }
+
+    private:
+        /** rolls the region back to the end of the newest block */
+        template <class Region>
+        inline void rewind (Region& _region) {
+            if (stack.empty()) _region.rewind (nullptr, 0);
+            else _region.rewind (stack.back().data, stack.back().size);
+        }
+
+        std::vector<Node>        stack; // live blocks, newest last
+        std::vector<BytePointer> high;  // live blocks at the top, newest last
+};
+
+#endif /* StackStrategy_hpp */
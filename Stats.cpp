@@ -0,0 +1,61 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Stats.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "Stats.hpp"
+
+#include <sstream>
+
+/**
+ *  json
+ *
+ *  the snapshot as a single JSON object, the histogram as an array with
+ *  one count per bucket.
+ */
+std::string Statistics::json () const {
+    std::ostringstream out;
+    out << "{\"allocations\":" << allocations
+        << ",\"frees\":" << frees
+        << ",\"failures\":" << failures
+        << ",\"occupied\":" << occupied
+        << ",\"peak\":" << peak
+        << ",\"total\":" << total
+        << ",\"largestFree\":" << largestFree
+        << ",\"fragmentation\":" << fragmentation
+        << ",\"averageSearch\":" << averageSearch
+        << ",\"histogram\":[";
+
+    for (size_t i = 0; i < STATS_BUCKETS; ++i) out << (i ? "," : "") << histogram[i];
+    out << "]}";
+    return out.str();
+}
+
+/**
+ *  Stats Constructor
+ *
+ *  every counter starts at zero.
+ */
+Stats::Stats () : allocations (0), frees (0), failures (0), peak (0), searches (0), steps (0) {
+    for (std::atomic<size_t>& bucket : histogram) bucket.store (0, std::memory_order_relaxed);
+}
+
+/**
+ *  collect
+ *
+ *  _stats  the snapshot to fill in
+ *
+ *  copies the counters into a snapshot, leaving the memory figures to
+ *  the manager.
+ */
+void Stats::collect (Statistics& _stats) const {
+    _stats.allocations = allocations.load (std::memory_order_relaxed);
+    _stats.frees       = frees.load (std::memory_order_relaxed);
+    _stats.failures    = failures.load (std::memory_order_relaxed);
+    _stats.peak        = peak.load (std::memory_order_relaxed);
+
+    size_t count = searches.load (std::memory_order_relaxed);
+    _stats.averageSearch = count ? (double)steps.load (std::memory_order_relaxed) / count : 0.0;
+
+    for (size_t i = 0; i < STATS_BUCKETS; ++i) _stats.histogram[i] = histogram[i].load (std::memory_order_relaxed);
+}
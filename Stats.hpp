@@ -0,0 +1,116 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Stats.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Stats_hpp
+#define Stats_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#define STATS_BUCKETS 32 // power of two size ranges in the histogram, the last one open ended
+
+/**
+ *  Statistics
+ *
+ *  a snapshot of what a manager has done since it was made. Bucket i of
+ *  the histogram counts allocations of [2^(i-1), 2^i) bytes, bucket 0
+ *  the empty ones. The fragmentation is the largest free block over the
+ *  free bytes, 1 when the free memory is all in one piece and falling
+ *  towards 0 as it splinters. The counts are only kept under the Stats
+ *  policy; under NoStats they stay zero and only the memory figures are
+ *  filled in.
+ */
+struct Statistics {
+    size_t allocations;   // successful allocations
+    size_t frees;         // successful deallocations
+    size_t failures;      // allocations that returned null
+    size_t occupied;      // bytes handed out right now, padding and all
+    size_t peak;          // the most bytes ever handed out at once
+    size_t total;         // bytes in every chunk
+    size_t largestFree;   // the biggest block that could be handed out now
+    double fragmentation; // largestFree over the free bytes
+    double averageSearch; // gaps looked at per allocation, Pool mode only
+    size_t histogram[STATS_BUCKETS];
+
+    std::string json () const;
+};
+
+/**
+ *  statsBucket
+ *
+ *  the histogram bucket of an allocation of _size bytes.
+ */
+inline unsigned statsBucket (size_t _size) {
+    unsigned bucket = 0;
+    while (_size != 0 && bucket < STATS_BUCKETS - 1) {
+        _size >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+/**
+ *  NoStats
+ *
+ *  the statistics policy of a manager that keeps none. Every hook is
+ *  empty, so they compile to nothing and the policy takes up no space.
+ */
+struct NoStats {
+    inline void allocated (size_t _size, void* _block, size_t _occupied) {}
+    inline void freed     (void* _data, bool _success) {}
+    inline void searched  (size_t _steps) {}
+    inline void collect   (Statistics& _stats) const {}
+};
+
+/**
+ *  Stats
+ *
+ *  the statistics policy of a manager that counts. The counters are
+ *  relaxed atomics, so reading them never tears and costs no fences on
+ *  the allocation path; a snapshot taken while other threads allocate
+ *  is only consistent counter by counter.
+ */
+class Stats {
+    public:
+        Stats ();
+
+        /** _block is null when the allocation failed */
+        inline void allocated (size_t _size, void* _block, size_t _occupied) {
+            if (_block == nullptr) {
+                failures.fetch_add (1, std::memory_order_relaxed);
+                return;
+            }
+
+            allocations.fetch_add (1, std::memory_order_relaxed);
+            histogram[statsBucket (_size)].fetch_add (1, std::memory_order_relaxed);
+            if (_occupied > peak.load (std::memory_order_relaxed)) peak.store (_occupied, std::memory_order_relaxed);
+        }
+
+        inline void freed (void* _data, bool _success) {
+            if (_success) frees.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        inline void searched (size_t _steps) {
+            searches.fetch_add (1, std::memory_order_relaxed);
+            steps.fetch_add (_steps, std::memory_order_relaxed);
+        }
+
+        void collect (Statistics& _stats) const;
+
+    private:
+        Stats (const Stats&) = delete;
+        Stats& operator= (const Stats&) = delete;
+
+        std::atomic<size_t> allocations; // successful allocations
+        std::atomic<size_t> frees;       // successful deallocations
+        std::atomic<size_t> failures;    // allocations that returned null
+        std::atomic<size_t> peak;        // the most bytes handed out at once
+        std::atomic<size_t> searches;    // allocations that searched for a gap
+        std::atomic<size_t> steps;       // gaps looked at by all of them
+        std::atomic<size_t> histogram[STATS_BUCKETS];
+};
+
+#endif /* Stats_hpp */
@@ -6,13 +6,78 @@
 #ifndef SystemQueries_hpp
 #define SystemQueries_hpp
 
+/**
+ *  Totals, limits and the page size never change while the program runs,
+ *  so each is asked for once and kept in a function local static. Only
+ *  availableSystemMemory samples the system on every call, since it is
+ *  the one that tracks memory pressure.
+ */
 #ifdef __APPLE__
     #include <unistd.h>
+    #include <mach/mach.h>
     inline unsigned long long totalMemoryUnix () {
         long pages = sysconf(_SC_PHYS_PAGES);
         long page_size = sysconf(_SC_PAGE_SIZE);
         return pages * page_size;
     }
+    inline unsigned long long availableMemoryUnix () {
+        vm_statistics64_data_t stats;
+        mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+        if (host_statistics64(mach_host_self(), HOST_VM_INFO64, (host_info64_t)&stats, &count) != KERN_SUCCESS) return 0;
+        return (unsigned long long)(stats.free_count + stats.inactive_count) * sysconf(_SC_PAGE_SIZE);
+    }
+    inline unsigned long long pageSizeUnix () {
+        return sysconf(_SC_PAGE_SIZE);
+    }
+#elif defined __linux__
+    #include <unistd.h>
+    #include <fstream>
+    #include <string>
+    inline unsigned long long totalMemoryLinux () {
+        long pages = sysconf(_SC_PHYS_PAGES);
+        long page_size = sysconf(_SC_PAGE_SIZE);
+        return (unsigned long long)pages * page_size;
+    }
+    inline unsigned long long availableMemoryLinux () {
+        // MemAvailable counts the reclaimable page cache, unlike free pages
+        std::ifstream meminfo ("/proc/meminfo");
+        std::string key;
+        unsigned long long kilobytes;
+        while (meminfo >> key >> kilobytes) {
+            if (key == "MemAvailable:") return kilobytes * 1024;
+            meminfo.ignore(256, '\n');
+        }
+        return (unsigned long long)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+    }
+    inline unsigned long long cgroupLimitLinux () {
+        // this process's groups, "0::/path" for v2 and "N:memory:/path" for v1
+        std::ifstream self ("/proc/self/cgroup");
+        std::string line, unified, memory;
+        while (std::getline(self, line)) {
+            if (line.compare(0, 3, "0::") == 0) unified = line.substr(3);
+            size_t controller = line.find(":memory:");
+            if (controller != std::string::npos) memory = line.substr(controller + 8);
+        }
+        if (unified == "/") unified.clear();
+        if (memory == "/") memory.clear();
+
+        for (std::string path : { "/sys/fs/cgroup" + unified + "/memory.max",
+                                  "/sys/fs/cgroup/memory" + memory + "/memory.limit_in_bytes",
+                                  std::string("/sys/fs/cgroup/memory/memory.limit_in_bytes") }) {
+            std::ifstream file (path);
+            std::string value;
+            if (!(file >> value)) continue;
+            if (value == "max") return 0;
+
+            // v1 reports no limit as a huge page aligned number
+            unsigned long long limit = std::stoull(value);
+            return (limit >= totalMemoryLinux()) ? 0 : limit;
+        }
+        return 0;
+    }
+    inline unsigned long long pageSizeLinux () {
+        return sysconf(_SC_PAGE_SIZE);
+    }
 #elif defined _WIN32 || defined _WIN64
     #include <windows.h>
     inline unsigned long long totalMemoryWin () {
@@ -21,18 +86,93 @@
         GlobalMemoryStatusEx(&status);
         return status.ullTotalPhys;
     }
+    inline unsigned long long availableMemoryWin () {
+        MEMORYSTATUSEX status;
+        status.dwLength = sizeof(status);
+        GlobalMemoryStatusEx(&status);
+        return status.ullAvailPhys;
+    }
+    inline unsigned long long pageSizeWin () {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    }
 #else
     #error "unknown platform"
 #endif
 
-unsigned long long totalSystemMemory () {
+/**
+ *  totalSystemMemory
+ *
+ *  the physical memory in the machine.
+ */
+inline unsigned long long totalSystemMemory () {
 #ifdef __APPLE__
-    return totalMemoryUnix ();
+    static const unsigned long long total = totalMemoryUnix ();
+#elif defined __linux__
+    static const unsigned long long total = totalMemoryLinux ();
 #elif defined _WIN32 || defined _WIN64
-    return totalMemoryWin  ();
+    static const unsigned long long total = totalMemoryWin ();
+#endif
+    return total;
+}
+
+/**
+ *  availableSystemMemory
+ *
+ *  the memory that can be handed out right now without swapping,
+ *  sampled afresh on every call.
+ */
+inline unsigned long long availableSystemMemory () {
+#ifdef __APPLE__
+    return availableMemoryUnix ();
+#elif defined __linux__
+    return availableMemoryLinux ();
+#elif defined _WIN32 || defined _WIN64
+    return availableMemoryWin ();
+#endif
+}
+
+/**
+ *  cgroupMemoryLimit
+ *
+ *  the memory limit of the container the process runs in, from cgroup
+ *  v2 or v1. returns 0 when there is no limit.
+ */
+inline unsigned long long cgroupMemoryLimit () {
+#ifdef __linux__
+    static const unsigned long long limit = cgroupLimitLinux ();
+    return limit;
 #else
-    #error "unknown platform"
+    return 0;
+#endif
+}
+
+/**
+ *  memoryLimit
+ *
+ *  the most memory the process can use, the container's limit when it
+ *  has one and the machine's memory otherwise.
+ */
+inline unsigned long long memoryLimit () {
+    unsigned long long limit = cgroupMemoryLimit ();
+    return (limit != 0 && limit < totalSystemMemory ()) ? limit : totalSystemMemory ();
+}
+
+/**
+ *  systemPageSize
+ *
+ *  the size of a base page.
+ */
+inline unsigned long long systemPageSize () {
+#ifdef __APPLE__
+    static const unsigned long long page = pageSizeUnix ();
+#elif defined __linux__
+    static const unsigned long long page = pageSizeLinux ();
+#elif defined _WIN32 || defined _WIN64
+    static const unsigned long long page = pageSizeWin ();
 #endif
+    return page;
 }
 
 #endif /* SystemQueries_h */
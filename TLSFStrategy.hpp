@@ -0,0 +1,383 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  TLSFStrategy.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef TLSFStrategy_hpp
+#define TLSFStrategy_hpp
+
+#include "BytePointer.hpp"
+#include "Bits.hpp"
+#include "Sanitizer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#define TLSF_SL_LOG   4                             // second level lists per first level, as a power of two
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG)
+#define TLSF_FL_COUNT 40                            // first level lists, the last holds blocks up to 2^47 bytes
+#define TLSF_GRANULE  16                            // block sizes are multiples, and a free block fits two links
+#define TLSF_HEADER   (2 * sizeof(void*))           // the boundary tag in front of every block
+#define TLSF_MINIMUM  (TLSF_HEADER + TLSF_GRANULE)  // the smallest block, tag and all
+#define TLSF_SMALL    (TLSF_SL_COUNT * TLSF_GRANULE) // below this a list per granule size
+#define TLSF_LARGEST  (size_t(1) << 45)             // the largest request, still a valid list once rounded
+#define TLSF_FREE     size_t(1)                     // the low bit of a size, sizes being whole granules
+
+/**
+ *  TLSFStrategy
+ *
+ *  two level segregated fit: variable size blocks freed in any order
+ *  in constant time, however many blocks are live or free. Free blocks
+ *  are kept in lists by size, a power of two range at the first level
+ *  split into sixteen equal ranges at the second, and a bit per list
+ *  says whether it has a block. Allocation rounds the request up to the
+ *  next list boundary, so any block in the first nonempty list at or
+ *  above it fits, and finds that list with two find first set
+ *  instructions. Every block has a boundary tag holding its size and
+ *  the block before it, so a freed block merges with free neighbours on
+ *  both sides without a search. A block counts its tag as used.
+ */
+class TLSFStrategy {
+    public:
+        template <class Region>
+        explicit TLSFStrategy (Region& _region) : firsts (0), heads (TLSF_FL_COUNT * TLSF_SL_COUNT, nullptr), steps (0) {
+            std::fill (seconds, seconds + TLSF_FL_COUNT, 0);
+            format (_region.chunk (0));
+        }
+
+        /** return nullptr on fail */
+        template <class Region>
+        inline BytePointer allocate (Region& _region, size_t _size, size_t _alignment) {
+            if (_size == 0) _size = 1;
+            if (_size > TLSF_LARGEST || _alignment > TLSF_LARGEST) return nullptr;
+
+            // an aligned block needs room to split its padding off as a block of its own
+            size_t size   = (_size + TLSF_GRANULE - 1) & ~(size_t)(TLSF_GRANULE - 1);
+            size_t search = (_alignment > TLSF_GRANULE) ? size + _alignment + TLSF_MINIMUM : size;
+            steps = 0;
+
+            Block* block = find (search);
+            if (block == nullptr && grow (_region, search)) block = find (search);
+            if (block == nullptr) return nullptr;
+
+            remove (block);
+            if (_alignment > TLSF_GRANULE) block = align (block, _alignment);
+            trim (block, size);
+
+            _region.enter (_region.chunkOf (block));
+            _region.occupy (sizeOf (block) + TLSF_HEADER);
+            _region.allocated (payload (block), _size);
+            return payload (block);
+        }
+
+        /** return false when _data is not a live block */
+        template <class Region>
+        inline bool deallocate (Region& _region, void* _data) {
+            auto chunk = _region.chunkOf (_data);
+            if (!live (chunk, (BytePointer)_data)) return false;
+
+            Block* block = (Block*)((BytePointer)_data - TLSF_HEADER);
+            _region.vacate (sizeOf (block) + TLSF_HEADER);
+            _region.freed (_data, sizeOf (block));
+            block->size |= TLSF_FREE;
+
+            // free neighbours are merged in, so no two free blocks ever touch
+            Block* after = next (block);
+            if (after->size & TLSF_FREE) {
+                remove (after);
+                block->size += sizeOf (after) + TLSF_HEADER;
+                next (block)->prev = block;
+                sanitizerPoison (after, TLSF_HEADER);
+            }
+            if (block->prev != nullptr && (block->prev->size & TLSF_FREE)) {
+                Block* before = block->prev;
+                remove (before);
+                before->size += sizeOf (block) + TLSF_HEADER;
+                sanitizerPoison (block, TLSF_HEADER);
+                block = before;
+                next (block)->prev = block;
+            }
+            insert (block);
+
+            // an empty chunk is one free block, which goes with it
+            if (_region.leave (chunk)) {
+                remove (block);
+                _region.drop (chunk);
+            }
+            return true;
+        }
+
+        /** all or nothing, return false on fail */
+        template <class Region>
+        bool allocateBatch (Region& _region, size_t _size, size_t _alignment, size_t _count, void** _out) {
+            for (size_t i = 0; i < _count; ++i) {
+                if ((_out[i] = allocate (_region, _size, _alignment)) == nullptr) {
+                    while (i > 0) deallocate (_region, _out[--i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** returns the number freed, moved to the front of _data */
+        template <class Region>
+        size_t deallocateBatch (Region& _region, void** _data, size_t _count) {
+            size_t freed = 0;
+            for (size_t i = 0; i < _count; ++i) {
+                if (deallocate (_region, _data[i])) std::swap (_data[i], _data[freed++]);
+            }
+            return freed;
+        }
+
+        template <class Region>
+        void release (Region& _region) {
+            firsts = 0;
+            std::fill (seconds, seconds + TLSF_FL_COUNT, 0);
+            std::fill (heads.begin(), heads.end(), nullptr);
+
+            // format only writes the first tag, so the old ones would still pass for live
+            for (size_t i = 0; i < _region.count(); ++i) retire (_region.chunk (i));
+
+            _region.reset();
+            for (size_t i = 0; i < _region.count(); ++i) format (_region.chunk (i));
+        }
+
+        template <class Region>
+        inline bool freeable (Region& _region, void* _data) const {
+            return live (_region.chunkOf (_data), (BytePointer)_data);
+        }
+
+        /** the biggest request sure to fit without growing, the bottom of the highest nonempty list */
+        template <class Region>
+        size_t largestFree (const Region& _region) const {
+            if (firsts == 0) return 0;
+
+            unsigned fl = highestBit (firsts);
+            unsigned sl = highestBit (seconds[fl]);
+            if (fl == 0) return sl * TLSF_GRANULE;
+
+            unsigned bit = fl + highestBit (TLSF_SMALL) - 1;
+            return (size_t(1) << bit) + ((size_t)sl << (bit - TLSF_SL_LOG));
+        }
+
+        /** bitmap words looked at by the last allocate, one or two */
+        inline size_t searchLength () const { return steps; }
+
+    private:
+        struct Block {
+            Block* prev; // the block before in the chunk, null for the first
+            size_t size; // bytes after the tag, and TLSF_FREE
+            Block* next; // free blocks only, the next in their list
+            Block* last; // free blocks only, the one before in their list
+        };
+
+        static inline size_t      sizeOf  (const Block* _block) { return _block->size & ~TLSF_FREE; }
+        static inline BytePointer payload (Block* _block) { return (BytePointer)_block + TLSF_HEADER; }
+        static inline Block*      next    (Block* _block) { return (Block*)(payload (_block) + sizeOf (_block)); }
+
+        /** the list a block of _size belongs in, rounding down */
+        static inline void mapping (size_t _size, unsigned& _fl, unsigned& _sl) {
+            if (_size < TLSF_SMALL) {
+                _fl = 0;
+                _sl = (unsigned)(_size / TLSF_GRANULE);
+                return;
+            }
+            unsigned bit = highestBit (_size);
+            _sl = (unsigned)(_size >> (bit - TLSF_SL_LOG)) ^ TLSF_SL_COUNT;
+            _fl = bit - (highestBit (TLSF_SMALL) - 1);
+        }
+
+        /** the first block of the first nonempty list every block of which holds _size */
+        inline Block* find (size_t _size) {
+            if (_size >= TLSF_SMALL) _size += (size_t(1) << (highestBit (_size) - TLSF_SL_LOG)) - 1;
+
+            unsigned fl, sl;
+            mapping (_size, fl, sl);
+            if (fl >= TLSF_FL_COUNT) return nullptr;
+
+            ++steps;
+            uint32_t bits = seconds[fl] & (~uint32_t(0) << sl);
+            if (bits == 0) {
+                ++steps;
+                uint64_t above = (fl + 1 < 64) ? firsts & (~uint64_t(0) << (fl + 1)) : 0;
+                if (above == 0) return nullptr;
+
+                fl   = lowestBit (above);
+                bits = seconds[fl];
+            }
+            return heads[fl * TLSF_SL_COUNT + lowestBit (bits)];
+        }
+
+        inline void insert (Block* _block) {
+            unsigned fl, sl;
+            mapping (sizeOf (_block), fl, sl);
+
+            Block*& head = heads[fl * TLSF_SL_COUNT + sl];
+            sanitizerUnpoison (&_block->next, 2 * sizeof(Block*));
+            _block->next = head;
+            _block->last = nullptr;
+            if (head != nullptr) head->last = _block;
+            head = _block;
+
+            firsts      |= uint64_t(1) << fl;
+            seconds[fl] |= uint32_t(1) << sl;
+        }
+
+        inline void remove (Block* _block) {
+            unsigned fl, sl;
+            mapping (sizeOf (_block), fl, sl);
+
+            if (_block->next != nullptr) _block->next->last = _block->last;
+            if (_block->last != nullptr) _block->last->next = _block->next;
+            else if ((heads[fl * TLSF_SL_COUNT + sl] = _block->next) == nullptr) {
+                seconds[fl] &= ~(uint32_t(1) << sl);
+                if (seconds[fl] == 0) firsts &= ~(uint64_t(1) << fl);
+            }
+            sanitizerPoison (&_block->next, 2 * sizeof(Block*));
+        }
+
+        /**
+         *  splits the padding in front of the first aligned address off
+         *  _block, a free block taken from its list, and frees it. The
+         *  padding is pushed on to the next aligned address when it is
+         *  too small to be a block. returns the aligned block.
+         */
+        inline Block* align (Block* _block, size_t _alignment) {
+            size_t gap = alignmentPadding (payload (_block), _alignment);
+            if (gap == 0) return _block;
+            if (gap < TLSF_MINIMUM) gap += _alignment;
+
+            Block* aligned = (Block*)((BytePointer)_block + gap);
+            sanitizerUnpoison (aligned, TLSF_HEADER);
+            aligned->prev  = _block;
+            aligned->size  = sizeOf (_block) - gap;
+            next (aligned)->prev = aligned;
+
+            _block->size = (gap - TLSF_HEADER) | TLSF_FREE;
+            insert (_block);
+            return aligned;
+        }
+
+        /** marks _block used, freeing whatever it has past _size when that is big enough for a block */
+        inline void trim (Block* _block, size_t _size) {
+            size_t size = sizeOf (_block);
+            _block->size = size;
+            if (size - _size < TLSF_MINIMUM) return;
+
+            Block* rest = (Block*)(payload (_block) + _size);
+            sanitizerUnpoison (rest, TLSF_HEADER);
+            rest->prev  = _block;
+            rest->size  = (size - _size - TLSF_HEADER) | TLSF_FREE;
+            next (rest)->prev = rest;
+
+            _block->size = _size;
+            insert (rest);
+        }
+
+        /** the first block of _chunk */
+        template <class Chunk>
+        static inline Block* first (const Chunk* _chunk) {
+            return (Block*)(_chunk->begin + alignmentPadding (_chunk->begin, TLSF_GRANULE));
+        }
+
+        /**
+         *  whether _data is the payload of a block in use in _chunk. A
+         *  pointer that is not must get past the bounds of the chunk and
+         *  be named as the block before by the tag its size leads to.
+         */
+        template <class Chunk>
+        static inline bool live (const Chunk* _chunk, BytePointer _data) {
+            BytePointer end = _chunk->begin + _chunk->size;
+            if (_data < (BytePointer)first (_chunk) + TLSF_HEADER || _data + TLSF_HEADER > end) return false;
+            if ((uintptr_t)_data % TLSF_GRANULE != 0) return false;
+
+            // a tag is never poisoned, so freed memory is never read
+            Block* block = (Block*)(_data - TLSF_HEADER);
+            if (sanitizerPoisoned (block, TLSF_HEADER)) return false;
+            if ((block->size & (TLSF_GRANULE - 1)) || block->size > (size_t)(end - _data) - TLSF_HEADER) return false;
+            return !sanitizerPoisoned (next (block), TLSF_HEADER) && next (block)->prev == block;
+        }
+
+        template <class Region>
+        bool grow (Region& _region, size_t _size);
+
+        template <class Chunk>
+        void format (Chunk* _chunk);
+
+        template <class Chunk>
+        static void retire (Chunk* _chunk);
+
+        uint64_t            firsts;                 // a bit per first level with a nonempty list
+        uint32_t            seconds[TLSF_FL_COUNT]; // a bit per nonempty list of each first level
+        std::vector<Block*> heads;                  // the free lists, second level within first
+        size_t              steps;                  // bitmap words looked at by the last allocate
+};
+
+/**
+ *  grow
+ *
+ *  _region the region to grow
+ *  _size   the search size of the block
+ *
+ *  Chains a chunk with room for a block big enough to be found for
+ *  _size once it is rounded up to its list, with the first tag and the
+ *  end tag, and frees it. returns false when the region cannot grow.
+ */
+template <class Region>
+bool TLSFStrategy::grow (Region& _region, size_t _size) {
+    size_t round = (_size >= TLSF_SMALL) ? size_t(1) << (highestBit (_size) - TLSF_SL_LOG) : TLSF_GRANULE;
+    auto   chunk = _region.grow (_size + round + 2 * TLSF_HEADER + TLSF_GRANULE);
+    if (chunk == nullptr) return false;
+
+    format (chunk);
+    return true;
+}
+
+/**
+ *  format
+ *
+ *  _chunk  an empty chunk
+ *
+ *  Makes the whole chunk one free block followed by an end tag, a block
+ *  of no size always in use, so nothing merges past either end of it.
+ */
+template <class Chunk>
+void TLSFStrategy::format (Chunk* _chunk) {
+    Block* block = first (_chunk);
+    if ((BytePointer)block + TLSF_MINIMUM + TLSF_HEADER > _chunk->begin + _chunk->size) return;
+
+    size_t area = (size_t)(_chunk->begin + _chunk->size - (BytePointer)block) & ~(size_t)(TLSF_GRANULE - 1);
+
+    sanitizerUnpoison (block, TLSF_HEADER);
+    block->prev = nullptr;
+    block->size = (area - 2 * TLSF_HEADER) | TLSF_FREE;
+
+    Block* end = next (block);
+    sanitizerUnpoison (end, TLSF_HEADER);
+    end->prev = block;
+    end->size = 0;
+    insert (block);
+}
+
+/**
+ *  retire
+ *
+ *  _chunk  a formatted chunk about to be emptied
+ *
+ *  Walks the tags of _chunk up to its end tag and marks every block
+ *  free, which live never accepts, so a pointer handed out before a
+ *  release is refused rather than freed into the new free lists.
+ */
+template <class Chunk>
+void TLSFStrategy::retire (Chunk* _chunk) {
+    Block* block = first (_chunk);
+    if ((BytePointer)block + TLSF_MINIMUM + TLSF_HEADER > _chunk->begin + _chunk->size) return;
+
+    for (; sizeOf (block) != 0; block = next (block)) block->size |= TLSF_FREE;
+}
+
+#endif /* TLSFStrategy_hpp */
@@ -0,0 +1,132 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  AllocatorTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef AllocatorTest_hpp
+#define AllocatorTest_hpp
+
+#include "MemoryManager.hpp"
+#include "MemoryManagerAllocator.hpp"
+#include "UnitTest.hpp"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define ALLOCATOR_SIZE (1 << 20)
+
+class AllocatorTest : public UnitTest {
+public:
+    AllocatorTest () {}
+   ~AllocatorTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Allocator Test"; }
+    
+    void run () override {
+        // run tests
+        CreateTest     ();
+        ArrayTest      ();
+        ContainerTest  ();
+        
+        // show results
+        show           ();
+    }
+    
+    /**
+     *  counts its constructions and destructions
+     */
+    struct Tracked {
+        static int alive;
+        double value;
+        Tracked (double _value = 0.0) : value (_value) { ++alive; }
+       ~Tracked () { --alive; }
+    };
+    
+    /**
+     *  Tests objects are constructed and destroyed in place
+     */
+    void CreateTest () {
+        MemoryManager manager (MemoryManager::Mode::Stack, POOL_SIZE);
+        Tracked::alive = 0;
+        
+        Tracked* a = manager.create<Tracked>(3.14159);
+        assert("Create Test 1", true, a != nullptr);
+        assert("Create Test 2", 3.14159, a->value);
+        assert("Create Test 3", 1, Tracked::alive);
+        
+        std::string* b = manager.create<std::string>(8, 'A');
+        assert("Create Test 4", std::string("AAAAAAAA"), *b);
+        
+        // a is not on top of the stack, so it must be left alone
+        assert("Destroy Test 1", false, manager.destroy(a));
+        assert("Destroy Test 2", 1, Tracked::alive);
+        
+        assert("Destroy Test 3", true, manager.destroy(b));
+        assert("Destroy Test 4", true, manager.destroy(a));
+        assert("Destroy Test 5", 0, Tracked::alive);
+        assert("Destroy Test 6", 0, manager.occupiedMemory());
+    }
+    
+    /**
+     *  Tests arrays are built and torn down element by element
+     */
+    void ArrayTest () {
+        MemoryManager manager (MemoryManager::Mode::Pool, POOL_SIZE);
+        Tracked::alive = 0;
+        
+        Tracked* a = manager.createArray<Tracked>(16);
+        assert("Array Test 1", true, a != nullptr);
+        assert("Array Test 2", 16, Tracked::alive);
+        assert("Array Test 3", 0.0, a[15].value);
+        
+        assert("Array Test 4", true, manager.destroyArray(a, 16));
+        assert("Array Test 5", 0, Tracked::alive);
+        assert("Array Test 6", true, manager.createArray<Tracked>(POOL_SIZE) == nullptr);
+    }
+    
+    /**
+     *  Tests standard containers can draw from a manager
+     */
+    void ContainerTest () {
+        MemoryManager manager (MemoryManager::Mode::Pool, ALLOCATOR_SIZE);
+        MemoryManagerAllocator<int> allocator (manager);
+        
+        {
+            std::vector<int, MemoryManagerAllocator<int>> numbers (allocator);
+            for (int i = 0; i < TEST_DEPTH; ++i) numbers.push_back(i);
+            assert("Container Test 1", TEST_DEPTH - 1, numbers.back());
+            
+            typedef std::pair<const int, int> Entry;
+            std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, MemoryManagerAllocator<Entry>>
+                squares (16, std::hash<int>(), std::equal_to<int>(), allocator);
+            for (int i = 0; i < TEST_DEPTH; ++i) squares[i] = i * i;
+            assert("Container Test 2", 1024, squares[32]);
+            
+            std::map<int, int, std::less<int>, MemoryManagerAllocator<Entry>> ordered (allocator);
+            for (int i = TEST_DEPTH; i > 0; --i) ordered[i] = -i;
+            assert("Container Test 3", 1, ordered.begin()->first);
+            
+            assert("Container Test 4", true, manager.occupiedMemory() > TEST_DEPTH * sizeof(int));
+        }
+        
+        // every node and buffer went back to the manager
+        assert("Container Test 5", 0, manager.occupiedMemory());
+        
+        bool threw = false;
+        try {
+            std::vector<int, MemoryManagerAllocator<int>> huge (ALLOCATOR_SIZE, 0, allocator);
+        } catch (const std::bad_alloc&) {
+            threw = true;
+        }
+        assert("Container Test 6", true, threw);
+    }
+};
+
+int AllocatorTest::Tracked::alive = 0;
+
+#endif /* AllocatorTest_hpp */
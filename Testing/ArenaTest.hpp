@@ -0,0 +1,126 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ArenaTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef ArenaTest_hpp
+#define ArenaTest_hpp
+
+#include "Arena.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#define ARENA_SIZE    (1 << 20)
+#define ARENA_THREADS 4
+
+class ArenaTest : public UnitTest {
+public:
+    ArenaTest () {}
+   ~ArenaTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Arena Test"; }
+    
+    void run () override {
+        // run tests
+        ArenaCorrectnessTest ();
+        ArenaSharedTest      ();
+        ArenaSpeedTest       ();
+        
+        // show results
+        show                 ();
+    }
+    
+    /**
+     *  Tests the Arena implementation for correctness
+     */
+    void ArenaCorrectnessTest () {
+        Arena arena (POOL_SIZE);
+        
+        bool*   a = (bool*)   arena.allocate (sizeof(bool));
+        double* b = (double*) arena.allocate (sizeof(double));
+        assert("Arena Allocation Test 1", true, a != nullptr && b != nullptr);
+        assert("Arena Allocation Test 2", 0, (uintptr_t)b % ARENA_ALIGNMENT);
+        assert("Arena Allocation Test 3", 2 * ARENA_ALIGNMENT, arena.occupiedMemory());
+        
+        *a = true;
+        *b = 3.14159;
+        assert("Arena Allocation Test 4", true, *a);
+        assert("Arena Allocation Test 5", 3.14159, *b);
+        
+        char* c = (char*) arena.allocate (sizeof(char), 64);
+        assert("Arena Allocation Test 6", 0, (uintptr_t)c % 64);
+        
+        // sizes that would wrap once rounded or added are refused, and take nothing
+        size_t used = arena.occupiedMemory();
+        assert("Arena Allocation Test 7", (void*)nullptr, arena.allocate(size_t(-1) - 4));
+        assert("Arena Allocation Test 8", (void*)nullptr, arena.allocate(size_t(-1) - 4, 64));
+        assert("Arena Allocation Test 9", used, arena.occupiedMemory());
+        
+        // fill it up, the last request must fail
+        while (arena.allocate(sizeof(int)) != nullptr) {}
+        assert("Arena Fill Test", arena.totalMemory(), arena.occupiedMemory());
+        
+        arena.release();
+        assert("Arena Release Test 1", 0, arena.occupiedMemory());
+        assert("Arena Release Test 2", (void*)a, arena.allocate(sizeof(int)));
+    }
+    
+    /**
+     *  Tests threads sharing an arena never get overlapping blocks
+     */
+    void ArenaSharedTest () {
+        Arena arena (ARENA_SIZE);
+        std::vector<std::vector<char*>> blocks (ARENA_THREADS);
+        
+        std::vector<std::thread> workers;
+        for (int t = 0; t < ARENA_THREADS; ++t) {
+            workers.emplace_back ([&, t] () {
+                char* p;
+                while ((p = (char*)arena.allocate(24)) != nullptr) blocks[t].push_back(p);
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        
+        std::vector<char*> all;
+        for (auto& list : blocks) all.insert(all.end(), list.begin(), list.end());
+        std::sort(all.begin(), all.end());
+        
+        bool disjoint = true;
+        for (size_t i = 1; i < all.size(); ++i) disjoint = disjoint && all[i] - all[i - 1] >= 24;
+        assert("Arena Shared Test 1", true, disjoint);
+        assert("Arena Shared Test 2", (size_t)(ARENA_SIZE / 32), all.size());
+    }
+    
+    /**
+     *  Tests the Arena implementation for speed vs new
+     */
+    void ArenaSpeedTest () {
+        Arena arena (TEST_DEPTH * ARENA_ALIGNMENT);
+        std::vector<int*> blocks (TEST_DEPTH);
+        
+        // allocate a load of data with new
+        clock_t newStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
+        double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
+        
+        // allocate a load of data with the arena
+        clock_t managedStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = (int*)arena.allocate(sizeof(int));
+        double managedTime = (double)(clock() - managedStart) / CLOCKS_PER_SEC;
+        
+        // show the times and check the arena served every request
+        std::cout << "new:   " << newTime     << " s" << std::endl;
+        std::cout << "arena: " << managedTime << " s" << std::endl;
+        std::cout << std::endl;
+        assert("Arena Speed Test", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+    }
+};
+
+#endif /* ArenaTest_hpp */
@@ -0,0 +1,175 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BackingTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BackingTest_hpp
+#define BackingTest_hpp
+
+#include "MemoryManager.hpp"
+#include "Backing.hpp"
+#include "UnitTest.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define BACKING_SIZE  (size_t(64) << 20) // well past what the TLB covers with small pages
+#define BACKING_STEPS (1 << 21)
+#define BACKING_SLOT  64
+
+class BackingTest : public UnitTest {
+public:
+    BackingTest () {}
+   ~BackingTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Backing Test"; }
+    
+    void run () override {
+        // run tests
+        BackingMappedTest  ();
+        BackingDiscardTest ();
+        BackingReleaseTest ();
+        BackingGrowthTest  ();
+        BackingSpeedTest   ();
+        
+        // show results
+        show               ();
+    }
+    
+    /**
+     *  Tests mapped memory works in each mode, with or without huge pages
+     */
+    void BackingMappedTest () {
+        MemoryManager stack (MemoryManager::Mode::Stack, POOL_SIZE, Backing (Backing::Mapped));
+        MemoryManager pool  (MemoryManager::Mode::Pool, 2 * MemoryManager::Page, Backing (Backing::Mapped, Backing::Populate));
+        MemoryManager huge  (MemoryManager::Mode::Pool, POOL_SIZE, Backing (Backing::Mapped, Backing::HugePages));
+        
+        int* a = (int*) stack.allocate(sizeof(int));
+        int* b = (int*) pool.allocate(sizeof(int), MemoryManager::Page);
+        int* c = (int*) huge.allocate(sizeof(int));
+        assert("Backing Mapped Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+        if (a == nullptr || b == nullptr || c == nullptr) return;
+        assert("Backing Mapped Test 2", 0, (uintptr_t)b % MemoryManager::Page);
+        
+        *a = 1;
+        *b = 2;
+        *c = 3;
+        assert("Backing Mapped Test 3", 6, *a + *b + *c);
+        assert("Backing Mapped Test 4", true, stack.deallocate(a) && pool.deallocate(b) && huge.deallocate(c));
+        assert("Backing Mapped Test 5", (size_t)POOL_SIZE, huge.totalMemory());
+    }
+    
+    /**
+     *  Tests release hands mapped pages back to the system
+     */
+    void BackingDiscardTest () {
+        MemoryManager memory (MemoryManager::Mode::Stack, 4 * Backing::pageSize(), Backing (Backing::Mapped));
+        
+        char* a = (char*) memory.allocate(3 * Backing::pageSize());
+        memset(a, 0xAB, 3 * Backing::pageSize());
+        memory.release();
+        
+        char* b = (char*) memory.allocate(3 * Backing::pageSize());
+        assert("Backing Discard Test 1", (void*)a, (void*)b);
+#ifdef __linux__
+        // dropped anonymous pages come back zeroed, unless guarding filled them again
+        if (!MemoryManager::guarded()) assert("Backing Discard Test 2", 0, (int)b[0] + (int)b[3 * Backing::pageSize() - 1]);
+#endif
+    }
+    
+    /**
+     *  Tests every mode rebuilds what it keeps in the region after a release drops the pages
+     */
+    void BackingReleaseTest () {
+        std::vector<std::pair<std::string, MemoryManager::Mode>> modes {
+            { "Stack", MemoryManager::Stack }, { "Queue", MemoryManager::Queue }, { "Pool", MemoryManager::Pool },
+            { "Bitmap", MemoryManager::Bitmap }, { "Buddy", MemoryManager::Buddy }, { "TLSF", MemoryManager::TLSF }
+        };
+        
+        for (auto& mode : modes) {
+            MemoryManager memory (mode.second, 16 * Backing::pageSize(), Backing (Backing::Mapped));
+            
+            // touch every page, so a release has something to drop
+            char* a = (char*) memory.allocate(4 * Backing::pageSize());
+            if (a != nullptr) memset(a, 0xAB, 4 * Backing::pageSize());
+            memory.release();
+            
+            char* b = (char*) memory.allocate(100);
+            char* c = (char*) memory.allocate(Backing::pageSize());
+            assert("Backing Release Test " + mode.first, true, a != nullptr && b != nullptr && c != nullptr);
+            if (b == nullptr || c == nullptr) continue;
+            
+            b[99] = 'A';
+            c[Backing::pageSize() - 1] = 'B';
+            assert("Backing Release Test " + mode.first + " Contents", true, b[99] == 'A' && c[Backing::pageSize() - 1] == 'B');
+            assert("Backing Release Test " + mode.first + " Free", true, memory.deallocate(c) && memory.deallocate(b));
+            assert("Backing Release Test " + mode.first + " Empty", 0, memory.occupiedMemory());
+        }
+    }
+    
+    /**
+     *  Tests mapped chunks are chained on and unmapped again
+     */
+    void BackingGrowthTest () {
+        MemoryManager::Growth growth { MemoryManager::Growth::Fixed, CHUNK_GRANULE, 0 };
+        MemoryManager memory (MemoryManager::Mode::Pool, POOL_SIZE, growth, Backing (Backing::Mapped));
+        
+        std::vector<void*> blocks;
+        for (int i = 0; i < 64; ++i) blocks.push_back(memory.allocate(CHUNK_GRANULE / 2));
+        assert("Backing Growth Test 1", true, blocks.back() != nullptr);
+        
+        for (void* block : blocks) memory.deallocate(block);
+        assert("Backing Growth Test 2", (size_t)POOL_SIZE, memory.totalMemory());
+    }
+    
+    /**
+     *  Reports random access throughput over each kind of backing. Every
+     *  access lands on a random cache line, so with small pages nearly
+     *  every one misses the TLB as well as the cache.
+     */
+    void BackingSpeedTest () {
+        std::vector<std::pair<std::string, Backing>> backings {
+            { "heap:             ", Backing (Backing::Heap) },
+            { "mapped:           ", Backing (Backing::Mapped) },
+            { "mapped, populated:", Backing (Backing::Mapped, Backing::Populate) },
+            { "mapped, 2MB pages:", Backing (Backing::Mapped, Backing::HugePages | Backing::Populate) }
+        };
+        
+        for (auto& backing : backings) {
+            std::string name = "Backing Speed Test " + backing.first.substr(0, backing.first.find(':'));
+            MemoryManager memory (MemoryManager::Mode::Stack, BACKING_SIZE + MemoryManager::span(0, BACKING_SLOT), backing.second);
+            size_t** slots = (size_t**) memory.allocate(BACKING_SIZE - BACKING_SLOT, BACKING_SLOT);
+            if (slots == nullptr) {
+                assert(name, true, false);
+                continue;
+            }
+            size_t   count = (BACKING_SIZE - BACKING_SLOT) / BACKING_SLOT;
+            size_t   step  = BACKING_SLOT / sizeof(size_t*);
+            
+            // one random cycle through every slot, so the chase never repeats early
+            std::vector<size_t> order (count);
+            for (size_t i = 0; i < count; ++i) order[i] = i;
+            std::mt19937_64 random (42);
+            for (size_t i = count - 1; i > 0; --i) std::swap(order[i], order[random() % i]);
+            for (size_t i = 0; i < count; ++i) slots[order[i] * step] = (size_t*)&slots[order[(i + 1) % count] * step];
+            
+            auto start = std::chrono::steady_clock::now();
+            size_t* p = (size_t*)slots;
+            for (int i = 0; i < BACKING_STEPS; ++i) p = *(size_t**)p;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            
+            std::cout << backing.first << " " << BACKING_STEPS / seconds / 1e6 << " M accesses/s" << std::endl;
+            assert(name, true, p != nullptr);
+        }
+        std::cout << std::endl;
+    }
+};
+
+#endif /* BackingTest_hpp */
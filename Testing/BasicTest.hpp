@@ -0,0 +1,121 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BasicTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BasicTest_hpp
+#define BasicTest_hpp
+
+#include "BasicMemoryManager.hpp"
+#include "StackStrategy.hpp"
+#include "QueueStrategy.hpp"
+#include "PoolStrategy.hpp"
+#include "UnitTest.hpp"
+
+#include <thread>
+#include <vector>
+
+#define BASIC_THREADS 4
+#define BASIC_ROUNDS  4096
+
+class BasicTest : public UnitTest {
+public:
+    BasicTest () {}
+   ~BasicTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Basic Test"; }
+    
+    void run () override {
+        // run tests
+        BasicStrategyTest ();
+        BasicSizeTest     ();
+        BasicHugeTest     ();
+        BasicLockedTest   ();
+        
+        // show results
+        show              ();
+    }
+    
+    /**
+     *  Tests each strategy chosen at compile time
+     */
+    void BasicStrategyTest () {
+        BasicMemoryManager<StackStrategy> stack (POOL_SIZE);
+        BasicMemoryManager<QueueStrategy> queue (POOL_SIZE);
+        BasicMemoryManager<PoolStrategy>  pool  (POOL_SIZE, Growth { Growth::None, 0, 0 }, Backing(), FreeIndex::BestFit);
+        
+        void* a = stack.allocate(sizeof(int));
+        void* b = stack.allocate(sizeof(int));
+        assert("Basic Stack Test 1", false, stack.deallocate(a));
+        assert("Basic Stack Test 2", true, stack.deallocate(b) && stack.deallocate(a));
+        assert("Basic Stack Test 3", (size_t)0, stack.occupiedMemory());
+        
+        a = queue.allocate(sizeof(int));
+        b = queue.allocate(sizeof(int));
+        assert("Basic Queue Test 1", true, queue.deallocate(a) && queue.deallocate(b));
+        assert("Basic Queue Test 2", (size_t)0, queue.occupiedMemory());
+        
+        a = pool.allocate(sizeof(int));
+        b = pool.allocate(sizeof(int), 64);
+        assert("Basic Pool Test 1", 0, (int)((uintptr_t)b % 64));
+        assert("Basic Pool Test 2", true, pool.deallocate(a) && pool.deallocate(b));
+        assert("Basic Pool Test 3", (size_t)0, pool.occupiedMemory());
+        assert("Basic Pool Test 4", (void*)nullptr, pool.allocate(POOL_SIZE));
+    }
+    
+    /**
+     *  Tests the empty policies add nothing to the manager
+     */
+    void BasicSizeTest () {
+        assert("Basic Size Test 1", sizeof(Region<>) + sizeof(StackStrategy), sizeof(BasicMemoryManager<StackStrategy>));
+        assert("Basic Size Test 2", sizeof(Region<>) + sizeof(PoolStrategy),  sizeof(BasicMemoryManager<PoolStrategy>));
+        assert("Basic Size Test 3", true, sizeof(BasicMemoryManager<PoolStrategy, Locked>) > sizeof(BasicMemoryManager<PoolStrategy>));
+    }
+    
+    /**
+     *  Tests a request bigger than what is left is refused, however near the top of size_t it is
+     */
+    void BasicHugeTest () {
+        BasicMemoryManager<StackStrategy> stack (size_t(1) << 20);
+        BasicMemoryManager<QueueStrategy> queue (size_t(1) << 20);
+        
+        assert("Basic Huge Test 1", true, stack.allocate(64) != nullptr && queue.allocate(64) != nullptr);
+        assert("Basic Huge Test 2", (void*)nullptr, stack.allocate(size_t(-1) - 8));
+        assert("Basic Huge Test 3", (void*)nullptr, queue.allocate(size_t(-1) - 8));
+        assert("Basic Huge Test 4", (size_t)64, stack.occupiedMemory());
+    }
+    
+    /**
+     *  Tests threads sharing a locked pool never get the same block
+     */
+    void BasicLockedTest () {
+        BasicMemoryManager<PoolStrategy, Locked> pool (BASIC_THREADS * BASIC_ROUNDS * 64);
+        std::vector<char> intact (BASIC_THREADS, true);
+        
+        std::vector<std::thread> workers;
+        for (int t = 0; t < BASIC_THREADS; ++t) {
+            workers.emplace_back ([&, t] () {
+                std::vector<int*> blocks;
+                for (int i = 0; i < BASIC_ROUNDS; ++i) {
+                    int* block = (int*)pool.allocate(sizeof(int));
+                    *block = t;
+                    blocks.push_back(block);
+                }
+                bool mine = true;
+                for (int* block : blocks) mine = mine && *block == t && pool.deallocate(block);
+                intact[t] = mine;
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        
+        bool all = true;
+        for (char ok : intact) all = all && ok;
+        assert("Basic Locked Test 1", true, all);
+        assert("Basic Locked Test 2", (size_t)0, pool.occupiedMemory());
+    }
+};
+
+#endif /* BasicTest_hpp */
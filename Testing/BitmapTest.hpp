@@ -0,0 +1,193 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BitmapTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BitmapTest_hpp
+#define BitmapTest_hpp
+
+#include "MemoryManager.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define BITMAP_CHURN_SIZE (1 << 18)
+#define BITMAP_SPEED_SIZE (1 << 18)
+
+class BitmapTest : public UnitTest {
+public:
+    BitmapTest () {}
+   ~BitmapTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "Bitmap Test"; }
+
+    void run () override {
+        // run tests
+        BitmapCorrectnessTest ();
+        BitmapAlignmentTest   ();
+        BitmapChurnTest       ();
+        BitmapGrowthTest      ();
+        BitmapSpeedTest       ();
+
+        // show results
+        show                  ();
+    }
+
+    /**
+     *  Tests blocks are freed in any order and counted to the granule
+     */
+    void BitmapCorrectnessTest () {
+        MemoryManager manager (MemoryManager::Mode::Bitmap, POOL_SIZE);
+
+        double* a = (double*) manager.allocate (sizeof(double));
+        int*    b = (int*)    manager.allocate (sizeof(int));
+        char*   c = (char*)   manager.allocate (100);
+        assert("Bitmap Allocation Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+
+        // nothing is stored per block, so a block costs only its granules
+        assert("Bitmap Allocation Test 2", rounded(sizeof(double)) + rounded(sizeof(int)) + rounded(100), manager.occupiedMemory());
+
+        *a = 3.14159;
+        *b = 256;
+        c[99] = 'A';
+        assert("Bitmap Allocation Test 3", 3.14159, *a);
+        assert("Bitmap Allocation Test 4", 256, *b);
+        assert("Bitmap Allocation Test 5", 'A', c[99]);
+
+        // the middle block goes first, and its granules come back
+        assert("Bitmap Deallocation Test 1", true, manager.deallocate(b));
+        assert("Bitmap Deallocation Test 2", false, manager.deallocate(b));
+        assert("Bitmap Deallocation Test 3", false, manager.deallocate(c + 16));
+        assert("Bitmap Deallocation Test 4", (void*)b, manager.allocate(sizeof(int)));
+        assert("Bitmap Deallocation Test 5", true, manager.deallocate(a) && manager.deallocate(c) && manager.deallocate(b));
+        assert("Bitmap Deallocation Test 6", 0, manager.occupiedMemory());
+
+        // the bitmaps take two bits a granule out of the block
+        size_t each = rounded(1), blocks = 0;
+        while (manager.allocate(1) != nullptr) ++blocks;
+        size_t granules = blocks * each / BITMAP_GRANULE, more = granules + each / BITMAP_GRANULE;
+        assert("Bitmap Fill Test 1", true, blocks * each + 2 * sizeof(uint64_t) * ((granules + 63) / 64) <= POOL_SIZE);
+        assert("Bitmap Fill Test 2", true, (blocks + 1) * each + 2 * sizeof(uint64_t) * ((more + 63) / 64) > POOL_SIZE);
+        assert("Bitmap Fill Test 3", blocks * each, manager.occupiedMemory());
+
+        manager.release();
+        assert("Bitmap Release Test", 0, manager.occupiedMemory());
+    }
+
+    /**
+     *  Tests blocks come back aligned whatever came before them
+     */
+    void BitmapAlignmentTest () {
+        MemoryManager manager (MemoryManager::Mode::Bitmap, 4 * MemoryManager::Page);
+
+        bool*   a = (bool*)   manager.allocate (sizeof(bool));
+        char*   b = (char*)   manager.allocate (sizeof(char), MemoryManager::CacheLine);
+        char*   c = (char*)   manager.allocate (sizeof(char), MemoryManager::Page);
+
+        assert("Bitmap Alignment Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+        assert("Bitmap Alignment Test 2", 0, (uintptr_t)a % alignof(std::max_align_t));
+        assert("Bitmap Alignment Test 3", 0, (uintptr_t)b % MemoryManager::CacheLine);
+        assert("Bitmap Alignment Test 4", 0, (uintptr_t)c % MemoryManager::Page);
+
+        // padding is left free, so only the blocks themselves count
+        assert("Bitmap Alignment Test 5", rounded(sizeof(bool)) + rounded(sizeof(char), MemoryManager::CacheLine) + rounded(sizeof(char), MemoryManager::Page), manager.occupiedMemory());
+    }
+
+    /**
+     *  Tests random allocations and frees never overlap or lose memory
+     */
+    void BitmapChurnTest () {
+        MemoryManager manager (MemoryManager::Mode::Bitmap, BITMAP_CHURN_SIZE);
+        std::mt19937 random (7);
+        std::vector<std::pair<char*, size_t>> live;
+
+        bool intact = true;
+        size_t expected = 0;
+        for (int i = 0; i < 64 * TEST_DEPTH; ++i) {
+            if (live.empty() || random() % 3 != 0) {
+                size_t size  = 1 + random() % 700;
+                char*  block = (char*)manager.allocate(size);
+                if (block == nullptr) continue;
+
+                std::fill(block, block + size, (char)live.size());
+                live.push_back({block, size});
+                expected += rounded(size);
+            } else {
+                size_t k = random() % live.size();
+                intact = intact && live[k].first[live[k].second - 1] == (char)k && manager.deallocate(live[k].first);
+                expected -= rounded(live[k].second);
+
+                // the last block takes the freed place in the list
+                live[k] = live.back();
+                live.pop_back();
+                if (k < live.size()) std::fill(live[k].first, live[k].first + live[k].second, (char)k);
+            }
+        }
+        assert("Bitmap Churn Test 1", true, intact);
+        assert("Bitmap Churn Test 2", expected, manager.occupiedMemory());
+
+        std::sort(live.begin(), live.end());
+        bool apart = true;
+        for (size_t k = 1; k < live.size(); ++k) apart = apart && live[k - 1].first + live[k - 1].second <= live[k].first;
+        assert("Bitmap Churn Test 3", true, apart);
+
+        for (auto& block : live) manager.deallocate(block.first);
+        assert("Bitmap Churn Test 4", 0, manager.occupiedMemory());
+        assert("Bitmap Churn Test 5", true, manager.allocate(manager.statistics().largestFree - MemoryManager::span(0)) != nullptr);
+    }
+
+    /**
+     *  Tests extra chunks get bitmaps of their own and go back once empty
+     */
+    void BitmapGrowthTest () {
+        MemoryManager manager (MemoryManager::Mode::Bitmap, POOL_SIZE, MemoryManager::Growth { MemoryManager::Growth::Fixed, 0, 0 });
+
+        std::vector<void*> blocks;
+        for (int i = 0; i < 256; ++i) blocks.push_back(manager.allocate(500));
+        assert("Bitmap Growth Test 1", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+        assert("Bitmap Growth Test 2", true, manager.totalMemory() > POOL_SIZE);
+        assert("Bitmap Growth Test 3", true, manager.allocate(3 * CHUNK_GRANULE) != nullptr);
+
+        for (void* block : blocks) manager.deallocate(block);
+        manager.release();
+        assert("Bitmap Growth Test 4", (size_t)POOL_SIZE, manager.totalMemory());
+    }
+
+    /**
+     *  Tests the Bitmap implementation for speed vs new
+     */
+    void BitmapSpeedTest () {
+        MemoryManager manager (MemoryManager::Mode::Bitmap, BITMAP_SPEED_SIZE);
+        std::vector<int*> blocks (TEST_DEPTH);
+
+        // allocate a load of data with new
+        clock_t newStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
+        double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
+
+        // allocate a load of data with manager
+        clock_t managedStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = (int*)manager.allocate(sizeof(int));
+        double managedTime = (double)(clock() - managedStart) / CLOCKS_PER_SEC;
+
+        // print both times; only running out of blocks fails
+        std::cout << "new:    " << newTime     << " s" << std::endl;
+        std::cout << "bitmap: " << managedTime << " s" << std::endl;
+        std::cout << std::endl;
+        assert("Bitmap Speed Test", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+    }
+
+private:
+    /** the granules a request of _size takes, its record included */
+    static size_t rounded (size_t _size, size_t _alignment = MemoryManager::Default) {
+        return (MemoryManager::span(_size, _alignment) + BITMAP_GRANULE - 1) / BITMAP_GRANULE * BITMAP_GRANULE;
+    }
+};
+
+#endif /* BitmapTest_hpp */
@@ -0,0 +1,237 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  BuddyTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef BuddyTest_hpp
+#define BuddyTest_hpp
+
+#include "MemoryManager.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define BUDDY_CHURN_SIZE (1 << 18)
+#define BUDDY_SPEED_SIZE (1 << 18)
+
+class BuddyTest : public UnitTest {
+public:
+    BuddyTest () {}
+   ~BuddyTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "Buddy Test"; }
+
+    void run () override {
+        // run tests
+        BuddyCorrectnessTest ();
+        BuddyMergeTest       ();
+        BuddyAlignmentTest   ();
+        BuddyChurnTest       ();
+        BuddyGrowthTest      ();
+        BuddySpeedTest       ();
+
+        // show results
+        show                 ();
+    }
+
+    /**
+     *  Tests blocks are rounded to a power of two and freed in any order
+     */
+    void BuddyCorrectnessTest () {
+        MemoryManager manager (MemoryManager::Mode::Buddy, POOL_SIZE);
+
+        double* a = (double*) manager.allocate (sizeof(double));
+        int*    b = (int*)    manager.allocate (sizeof(int));
+        char*   c = (char*)   manager.allocate (100);
+        assert("Buddy Allocation Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+
+        // the smallest block is 16 bytes, and 100 rounds up to 128
+        assert("Buddy Allocation Test 2", rounded(sizeof(double)) + rounded(sizeof(int)) + rounded(100), manager.occupiedMemory());
+
+        // the first two are the halves of one block twice their size, unless guarding
+        // made them big enough to be taken whole from what the chunk's end was carved into
+        if (!MemoryManager::guarded()) assert("Buddy Allocation Test 3", rounded(sizeof(double)), (size_t)((char*)b - (char*)a));
+
+        *a = 3.14159;
+        *b = 256;
+        c[99] = 'A';
+        assert("Buddy Allocation Test 4", 3.14159, *a);
+        assert("Buddy Allocation Test 5", 256, *b);
+        assert("Buddy Allocation Test 6", 'A', c[99]);
+
+        assert("Buddy Deallocation Test 1", true, manager.deallocate(b));
+        assert("Buddy Deallocation Test 2", false, manager.deallocate(b));
+        assert("Buddy Deallocation Test 3", false, manager.deallocate(c + 16));
+        assert("Buddy Deallocation Test 4", (void*)b, manager.allocate(sizeof(int)));
+        assert("Buddy Deallocation Test 5", true, manager.deallocate(a) && manager.deallocate(c) && manager.deallocate(b));
+        assert("Buddy Deallocation Test 6", 0, manager.occupiedMemory());
+
+        manager.allocate(1);
+        manager.release();
+        assert("Buddy Release Test", 0, manager.occupiedMemory());
+    }
+
+    /**
+     *  Tests freed halves merge back into the block they were split from
+     */
+    void BuddyMergeTest () {
+        MemoryManager manager (MemoryManager::Mode::Buddy, POOL_SIZE);
+        size_t largest = manager.statistics().largestFree;
+
+        // splitting the largest block all the way down leaves one of each order free
+        std::vector<void*> blocks;
+        size_t smallest = rounded(0);
+        for (size_t size = largest / 2; size >= smallest; size /= 2) blocks.push_back(manager.allocate(size - MemoryManager::span(0)));
+        blocks.push_back(manager.allocate(smallest - MemoryManager::span(0)));
+        assert("Buddy Merge Test 1", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+        assert("Buddy Merge Test 2", true, manager.statistics().largestFree < largest);
+
+        // freed smallest first, each block meets a buddy that is already free
+        for (size_t i = blocks.size(); i > 0; --i) manager.deallocate(blocks[i - 1]);
+        assert("Buddy Merge Test 3", largest, manager.statistics().largestFree);
+        assert("Buddy Merge Test 4", true, manager.allocate(largest - MemoryManager::span(0)) != nullptr);
+    }
+
+    /**
+     *  Tests blocks are aligned to their size up to a cache line
+     */
+    void BuddyAlignmentTest () {
+        MemoryManager manager (MemoryManager::Mode::Buddy, 4 * MemoryManager::Page);
+
+        bool*   a = (bool*)   manager.allocate (sizeof(bool));
+        char*   b = (char*)   manager.allocate (sizeof(char), MemoryManager::CacheLine);
+        char*   c = (char*)   manager.allocate (40);
+
+        assert("Buddy Alignment Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+        assert("Buddy Alignment Test 2", 0, (uintptr_t)a % alignof(std::max_align_t));
+        assert("Buddy Alignment Test 3", 0, (uintptr_t)b % MemoryManager::CacheLine);
+        // a guarded record sits in front of the data, so only the block is aligned
+        if (!MemoryManager::guarded()) assert("Buddy Alignment Test 4", 0, (uintptr_t)c % MemoryManager::CacheLine);
+
+        // an alignment is a block at least that big
+        assert("Buddy Alignment Test 5", rounded(sizeof(bool)) + rounded(sizeof(char), MemoryManager::CacheLine) + rounded(40), manager.occupiedMemory());
+
+        // past a cache line, a block of at least the alignment's order on an aligned base
+        for (size_t size : { size_t(1) << 20, size_t(16) << 20 }) {
+            MemoryManager empty (MemoryManager::Mode::Buddy, size);
+            bool aligned = true;
+            for (size_t alignment = 128; alignment <= MemoryManager::Page; alignment *= 2) {
+                char* block = (char*)empty.allocate(100, alignment);
+                aligned = aligned && block != nullptr && (uintptr_t)block % alignment == 0;
+            }
+            assert("Buddy Alignment Test 6", true, aligned);
+        }
+
+        // an alignment no chunk's base has grows one that does
+        MemoryManager growing (MemoryManager::Mode::Buddy, POOL_SIZE, MemoryManager::Growth { MemoryManager::Growth::Fixed, 0, 0 });
+        char* page = (char*)growing.allocate(100, 16 * MemoryManager::Page);
+        assert("Buddy Alignment Test 7", true, page != nullptr && (uintptr_t)page % (16 * MemoryManager::Page) == 0);
+        assert("Buddy Alignment Test 8", true, growing.deallocate(page));
+    }
+
+    /**
+     *  Tests random allocations and frees never overlap, lose memory or
+     *  leave the free space in pieces once everything is freed
+     */
+    void BuddyChurnTest () {
+        MemoryManager manager (MemoryManager::Mode::Buddy, BUDDY_CHURN_SIZE);
+        size_t largest = manager.statistics().largestFree;
+        std::mt19937 random (11);
+        std::vector<std::pair<char*, size_t>> live;
+
+        bool intact = true;
+        size_t expected = 0;
+        for (int i = 0; i < 64 * TEST_DEPTH; ++i) {
+            if (live.empty() || random() % 3 != 0) {
+                size_t size  = 1 + random() % 2000;
+                char*  block = (char*)manager.allocate(size);
+                if (block == nullptr) continue;
+
+                std::fill(block, block + size, (char)live.size());
+                live.push_back({block, size});
+                expected += rounded(size);
+            } else {
+                size_t k = random() % live.size();
+                intact = intact && live[k].first[live[k].second - 1] == (char)k && manager.deallocate(live[k].first);
+                expected -= rounded(live[k].second);
+
+                // the last block takes the freed place in the list
+                live[k] = live.back();
+                live.pop_back();
+                if (k < live.size()) std::fill(live[k].first, live[k].first + live[k].second, (char)k);
+            }
+        }
+        assert("Buddy Churn Test 1", true, intact);
+        assert("Buddy Churn Test 2", expected, manager.occupiedMemory());
+
+        std::sort(live.begin(), live.end());
+        bool apart = true;
+        for (size_t k = 1; k < live.size(); ++k) apart = apart && live[k - 1].first + live[k - 1].second <= live[k].first;
+        assert("Buddy Churn Test 3", true, apart);
+
+        for (auto& block : live) manager.deallocate(block.first);
+        assert("Buddy Churn Test 4", 0, manager.occupiedMemory());
+        assert("Buddy Churn Test 5", largest, manager.statistics().largestFree);
+    }
+
+    /**
+     *  Tests extra chunks get buddy trees of their own and go back once empty
+     */
+    void BuddyGrowthTest () {
+        MemoryManager manager (MemoryManager::Mode::Buddy, POOL_SIZE, MemoryManager::Growth { MemoryManager::Growth::Fixed, 0, 0 });
+
+        std::vector<void*> blocks;
+        for (int i = 0; i < 256; ++i) blocks.push_back(manager.allocate(500));
+        assert("Buddy Growth Test 1", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+        assert("Buddy Growth Test 2", true, manager.totalMemory() > POOL_SIZE);
+
+        void* big = manager.allocate(3 * CHUNK_GRANULE);
+        assert("Buddy Growth Test 3", true, big != nullptr);
+        if (!MemoryManager::guarded()) assert("Buddy Growth Test 4", 0, (uintptr_t)big % MemoryManager::CacheLine);
+
+        blocks.push_back(big);
+        for (void* block : blocks) manager.deallocate(block);
+        manager.release();
+        assert("Buddy Growth Test 5", (size_t)POOL_SIZE, manager.totalMemory());
+    }
+
+    /**
+     *  Tests the Buddy implementation for speed vs new
+     */
+    void BuddySpeedTest () {
+        MemoryManager manager (MemoryManager::Mode::Buddy, BUDDY_SPEED_SIZE);
+        std::vector<int*> blocks (TEST_DEPTH);
+
+        // allocate a load of data with new
+        clock_t newStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
+        double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
+
+        // allocate a load of data with manager
+        clock_t managedStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = (int*)manager.allocate(sizeof(int));
+        double managedTime = (double)(clock() - managedStart) / CLOCKS_PER_SEC;
+
+        // the times are shown rather than raced against new
+        std::cout << "new:   " << newTime     << " s" << std::endl;
+        std::cout << "buddy: " << managedTime << " s" << std::endl;
+        std::cout << std::endl;
+        assert("Buddy Speed Test", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+    }
+
+private:
+    /** the power of two block a request of _size takes, its record included */
+    static size_t rounded (size_t _size, size_t _alignment = MemoryManager::Default) {
+        size_t block = 16;
+        while (block < MemoryManager::span(_size, _alignment) || block < _alignment) block *= 2;
+        return block;
+    }
+};
+
+#endif /* BuddyTest_hpp */
@@ -0,0 +1,190 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  ConcurrentTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef ConcurrentTest_hpp
+#define ConcurrentTest_hpp
+
+#include "ConcurrentPool.hpp"
+#include "MemoryManager.hpp"
+#include "UnitTest.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CONCURRENT_TEST_SIZE (1 << 26)
+#define CONCURRENT_BATCH     64
+#define CONCURRENT_ROUNDS    2048
+
+class ConcurrentTest : public UnitTest {
+public:
+    ConcurrentTest () {}
+   ~ConcurrentTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Concurrent Test"; }
+    
+    void run () override {
+        // run tests
+        ConcurrentCorrectnessTest ();
+        ConcurrentRemoteFreeTest  ();
+        ConcurrentParkTest        ();
+        ConcurrentScalingTest     ();
+        
+        // show results
+        show                      ();
+    }
+    
+    /**
+     *  Tests the concurrent pool on a single thread
+     */
+    void ConcurrentCorrectnessTest () {
+        ConcurrentPool pool (CONCURRENT_TEST_SIZE);
+        
+        double* a = (double*) pool.allocate(sizeof(double));
+        int*    b = (int*)    pool.allocate(sizeof(int));
+        char*   c = (char*)   pool.allocate(100000);
+        assert("Concurrent Allocation Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+        
+        *a = 3.14159;
+        *b = 256;
+        c[99999] = 'A';
+        assert("Concurrent Allocation Test 2", 3.14159, *a);
+        assert("Concurrent Allocation Test 3", 256, *b);
+        assert("Concurrent Allocation Test 4", 'A', c[99999]);
+        
+        assert("Concurrent Deallocation Test 1", true, pool.deallocate(b));
+        assert("Concurrent Allocation Test 5", (void*)b, pool.allocate(sizeof(int)));
+        assert("Concurrent Deallocation Test 2", true, pool.deallocate(c));
+        assert("Concurrent Deallocation Test 3", false, pool.deallocate(&c));
+        
+        // a request near the top of size_t is refused, not wrapped into a page or two
+        size_t occupied = pool.occupiedMemory();
+        assert("Concurrent Allocation Test 6", (void*)nullptr, pool.allocate(size_t(-1) - 100));
+        assert("Concurrent Allocation Test 7", occupied, pool.occupiedMemory());
+        
+        pool.release();
+        assert("Concurrent Release Test", 0, pool.occupiedMemory());
+    }
+    
+    /**
+     *  Tests blocks freed by another thread find their way home
+     */
+    void ConcurrentRemoteFreeTest () {
+        ConcurrentPool pool (CONCURRENT_TEST_SIZE);
+        std::vector<void*> blocks (TEST_DEPTH * 16);
+        
+        for (void*& block : blocks) block = pool.allocate(64);
+        size_t held = pool.occupiedMemory();
+        
+        std::thread consumer ([&] () {
+            for (void* block : blocks) pool.deallocate(block);
+        });
+        consumer.join();
+        
+        // the remote frees are reused rather than taking fresh pages
+        bool allocated = true;
+        for (void*& block : blocks) allocated = (block = pool.allocate(64)) != nullptr && allocated;
+        assert("Concurrent Remote Free Test 1", true, allocated);
+        assert("Concurrent Remote Free Test 2", held, pool.occupiedMemory());
+    }
+    
+    /**
+     *  Tests full pages leave the class list and come back when a block is freed into them
+     */
+    void ConcurrentParkTest () {
+        ConcurrentPool pool (CONCURRENT_TEST_SIZE);
+        std::vector<void*> blocks (TEST_DEPTH * 16);
+        
+        for (void*& block : blocks) block = pool.allocate(64);
+        size_t held = pool.occupiedMemory();
+        
+        // the first page filled long ago, only a free on it brings it back
+        void* first = blocks[0];
+        pool.deallocate(first);
+        assert("Concurrent Park Test 1", first, pool.allocate(64));
+        
+        void* second = blocks[1];
+        std::thread remote ([&] () { pool.deallocate(second); });
+        remote.join();
+        
+        bool reused = false;
+        std::vector<void*> extra;
+        while (!reused && pool.occupiedMemory() == held) {
+            extra.push_back(pool.allocate(64));
+            reused = extra.back() == second;
+        }
+        assert("Concurrent Park Test 2", true, reused);
+        assert("Concurrent Park Test 3", held, pool.occupiedMemory());
+    }
+    
+    /**
+     *  Measures throughput from one thread up to the hardware's count,
+     *  against a Pool mode manager behind a global mutex
+     */
+    void ConcurrentScalingTest () {
+        unsigned most = std::thread::hardware_concurrency();
+        if (most < 4) most = 4;
+        
+        bool succeeded = true;
+        for (unsigned threads = 1; threads <= most; threads *= 2) {
+            ConcurrentPool pool (CONCURRENT_TEST_SIZE);
+            double pooled = throughput(threads, succeeded, [&] (size_t size) { return pool.allocate(size); },
+                                                           [&] (void* data) { pool.deallocate(data); });
+            
+            MemoryManager manager (MemoryManager::Mode::Pool, CONCURRENT_TEST_SIZE);
+            std::mutex lock;
+            double locked = throughput(threads, succeeded, [&] (size_t size) {
+                                           std::lock_guard<std::mutex> guard (lock);
+                                           return manager.allocate(size);
+                                       }, [&] (void* data) {
+                                           std::lock_guard<std::mutex> guard (lock);
+                                           manager.deallocate(data);
+                                       });
+            
+            std::cout << "threads: " << threads
+                      << "  concurrent pool: " << pooled << " ops/s"
+                      << "  locked manager: "  << locked << " ops/s" << std::endl;
+        }
+        std::cout << std::endl;
+        
+        assert("Concurrent Scaling Test", true, succeeded);
+    }
+    
+private:
+    /**
+     *  runs batches of mixed size allocations and frees on every thread
+     *  and returns the combined operations per second
+     */
+    template <class Allocate, class Deallocate>
+    double throughput (unsigned _threads, bool& _succeeded, Allocate _allocate, Deallocate _deallocate) {
+        std::atomic<bool> failed (false);
+        std::vector<std::thread> workers;
+        
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < _threads; ++t) {
+            workers.emplace_back ([&, t] () {
+                void* blocks[CONCURRENT_BATCH];
+                for (int r = 0; r < CONCURRENT_ROUNDS; ++r) {
+                    for (int i = 0; i < CONCURRENT_BATCH; ++i) {
+                        if (!(blocks[i] = _allocate(16 + ((i + t) % 16) * 16))) failed = true;
+                    }
+                    for (int i = 0; i < CONCURRENT_BATCH; ++i) if (blocks[i]) _deallocate(blocks[i]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        if (failed) _succeeded = false;
+        return 2.0 * _threads * CONCURRENT_ROUNDS * CONCURRENT_BATCH / seconds;
+    }
+};
+
+#endif /* ConcurrentTest_hpp */
@@ -0,0 +1,206 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  DebugTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef DebugTest_hpp
+#define DebugTest_hpp
+
+#include "MemoryManager.hpp"
+#include "BasicMemoryManager.hpp"
+#include "StackStrategy.hpp"
+#include "PoolStrategy.hpp"
+#include "TLSFStrategy.hpp"
+#include "Debug.hpp"
+#include "UnitTest.hpp"
+
+#include <cstring>
+#include <vector>
+
+class DebugTest : public UnitTest {
+public:
+    DebugTest () {}
+   ~DebugTest () {}
+
+    void setup    () override { reports().clear(); previous = debugHandler (collect); }
+    void teardown () override { debugHandler (previous); }
+
+    std::string name () override { return "Debug Test"; }
+
+    void run () override {
+        setup ();
+
+        // run tests
+        DebugGuardTest     ();
+        DebugFreeTest      ();
+        DebugPoisonTest    ();
+        DebugLeakTest      ();
+        DebugAlignmentTest ();
+        DebugStackTest     ();
+        DebugNoneTest      ();
+
+        teardown ();
+
+        // show results
+        show ();
+    }
+
+    /**
+     *  Tests writes past either end of a block are reported on free
+     */
+    void DebugGuardTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, NoStats, Guarded> pool (POOL_SIZE);
+
+        char* a = (char*)pool.allocate(32, alignof(std::max_align_t), MEMORY_MANAGER_SITE);
+        int   line = __LINE__ - 1;
+        char* b = (char*)pool.allocate(32);
+        char* c = (char*)pool.allocate(32);
+
+        a[32] = 'X';
+        b[-1] = 'X';
+        reports().clear();
+        assert("Debug Guard Test 1", true, pool.deallocate(a) && pool.deallocate(b) && pool.deallocate(c));
+        assert("Debug Guard Test 2", (size_t)2, reports().size());
+        assert("Debug Guard Test 3", true, reports()[0].kind == DebugReport::Overrun && reports()[0].data == a);
+        assert("Debug Guard Test 4", true, reports()[1].kind == DebugReport::Underrun && reports()[1].data == b);
+
+        // the report says where the block came from
+        assert("Debug Guard Test 5", (size_t)32, reports()[0].size);
+        assert("Debug Guard Test 6", std::string(__FILE__), std::string(reports()[0].site.file));
+        assert("Debug Guard Test 7", line, reports()[0].site.line);
+        assert("Debug Guard Test 8", true, reports()[1].site.file == nullptr);
+    }
+
+    /**
+     *  Tests double and invalid frees are reported and refused
+     */
+    void DebugFreeTest () {
+        BasicMemoryManager<TLSFStrategy, SingleThreaded, Backing, NoStats, Guarded> tlsf (POOL_SIZE);
+
+        char* a = (char*)tlsf.allocate(40);
+        char* b = (char*)tlsf.allocate(40);
+        reports().clear();
+
+        assert("Debug Free Test 1", true, tlsf.freeable(a) && tlsf.deallocate(a));
+        assert("Debug Free Test 2", false, tlsf.freeable(a) || tlsf.deallocate(a));
+        assert("Debug Free Test 3", true, reports().size() == 1 && reports()[0].kind == DebugReport::DoubleFree);
+        assert("Debug Free Test 4", true, reports()[0].size == 40 || sanitizerPoisoned(a, 1));
+
+        assert("Debug Free Test 5", false, tlsf.deallocate(b + 8));
+        assert("Debug Free Test 6", true, reports().size() == 2 && reports()[1].kind == DebugReport::InvalidFree);
+
+        int outside = 0;
+        assert("Debug Free Test 7", false, tlsf.deallocate(&outside));
+        assert("Debug Free Test 8", true, tlsf.deallocate(b));
+        assert("Debug Free Test 9", (size_t)3, reports().size());
+        assert("Debug Free Test 10", (size_t)0, tlsf.occupiedMemory());
+    }
+
+    /**
+     *  Tests new blocks and freed ones are filled with their patterns
+     */
+    void DebugPoisonTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, NoStats, Guarded> pool (POOL_SIZE);
+
+        unsigned char* a = (unsigned char*)pool.allocate(64);
+        bool fresh = true;
+        for (int i = 0; i < 64; ++i) fresh = fresh && a[i] == DEBUG_FRESH;
+        assert("Debug Poison Test 1", true, fresh);
+
+        std::memset(a, 0, 64);
+        pool.deallocate(a);
+
+        // the pool keeps its free gaps elsewhere, so the poison is all still there,
+        // unless the sanitizers were told and nothing may read it at all
+        bool freed = true;
+        if (!sanitizerPoisoned(a, 64)) for (int i = 0; i < 64; ++i) freed = freed && a[i] == DEBUG_FREED;
+        assert("Debug Poison Test 2", true, freed);
+    }
+
+    /**
+     *  Tests blocks still live at release and destruction are leaks
+     */
+    void DebugLeakTest () {
+        reports().clear();
+        {
+            BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, NoStats, Guarded> pool (POOL_SIZE);
+
+            void* a = pool.allocate(10, alignof(std::max_align_t), MEMORY_MANAGER_SITE);
+            void* b = pool.allocate(20, alignof(std::max_align_t), MEMORY_MANAGER_SITE);
+            pool.allocate(30);
+            pool.deallocate(a);
+
+            pool.release();
+            assert("Debug Leak Test 1", (size_t)2, reports().size());
+            assert("Debug Leak Test 2", true, reports()[0].kind == DebugReport::Leak && reports()[1].kind == DebugReport::Leak);
+            assert("Debug Leak Test 3", true, (reports()[0].data == b) != (reports()[1].data == b));
+            assert("Debug Leak Test 4", true, reports()[0].size + reports()[1].size == 50);
+
+            pool.allocate(40);
+        }
+        assert("Debug Leak Test 5", (size_t)3, reports().size());
+        assert("Debug Leak Test 6", (size_t)40, reports()[2].size);
+    }
+
+    /**
+     *  Tests the record and red zones keep any alignment
+     */
+    void DebugAlignmentTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, NoStats, Guarded> pool (4 * MemoryManager::Page);
+        reports().clear();
+
+        void* a = pool.allocate(1, MemoryManager::CacheLine);
+        void* b = pool.allocate(1, MemoryManager::Page);
+        assert("Debug Alignment Test 1", 0, (uintptr_t)a % MemoryManager::CacheLine);
+        assert("Debug Alignment Test 2", 0, (uintptr_t)b % MemoryManager::Page);
+        assert("Debug Alignment Test 3", true, pool.deallocate(b) && pool.deallocate(a));
+        assert("Debug Alignment Test 4", true, reports().empty());
+    }
+
+    /**
+     *  Tests a stack only frees in order and rolls back without leaks
+     */
+    void DebugStackTest () {
+        BasicMemoryManager<StackStrategy, SingleThreaded, Backing, NoStats, Guarded> stack (POOL_SIZE);
+        reports().clear();
+
+        void* a = stack.allocate(16);
+        auto  marker = stack.getMarker();
+        void* b = stack.allocate(16);
+        stack.allocate(16);
+
+        // out of order is refused without a report, as it is unguarded
+        assert("Debug Stack Test 1", false, stack.deallocate(b));
+        assert("Debug Stack Test 2", true, stack.freeToMarker(marker) && stack.deallocate(a));
+        assert("Debug Stack Test 3", true, reports().empty());
+
+        stack.release();
+        assert("Debug Stack Test 4", true, reports().empty());
+    }
+
+    /**
+     *  Tests NoDebug leaves blocks as the strategy hands them out
+     */
+    void DebugNoneTest () {
+        BasicMemoryManager<PoolStrategy> plain (POOL_SIZE);
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, NoStats, Guarded> guarded (POOL_SIZE);
+
+        plain.allocate(8);
+        guarded.allocate(8);
+        assert("Debug None Test 1", true, plain.occupiedMemory() < guarded.occupiedMemory());
+        assert("Debug None Test 2", sizeof(BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, NoStats, NoDebug>), sizeof(plain));
+        guarded.release();
+    }
+
+private:
+    static std::vector<DebugReport>& reports () {
+        static std::vector<DebugReport> found;
+        return found;
+    }
+
+    static void collect (const DebugReport& _report) { reports().push_back(_report); }
+
+    DebugHandler previous; // the handler before the test's own
+};
+
+#endif /* DebugTest_hpp */
@@ -0,0 +1,165 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  GlobalHeapTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef GlobalHeapTest_hpp
+#define GlobalHeapTest_hpp
+
+#include "GlobalHeap.hpp"
+#include "UnitTest.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GLOBAL_TEST_BLOCKS 4096
+
+class GlobalHeapTest : public UnitTest {
+public:
+    GlobalHeapTest () {}
+   ~GlobalHeapTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "Global Heap Test"; }
+
+    void run () override {
+        // run tests
+        GlobalHeapAllocationTest ();
+        GlobalHeapFallbackTest   ();
+        GlobalHeapThreadTest     ();
+        GlobalHeapOperatorTest   ();
+
+        // show results
+        show                     ();
+    }
+
+    /**
+     *  Tests small requests come from the pool, aligned as asked
+     */
+    void GlobalHeapAllocationTest () {
+        bool pooled = true, aligned = true;
+        for (size_t size = 0; size <= SIZE_CLASS_MAX; size += 8) {
+            void* a = GlobalHeap::allocate(size);
+            void* b = GlobalHeap::allocate(size, 64);
+            pooled  = pooled  && GlobalHeap::contains(a) && GlobalHeap::contains(b);
+            aligned = aligned && (uintptr_t)a % alignof(std::max_align_t) == 0 && (uintptr_t)b % 64 == 0;
+
+            if (size > 0) std::memset(a, 1, size);
+            GlobalHeap::deallocate(a);
+            GlobalHeap::deallocate(b);
+        }
+        assert("Global Allocation Test 1", true, pooled);
+        assert("Global Allocation Test 2", true, aligned);
+        assert("Global Allocation Test 3", true, GlobalHeap::occupiedMemory() > 0);
+    }
+
+    /**
+     *  Tests big and over aligned requests go to the system, and system memory is freed there
+     */
+    void GlobalHeapFallbackTest () {
+        char* big     = (char*)GlobalHeap::allocate(SIZE_CLASS_MAX + 1);
+        char* page    = (char*)GlobalHeap::allocate(100, 4096);
+        char* foreign = (char*)malloc(100);
+        assert("Global Fallback Test 1", true, big != nullptr && !GlobalHeap::contains(big));
+        assert("Global Fallback Test 2", true, page != nullptr && !GlobalHeap::contains(page) && (uintptr_t)page % 4096 == 0);
+
+        big[SIZE_CLASS_MAX] = 'A';
+        page[99] = 'B';
+        assert("Global Fallback Test 3", 'A', big[SIZE_CLASS_MAX]);
+        assert("Global Fallback Test 4", 'B', page[99]);
+
+        // none of these belong to the pool, and each goes back to free
+        GlobalHeap::deallocate(big);
+        GlobalHeap::deallocate(page);
+        GlobalHeap::deallocate(foreign);
+        GlobalHeap::deallocate(nullptr);
+        
+        // rounding a size near the top of size_t up to the alignment must not wrap
+        volatile size_t huge = size_t(-1) - 10;
+        assert("Global Fallback Test 5", (void*)nullptr, GlobalHeap::allocate(huge, 128));
+        
+        // only ours is tested, some standard libraries round the same way
+        if (!replaced()) return;
+        bool thrown = false;
+        try {
+            ::operator delete(::operator new(huge, std::align_val_t(128)), std::align_val_t(128));
+        } catch (const std::bad_alloc&) {
+            thrown = true;
+        }
+        assert("Global Fallback Test 6", true, thrown);
+    }
+
+    /**
+     *  Tests blocks made on one thread are freed on another
+     */
+    void GlobalHeapThreadTest () {
+        std::vector<uint32_t*> blocks (GLOBAL_TEST_BLOCKS);
+        std::thread maker ([&blocks] () {
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                blocks[i] = (uint32_t*)GlobalHeap::allocate(8 + i % 512);
+                *blocks[i] = (uint32_t)i;
+            }
+        });
+        maker.join();
+
+        bool intact = true;
+        std::thread freer ([&blocks, &intact] () {
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                intact = intact && GlobalHeap::contains(blocks[i]) && *blocks[i] == (uint32_t)i;
+                GlobalHeap::deallocate(blocks[i]);
+            }
+        });
+        freer.join();
+        assert("Global Thread Test 1", true, intact);
+
+        // the freed blocks are taken again by whichever thread adopts the heap
+        std::thread taker ([&blocks] () {
+            for (size_t i = 0; i < blocks.size(); ++i) blocks[i] = (uint32_t*)GlobalHeap::allocate(8 + i % 512);
+            for (size_t i = 0; i < blocks.size(); ++i) GlobalHeap::deallocate(blocks[i]);
+        });
+        taker.join();
+    }
+
+    /**
+     *  Tests new and delete reach the pool only when built with MEMORY_MANAGER_GLOBAL
+     */
+    void GlobalHeapOperatorTest () {
+        struct alignas(64) Line { char data[64]; };
+
+        int*  a = new int (5);
+        Line* b = new Line;
+        char* c = new char[SIZE_CLASS_MAX * 2];
+        assert("Global Operator Test 1", replaced(), GlobalHeap::contains(a));
+        assert("Global Operator Test 2", replaced(), GlobalHeap::contains(b));
+        assert("Global Operator Test 3", true, (uintptr_t)b % 64 == 0 && !GlobalHeap::contains(c));
+        delete a;
+        delete b;
+        delete[] c;
+
+        // a container built and torn down entirely through operator new
+        std::map<int, std::string> tree;
+        for (int i = 0; i < GLOBAL_TEST_BLOCKS; ++i) tree[(i * 7919) % GLOBAL_TEST_BLOCKS] = std::string(i % 64, 'x');
+        assert("Global Operator Test 4", (size_t)GLOBAL_TEST_BLOCKS, tree.size());
+        assert("Global Operator Test 5", std::string(5, 'x'), tree[(5 * 7919) % GLOBAL_TEST_BLOCKS]);
+    }
+
+private:
+    /** whether this build replaced the global operator new */
+    static bool replaced () {
+#ifdef MEMORY_MANAGER_GLOBAL
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+#endif /* GlobalHeapTest_hpp */
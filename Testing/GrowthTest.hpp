@@ -0,0 +1,173 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  GrowthTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef GrowthTest_hpp
+#define GrowthTest_hpp
+
+#include "MemoryManager.hpp"
+#include "UnitTest.hpp"
+
+#include <vector>
+
+#define GROWTH_BLOCK 1000
+#define GROWTH_COUNT 512
+
+class GrowthTest : public UnitTest {
+public:
+    GrowthTest () {}
+   ~GrowthTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Growth Test"; }
+    
+    void run () override {
+        // run tests
+        GrowthNoneTest     ();
+        GrowthStackTest    ();
+        GrowthQueueTest    ();
+        GrowthPoolTest     ();
+        GrowthHighWaterTest();
+        
+        // show results
+        show               ();
+    }
+    
+    /**
+     *  Tests a manager without growth still fails at capacity
+     */
+    void GrowthNoneTest () {
+        MemoryManager memory (MemoryManager::Mode::Pool, POOL_SIZE);
+        
+        assert("Growth None Test 1", true, memory.allocate(POOL_SIZE / 2) != nullptr);
+        assert("Growth None Test 2", (void*)nullptr, memory.allocate(POOL_SIZE));
+        assert("Growth None Test 3", (size_t)POOL_SIZE, memory.totalMemory());
+    }
+    
+    /**
+     *  Tests the stack chains chunks and hands them back as it unwinds
+     */
+    void GrowthStackTest () {
+        MemoryManager::Growth growth { MemoryManager::Growth::Fixed, CHUNK_GRANULE, 0 };
+        MemoryManager memory (MemoryManager::Mode::Stack, POOL_SIZE, growth);
+        
+        std::vector<int*> blocks;
+        for (int i = 0; i < GROWTH_COUNT; ++i) {
+            int* block = (int*)memory.allocate(GROWTH_BLOCK);
+            if (block == nullptr) break;
+            *block = i;
+            blocks.push_back(block);
+        }
+        assert("Growth Stack Test 1", (size_t)GROWTH_COUNT, blocks.size());
+        assert("Growth Stack Test 2", true, memory.totalMemory() > POOL_SIZE);
+        
+        // earlier blocks never moved
+        bool intact = true;
+        for (int i = 0; i < GROWTH_COUNT; ++i) intact = intact && *blocks[i] == i;
+        assert("Growth Stack Test 3", true, intact);
+        
+        // a block bigger than a whole chunk gets a chunk of its own
+        void* big = memory.allocate(2 * CHUNK_GRANULE);
+        assert("Growth Stack Test 4", true, big != nullptr);
+        assert("Growth Stack Test 5", true, memory.deallocate(big));
+        
+        while (!blocks.empty()) {
+            memory.deallocate(blocks.back());
+            blocks.pop_back();
+        }
+        assert("Growth Stack Test 6", (size_t)0, memory.occupiedMemory());
+        assert("Growth Stack Test 7", (size_t)POOL_SIZE, memory.totalMemory());
+        
+        // a request near the top of size_t is refused, not wrapped into a small chunk
+        assert("Growth Stack Test 8", (void*)nullptr, memory.allocate(size_t(-1) - 8, MemoryManager::Page));
+        assert("Growth Stack Test 9", (size_t)POOL_SIZE, memory.totalMemory());
+        assert("Growth Stack Test 10", true, memory.allocate(GROWTH_BLOCK) != nullptr);
+    }
+    
+    /**
+     *  Tests the queue grows and shrinks back once it empties
+     */
+    void GrowthQueueTest () {
+        MemoryManager::Growth growth { MemoryManager::Growth::Fixed, CHUNK_GRANULE, 0 };
+        MemoryManager memory (MemoryManager::Mode::Queue, POOL_SIZE, growth);
+        
+        std::vector<void*> blocks;
+        for (int i = 0; i < GROWTH_COUNT; ++i) blocks.push_back(memory.allocate(GROWTH_BLOCK));
+        assert("Growth Queue Test 1", true, blocks.back() != nullptr);
+        assert("Growth Queue Test 2", true, memory.totalMemory() > POOL_SIZE);
+        
+        bool freed = true;
+        for (void* block : blocks) freed = freed && memory.deallocate(block);
+        assert("Growth Queue Test 3", true, freed);
+        assert("Growth Queue Test 4", (size_t)POOL_SIZE, memory.totalMemory());
+        
+        // a request near the top of size_t is refused, not wrapped into the ring
+        assert("Growth Queue Test 5", true, memory.allocate(GROWTH_BLOCK) != nullptr);
+        size_t total = memory.totalMemory();
+        assert("Growth Queue Test 6", (void*)nullptr, memory.allocate(size_t(-1) - 8));
+        assert("Growth Queue Test 7", (void*)nullptr, memory.allocate(size_t(-1) - 8, MemoryManager::Page));
+        assert("Growth Queue Test 8", total, memory.totalMemory());
+    }
+    
+    /**
+     *  Tests the pool grows geometrically and frees empty chunks
+     */
+    void GrowthPoolTest () {
+        MemoryManager::Growth growth { MemoryManager::Growth::Geometric, CHUNK_GRANULE, 0 };
+        MemoryManager memory (MemoryManager::Mode::Pool, POOL_SIZE, growth);
+        
+        std::vector<int*> blocks;
+        for (int i = 0; i < GROWTH_COUNT; ++i) {
+            int* block = (int*)memory.allocate(GROWTH_BLOCK);
+            *block = i;
+            blocks.push_back(block);
+        }
+        
+        // it takes chunks of 64K, 128K, 256K and 512K to hold 500K
+        size_t chunks = 15 * CHUNK_GRANULE - 4 * CHUNK_HEADER;
+        assert("Growth Pool Test 1", POOL_SIZE + chunks, memory.totalMemory());
+        
+        bool intact = true;
+        for (int i = 0; i < GROWTH_COUNT; ++i) intact = intact && *blocks[i] == i;
+        assert("Growth Pool Test 2", true, intact);
+        
+        // frees in any order, from any chunk
+        for (int i = 0; i < GROWTH_COUNT; i += 2) memory.deallocate(blocks[i]);
+        for (int i = 1; i < GROWTH_COUNT; i += 2) memory.deallocate(blocks[i]);
+        assert("Growth Pool Test 3", (size_t)0, memory.occupiedMemory());
+        assert("Growth Pool Test 4", (size_t)POOL_SIZE, memory.totalMemory());
+        assert("Growth Pool Test 5", false, memory.deallocate(blocks[0]));
+    }
+    
+    /**
+     *  Tests idle chunks under the high water mark are kept for reuse
+     */
+    void GrowthHighWaterTest () {
+        MemoryManager::Growth growth { MemoryManager::Growth::Fixed, CHUNK_GRANULE, CHUNK_GRANULE };
+        MemoryManager memory (MemoryManager::Mode::Pool, POOL_SIZE, growth);
+        
+        void* a = memory.allocate(CHUNK_GRANULE / 2);
+        void* b = memory.allocate(CHUNK_GRANULE / 2);
+        size_t grown = memory.totalMemory();
+        assert("Growth High Water Test 1", POOL_SIZE + 2 * (CHUNK_GRANULE - CHUNK_HEADER), grown);
+        
+        // one idle chunk fits under the mark, the second does not
+        memory.deallocate(a);
+        assert("Growth High Water Test 2", grown, memory.totalMemory());
+        memory.deallocate(b);
+        assert("Growth High Water Test 3", POOL_SIZE + CHUNK_GRANULE - CHUNK_HEADER, memory.totalMemory());
+        
+        // the kept chunk is reused rather than growing again
+        assert("Growth High Water Test 4", true, memory.allocate(CHUNK_GRANULE / 2) != nullptr);
+        assert("Growth High Water Test 5", POOL_SIZE + CHUNK_GRANULE - CHUNK_HEADER, memory.totalMemory());
+        
+        memory.release();
+        assert("Growth High Water Test 6", (size_t)0, memory.occupiedMemory());
+        assert("Growth High Water Test 7", POOL_SIZE + CHUNK_GRANULE - CHUNK_HEADER, memory.totalMemory());
+    }
+};
+
+#endif /* GrowthTest_hpp */
@@ -0,0 +1,201 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  HandleTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef HandleTest_hpp
+#define HandleTest_hpp
+
+#include "HandlePool.hpp"
+#include "UnitTest.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define HANDLE_TEST_SIZE (1 << 20)
+
+class HandleTest : public UnitTest {
+public:
+    HandleTest () {}
+   ~HandleTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "Handle Test"; }
+
+    void run () override {
+        // run tests
+        HandleCorrectnessTest ();
+        HandleCompactTest     ();
+        HandleBudgetTest      ();
+        HandlePinTest         ();
+        HandleThreadTest      ();
+
+        // show results
+        show                  ();
+    }
+
+    /**
+     *  Tests handles resolve while live and never again once freed
+     */
+    void HandleCorrectnessTest () {
+        HandlePool pool (POOL_SIZE);
+
+        HandlePool::Handle a = pool.allocate(sizeof(double));
+        HandlePool::Handle b = pool.allocate(100);
+        assert("Handle Allocation Test 1", true, a != HandlePool::Null && b != HandlePool::Null);
+        assert("Handle Allocation Test 2", true, pool.resolve(a) != nullptr && pool.resolve(a) != pool.resolve(b));
+        assert("Handle Allocation Test 3", HandlePool::Null, pool.allocate(POOL_SIZE));
+
+        // sizes round up so any block can move anywhere
+        assert("Handle Allocation Test 4", alignof(std::max_align_t) + 112, pool.occupiedMemory());
+
+        *(double*)pool.resolve(a) = 3.14159;
+        assert("Handle Allocation Test 5", 3.14159, *(double*)pool.resolve(a));
+
+        assert("Handle Deallocation Test 1", true, pool.deallocate(a));
+        assert("Handle Deallocation Test 2", false, pool.deallocate(a));
+        assert("Handle Deallocation Test 3", (void*)nullptr, pool.resolve(a));
+
+        // the slot comes back under a new generation
+        HandlePool::Handle c = pool.allocate(8);
+        assert("Handle Deallocation Test 4", true, c != a && pool.resolve(c) != nullptr);
+        assert("Handle Deallocation Test 5", (void*)nullptr, pool.resolve(a));
+        assert("Handle Deallocation Test 6", (void*)nullptr, pool.resolve(HandlePool::Null));
+
+        pool.release();
+        assert("Handle Release Test 1", 0, pool.occupiedMemory());
+        assert("Handle Release Test 2", (void*)nullptr, pool.resolve(b));
+        assert("Handle Release Test 3", (size_t)POOL_SIZE, pool.largestFree());
+    }
+
+    /**
+     *  Tests compaction gathers every gap into one and keeps the contents
+     */
+    void HandleCompactTest () {
+        HandlePool pool (HANDLE_TEST_SIZE);
+        std::vector<HandlePool::Handle> handles;
+        std::vector<size_t> sizes;
+
+        // fill the pool, then free every other block
+        for (size_t i = 0; ; ++i) {
+            size_t size = 16 + (i * 37) % 2000;
+            HandlePool::Handle handle = pool.allocate(size);
+            if (handle == HandlePool::Null) break;
+
+            char* block = (char*)pool.resolve(handle);
+            for (size_t j = 0; j < size; ++j) block[j] = (char)i;
+            handles.push_back(handle);
+            sizes.push_back(size);
+        }
+        for (size_t i = 0; i < handles.size(); i += 2) pool.deallocate(handles[i]);
+        assert("Handle Compact Test 1", true, pool.largestFree() < pool.freeMemory() / 8);
+
+        size_t moved = pool.compact(std::chrono::seconds(10));
+        assert("Handle Compact Test 2", true, moved > 0);
+        assert("Handle Compact Test 3", pool.freeMemory(), pool.largestFree());
+        assert("Handle Compact Test 4", (size_t)0, pool.compact(std::chrono::seconds(10)));
+
+        bool intact = true;
+        for (size_t i = 1; i < handles.size(); i += 2) {
+            char* block = (char*)pool.resolve(handles[i]);
+            for (size_t j = 0; j < sizes[i]; ++j) intact = intact && block[j] == (char)i;
+        }
+        assert("Handle Compact Test 5", true, intact);
+        assert("Handle Compact Test 6", true, pool.allocate(pool.freeMemory()) != HandlePool::Null);
+    }
+
+    /**
+     *  Tests a zero budget still makes progress a block at a time
+     */
+    void HandleBudgetTest () {
+        HandlePool pool (POOL_SIZE);
+        std::vector<HandlePool::Handle> handles;
+        for (int i = 0; i < 16; ++i) handles.push_back(pool.allocate(32));
+        for (int i = 0; i < 16; i += 2) pool.deallocate(handles[i]);
+
+        assert("Handle Budget Test 1", (size_t)32, pool.compact(std::chrono::nanoseconds(0)));
+
+        int calls = 1;
+        while (pool.compact(std::chrono::nanoseconds(0)) > 0) ++calls;
+        assert("Handle Budget Test 2", 8, calls);
+        assert("Handle Budget Test 3", pool.freeMemory(), pool.largestFree());
+    }
+
+    /**
+     *  Tests a pinned block stays put until unpinned
+     */
+    void HandlePinTest () {
+        HandlePool pool (POOL_SIZE);
+        HandlePool::Handle a = pool.allocate(64);
+        HandlePool::Handle b = pool.allocate(64);
+        HandlePool::Handle c = pool.allocate(64);
+        pool.deallocate(a);
+
+        void* pinned = pool.pin(b);
+        assert("Handle Pin Test 1", true, pinned != nullptr);
+        pool.compact(std::chrono::seconds(1));
+        assert("Handle Pin Test 2", pinned, pool.resolve(b));
+        assert("Handle Pin Test 3", true, pool.largestFree() < pool.freeMemory());
+
+        assert("Handle Pin Test 4", true, pool.unpin(b));
+        assert("Handle Pin Test 5", false, pool.unpin(b));
+        pool.compact(std::chrono::seconds(1));
+        assert("Handle Pin Test 6", true, pool.resolve(b) != pinned);
+        assert("Handle Pin Test 7", pool.freeMemory(), pool.largestFree());
+        assert("Handle Pin Test 8", true, pool.deallocate(c));
+    }
+
+    /**
+     *  Tests an idle thread can compact while another allocates and frees
+     */
+    void HandleThreadTest () {
+        HandlePool pool (HANDLE_TEST_SIZE);
+        std::atomic<bool> done (false);
+
+        std::thread idle ([&] () {
+            while (!done.load()) pool.compact(std::chrono::microseconds(50));
+        });
+
+        std::vector<HandlePool::Handle> live;
+        bool intact = true;
+        for (int i = 0; i < 64 * TEST_DEPTH; ++i) {
+            if (live.size() < 256) {
+                HandlePool::Handle handle = pool.allocate(16 + (i * 37) % 1000);
+                if (handle == HandlePool::Null) continue;
+
+                int* block = (int*)pool.pin(handle);
+                *block = (int)live.size();
+                pool.unpin(handle);
+                live.push_back(handle);
+            } else {
+                // free from the middle so there is always something to compact
+                size_t k = (size_t)(i * 7919) % live.size();
+                int* block = (int*)pool.pin(live[k]);
+                intact = intact && *block == (int)k;
+                pool.unpin(live[k]);
+                pool.deallocate(live[k]);
+
+                // the last block takes the freed place in the list
+                if (k != live.size() - 1) {
+                    block = (int*)pool.pin(live.back());
+                    *block = (int)k;
+                    pool.unpin(live.back());
+                    live[k] = live.back();
+                }
+                live.pop_back();
+            }
+        }
+        done.store(true);
+        idle.join();
+
+        assert("Handle Thread Test 1", true, intact);
+        pool.compact(std::chrono::seconds(10));
+        assert("Handle Thread Test 2", pool.freeMemory(), pool.largestFree());
+    }
+};
+
+#endif /* HandleTest_hpp */
@@ -7,9 +7,16 @@
 #define PoolTest_hpp
 
 #include "MemoryManager.hpp"
+#include "FixedPool.hpp"
 #include "UnitTest.hpp"
 
+#include <algorithm>
+#include <random>
+
 #define POOL_SIZE 1024
+#define CHURN_SIZE (1 << 20)
+#define CHURN_DEPTH 16384
+#define FIXED_ROUNDS 256
 
 class PoolTest : public UnitTest {
 public:
@@ -24,7 +31,13 @@ public:
     void run () override {
         // run tests
         PoolCorrectnessTest ();
+        PoolAlignmentTest   ();
+        PoolPlacementTest   ();
+        PoolChurnTest       ();
+        PoolBatchTest       ();
         PoolSpeedTest       ();
+        FixedPoolCorrectnessTest ();
+        FixedPoolSpeedTest       ();
         
         // show results
         show                 ();
@@ -49,7 +62,7 @@ public:
         assert("Pool Allocation Test 3", true, c != nullptr);
         
         manager.reportStatus();
-        assert("Pool Allocation Test 4", manager.occupiedMemory(), sizeof(double) + sizeof(int) + sizeof(bool));
+        assert("Pool Allocation Test 4", manager.occupiedMemory(), 2 * (MemoryManager::span(0) + alignof(std::max_align_t)) + MemoryManager::span(sizeof(bool)));
         
         *a = 3.14159;
         *b = 256;
@@ -63,7 +76,7 @@ public:
         manager.reportStatus();
         assert("Pool Deallocation test 2", manager.deallocate(b), true);
         manager.reportStatus();
-        assert("Pool Deallocation test 3", manager.occupiedMemory(), sizeof(double));
+        assert("Pool Deallocation test 3", manager.occupiedMemory(), MemoryManager::span(sizeof(double)));
         
         int* d = (int*) manager.allocate(sizeof(int));
         assert("Pool Allocation Test 8", true, d != nullptr);
@@ -104,6 +117,104 @@ public:
         assert("Pool Allocation test 16", *h, 32);
     }
     
+    /**
+     *  Tests each placement policy picks the gap it should
+     */
+    void PoolPlacementTest () {
+        FreeIndex::Policy policies[] = { FreeIndex::FirstFit, FreeIndex::BestFit, FreeIndex::NextFit };
+        
+        for (FreeIndex::Policy policy : policies) {
+            MemoryManager manager (MemoryManager::Mode::Pool, POOL_SIZE, policy);
+            
+            char* a = (char*)manager.allocate(64);
+            char* b = (char*)manager.allocate(16);
+            char* c = (char*)manager.allocate(32);
+            char* d = (char*)manager.allocate(16);
+            
+            // leave a 64 byte gap and a 32 byte gap in front of d
+            manager.deallocate(a);
+            manager.deallocate(c);
+            
+            char* e = (char*)manager.allocate(32);
+            
+            switch (policy) {
+                case FreeIndex::FirstFit: assert("Pool First Fit Test", a, e);      break;
+                case FreeIndex::BestFit:  assert("Pool Best Fit Test", c, e);       break;
+                case FreeIndex::NextFit:  assert("Pool Next Fit Test", d + MemoryManager::span(16), e);  break;
+            }
+            
+            assert("Pool Placement Test", true, b != nullptr);
+        }
+    }
+    
+    /**
+     *  Tests freed blocks merge back together after heavy churn
+     */
+    void PoolChurnTest () {
+        size_t size = CHURN_SIZE + CHURN_DEPTH * MemoryManager::span(0);
+        MemoryManager manager (MemoryManager::Mode::Pool, size);
+        
+        std::vector<void*> blocks;
+        for (int i = 0; i < CHURN_DEPTH; ++i) blocks.push_back(manager.allocate(16 + (i % 4) * 8));
+        assert("Pool Churn Test 1", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+        
+        // free in a random order so every merge case gets hit
+        std::shuffle(blocks.begin(), blocks.end(), std::mt19937(42));
+        bool freed = true;
+        for (void* block : blocks) freed = manager.deallocate(block) && freed;
+        assert("Pool Churn Test 2", true, freed);
+        assert("Pool Churn Test 3", 0, manager.occupiedMemory());
+        
+        // the whole block should be one gap again
+        assert("Pool Churn Test 4", true, manager.allocate(size - 1 - MemoryManager::span(0)) != nullptr);
+    }
+    
+    /**
+     *  Tests batches are carved as one run and freed in one pass
+     */
+    void PoolBatchTest () {
+        size_t size = (CHURN_SIZE / 64) * MemoryManager::span(64);
+        MemoryManager manager (MemoryManager::Mode::Pool, size);
+        
+        std::vector<void*> blocks (CHURN_DEPTH / 16);
+        assert("Pool Batch Test 1", true, manager.allocateBatch(24, blocks.size(), blocks.data(), 32));
+        
+        size_t stride = (MemoryManager::span(24, 32) + 31) / 32 * 32;
+        bool carved = true;
+        for (size_t i = 1; i < blocks.size(); ++i) carved = carved && (char*)blocks[i] == (char*)blocks[i - 1] + stride;
+        assert("Pool Batch Test 2", true, carved);
+        // a bigger guarded pool need not start on the boundary, and pays padding first
+        if (!MemoryManager::guarded()) assert("Pool Batch Test 3", (size_t)32 * (blocks.size() - 1) + 24, manager.occupiedMemory());
+        
+        // every block of a batch can still be freed alone
+        assert("Pool Batch Test 4", true, manager.deallocate(blocks[5]));
+        
+        // a shuffled batch with a stale block, a stranger and nulls in it
+        std::vector<void*> batch (blocks);
+        batch.push_back(&blocks);
+        batch.push_back(nullptr);
+        batch.push_back(nullptr);
+        std::shuffle(batch.begin(), batch.end(), std::mt19937(7));
+        assert("Pool Batch Test 5", blocks.size() - 1, manager.deallocate(batch.data(), batch.size()));
+        // guarded blocks are checked and freed one at a time, in the order given
+        if (!MemoryManager::guarded()) assert("Pool Batch Test 6", true, std::is_sorted(batch.begin(), batch.begin() + blocks.size() - 1));
+        assert("Pool Batch Test 7", 0, manager.occupiedMemory());
+        assert("Pool Batch Test 8", true, manager.allocate(size - 1 - MemoryManager::span(0)) != nullptr);
+        manager.release();
+        
+        // no gap holds the run, so the blocks come one at a time
+        std::vector<void*> fill (CHURN_SIZE / 64);
+        assert("Pool Batch Test 9", true, manager.allocateBatch(64, fill.size(), fill.data()));
+        for (size_t i = 0; i < fill.size(); i += 2) manager.deallocate(fill[i]);
+        assert("Pool Batch Test 10", true, manager.allocateBatch(48, blocks.size(), blocks.data()));
+        
+        // all or nothing
+        size_t occupied = manager.occupiedMemory();
+        std::vector<void*> many (CHURN_SIZE / 64);
+        assert("Pool Batch Test 11", false, manager.allocateBatch(48, many.size(), many.data()));
+        assert("Pool Batch Test 12", occupied, manager.occupiedMemory());
+    }
+    
     /**
      *  Tests the pool can't be overfilled
      */
@@ -123,16 +234,36 @@ public:
         assert ("Pool Fill Test", true, true);
     }
     
+    /**
+     *  Tests blocks come back aligned whatever came before them
+     */
+    void PoolAlignmentTest () {
+        MemoryManager manager (MemoryManager::Mode::Pool, 4 * MemoryManager::Page);
+        
+        bool*   a = (bool*)   manager.allocate (sizeof(bool));
+        double* b = (double*) manager.allocate (sizeof(double));
+        char*   c = (char*)   manager.allocate (sizeof(char), MemoryManager::CacheLine);
+        char*   d = (char*)   manager.allocate (sizeof(char), MemoryManager::Page);
+        
+        assert("Pool Alignment Test 1", true, a != nullptr && b != nullptr && c != nullptr && d != nullptr);
+        assert("Pool Alignment Test 2", 0, (uintptr_t)b % alignof(std::max_align_t));
+        assert("Pool Alignment Test 3", 0, (uintptr_t)c % MemoryManager::CacheLine);
+        assert("Pool Alignment Test 4", 0, (uintptr_t)d % MemoryManager::Page);
+        assert("Pool Alignment Test 5", true, manager.allocate (sizeof(int), 3) == nullptr);
+    }
+    
     /**
      *  Tests the Pool implementation for speed vs new
      */
     void PoolSpeedTest () {
         MemoryManager manager (MemoryManager::Mode::Pool, POOL_SIZE);
+        std::vector<int*> blocks (TEST_DEPTH);
         
         // allocate a load of data with new
         clock_t newStart = clock();
-        for (int i = 0; i < TEST_DEPTH; ++i) new int();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
         double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
         
         // allocate a load of data with manager
         clock_t managedStart = clock();
@@ -142,6 +273,87 @@ public:
         // who was faster
         assert("Pool Speed Test",  true, (managedTime < newTime));
     }
+    
+    /**
+     *  Tests the fixed size pool hands out and takes back whole slots
+     */
+    void FixedPoolCorrectnessTest () {
+        FixedPool<sizeof(double) * 3> pool (4);
+        
+        assert("Fixed Pool Capacity Test", true, pool.capacity() >= 4);
+        
+        double* a = (double*) pool.allocate();
+        double* b = (double*) pool.allocate();
+        assert("Fixed Pool Allocation Test 1", true, a != nullptr && b != nullptr && a != b);
+        assert("Fixed Pool Allocation Test 2", 0, (uintptr_t)a % alignof(std::max_align_t));
+        assert("Fixed Pool Allocation Test 3", 2 * pool.SlotSize, pool.occupiedMemory());
+        
+        a[0] = 1.0; a[2] = 3.0;
+        b[0] = 4.0; b[2] = 6.0;
+        assert("Fixed Pool Allocation Test 4", 3.0, a[2]);
+        assert("Fixed Pool Allocation Test 5", 4.0, b[0]);
+        
+        // the freed slot comes straight back
+        assert("Fixed Pool Deallocation Test 1", true, pool.deallocate(a));
+        assert("Fixed Pool Allocation Test 6", (void*)a, pool.allocate());
+        
+        // pointers into the middle of a slot are not ours
+        assert("Fixed Pool Deallocation Test 2", false, pool.deallocate((char*)b + 1));
+        assert("Fixed Pool Deallocation Test 3", false, pool.deallocate(nullptr));
+        double outside;
+        assert("Fixed Pool Deallocation Test 4", false, pool.deallocate(&outside));
+        
+        // neither are slots never handed out
+        assert("Fixed Pool Deallocation Test 5", false, pool.deallocate((char*)b + pool.SlotSize));
+        assert("Fixed Pool Deallocation Test 6", 2 * pool.SlotSize, pool.occupiedMemory());
+        
+        // debug builds catch a slot freed twice
+        if (MemoryManager::guarded()) {
+            assert("Fixed Pool Deallocation Test 7", true, pool.deallocate(b));
+            assert("Fixed Pool Deallocation Test 8", false, pool.deallocate(b));
+            assert("Fixed Pool Deallocation Test 9", pool.SlotSize, pool.occupiedMemory());
+            assert("Fixed Pool Allocation Test 7", (void*)b, pool.allocate());
+        }
+        
+        while (pool.allocate() != nullptr) {}
+        assert("Fixed Pool Fill Test", pool.totalMemory(), pool.occupiedMemory());
+        
+        pool.release();
+        assert("Fixed Pool Release Test", 0, pool.occupiedMemory());
+    }
+    
+    /**
+     *  Tests the fixed size pool for throughput vs new and delete
+     */
+    void FixedPoolSpeedTest () {
+        struct Particle { double x, y, z; int id; };
+        FixedPool<sizeof(Particle), alignof(Particle)> pool (TEST_DEPTH);
+        std::vector<void*> blocks (TEST_DEPTH);
+        
+        // allocate and free a load of data with new and delete
+        clock_t newStart = clock();
+        for (int r = 0; r < FIXED_ROUNDS; ++r) {
+            for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new Particle();
+            for (int i = 0; i < TEST_DEPTH; ++i) delete (Particle*)blocks[i];
+        }
+        double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        
+        // allocate and free a load of data with the pool
+        clock_t pooledStart = clock();
+        for (int r = 0; r < FIXED_ROUNDS; ++r) {
+            for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new (pool.allocate()) Particle();
+            for (int i = 0; i < TEST_DEPTH; ++i) pool.deallocate(blocks[i]);
+        }
+        double pooledTime = (double)(clock() - pooledStart) / CLOCKS_PER_SEC;
+        
+        double operations = 2.0 * FIXED_ROUNDS * TEST_DEPTH;
+        std::cout << "new/delete:  " << operations / newTime    << " ops/s" << std::endl;
+        std::cout << "fixed pool:  " << operations / pooledTime << " ops/s" << std::endl;
+        std::cout << std::endl;
+        
+        // every slot went back
+        assert("Fixed Pool Speed Test", (size_t)0, pool.occupiedMemory());
+    }
 };
 
 #endif /* PoolTest_h */
@@ -8,9 +8,14 @@
 #define QueueTest_hpp
 
 #include "MemoryManager.hpp"
+#include "ConcurrentQueue.hpp"
 #include "UnitTest.hpp"
 
+#include <deque>
+#include <thread>
+
 #define POOL_SIZE 1024
+#define QUEUE_MESSAGES 200000
 
 class QueueTest : public UnitTest {
 public:
@@ -25,8 +30,11 @@ public:
     void run () override {
         // run tests
         QueueCorrectnessTest ();
+        QueueAlignmentTest   ();
         QueueFillTest        ();
+        QueueWrapTest        ();
         QueueSpeedTest       ();
+        QueueConcurrentTest  ();
         
         // show results
         show                 ();
@@ -51,7 +59,7 @@ public:
         assert("Queue Allocation Test 3", true, c != nullptr);
         
         manager.reportStatus();
-        assert("Queue Allocation Test 4", manager.occupiedMemory(), sizeof(double) + sizeof(int) + sizeof(bool));
+        assert("Queue Allocation Test 4", manager.occupiedMemory(), 2 * (MemoryManager::span(0) + alignof(std::max_align_t)) + MemoryManager::span(sizeof(bool)));
         
         *a = 3.14159;
         *b = 256;
@@ -68,7 +76,7 @@ public:
         manager.reportStatus();
         assert("Queue Deallocation test 2", manager.deallocate(b), true);
         manager.reportStatus();
-        assert("Queue Deallocation test 3", manager.occupiedMemory(), sizeof(double));
+        assert("Queue Deallocation test 3", manager.occupiedMemory(), MemoryManager::span(sizeof(double)));
         
         int* d = (int*) manager.allocate(sizeof(int));
         assert("Queue Allocation Test 8", true, d != nullptr);
@@ -117,16 +125,73 @@ public:
         assert ("Queue Fill Test", true, true);
     }
     
+    /**
+     *  Tests a FIFO runs round the same memory for ever
+     */
+    void QueueWrapTest () {
+        // room for the same six blocks however big their records make them
+        size_t size = POOL_SIZE + 6 * MemoryManager::span(0);
+        MemoryManager manager (MemoryManager::Mode::Queue, size);
+        
+        // far more than the queue holds goes through it, a few at a time
+        std::deque<char*> live;
+        bool placed = true, intact = true, wrapped = false;
+        for (int i = 0; i < 64 * TEST_DEPTH; ++i) {
+            char* block = (char*)manager.allocate(48 + i % 80);
+            placed = placed && block != nullptr;
+            if (block == nullptr) break;
+            
+            *block = (char)i;
+            wrapped = wrapped || (!live.empty() && block < live.back());
+            live.push_back(block);
+            if (live.size() == 6) {
+                intact = intact && *live.front() == (char)(i - 5);
+                manager.deallocate(live.front());
+                live.pop_front();
+            }
+        }
+        assert("Queue Wrap Test 1", true, placed);
+        assert("Queue Wrap Test 2", true, intact);
+        assert("Queue Wrap Test 3", true, wrapped);
+        assert("Queue Wrap Test 4", size, manager.totalMemory());
+        while (!live.empty()) {
+            manager.deallocate(live.back());
+            live.pop_back();
+        }
+        assert("Queue Wrap Test 5", 0, manager.occupiedMemory());
+        assert("Queue Wrap Test 6", true, manager.allocate(size - 1 - MemoryManager::span(0)) != nullptr);
+    }
+    
+    /**
+     *  Tests blocks come back aligned whatever came before them
+     */
+    void QueueAlignmentTest () {
+        MemoryManager manager (MemoryManager::Mode::Queue, 4 * MemoryManager::Page);
+        
+        bool*   a = (bool*)   manager.allocate (sizeof(bool));
+        double* b = (double*) manager.allocate (sizeof(double));
+        char*   c = (char*)   manager.allocate (sizeof(char), MemoryManager::CacheLine);
+        char*   d = (char*)   manager.allocate (sizeof(char), MemoryManager::Page);
+        
+        assert("Queue Alignment Test 1", true, a != nullptr && b != nullptr && c != nullptr && d != nullptr);
+        assert("Queue Alignment Test 2", 0, (uintptr_t)b % alignof(std::max_align_t));
+        assert("Queue Alignment Test 3", 0, (uintptr_t)c % MemoryManager::CacheLine);
+        assert("Queue Alignment Test 4", 0, (uintptr_t)d % MemoryManager::Page);
+        assert("Queue Alignment Test 5", true, manager.allocate (sizeof(int), 3) == nullptr);
+    }
+    
     /**
      *  Tests the Queue implementation for speed vs new
      */
     void QueueSpeedTest () {
         MemoryManager manager (MemoryManager::Mode::Queue, POOL_SIZE);
-     
+        std::vector<int*> blocks (TEST_DEPTH);
+        
         // allocate a load of data with new
         clock_t newStart = clock();
-        for (int i = 0; i < TEST_DEPTH; ++i) new int();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
         double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
         
         // allocate a load of data with manager
         clock_t managedStart = clock();
@@ -136,6 +201,44 @@ public:
         // who was faster
         assert("Queue Speed Test",  true, (managedTime < newTime));
     }
+    
+    /**
+     *  Tests a producer and a consumer passing messages in place
+     */
+    void QueueConcurrentTest () {
+        ConcurrentQueue queue (4 * MemoryManager::Page);
+        
+        assert("Queue Concurrent Test 1", (void*)nullptr, queue.allocate(queue.largest() + 1));
+        
+        std::thread producer ([&] () {
+            for (int i = 0; i < QUEUE_MESSAGES; ++i) {
+                size_t size = sizeof(int) * (1 + i % 100);
+                int*   message;
+                while (!(message = (int*)queue.allocate(size))) std::this_thread::yield();
+                
+                for (size_t k = 0; k < size / sizeof(int); ++k) message[k] = i;
+                queue.publish();
+            }
+        });
+        
+        bool ordered = true, aligned = true;
+        for (int i = 0; i < QUEUE_MESSAGES; ++i) {
+            size_t size;
+            int*   message;
+            while (!(message = (int*)queue.front(size))) std::this_thread::yield();
+            
+            aligned = aligned && (uintptr_t)message % alignof(std::max_align_t) == 0;
+            ordered = ordered && size == sizeof(int) * (1 + i % 100);
+            for (size_t k = 0; k < size / sizeof(int); ++k) ordered = ordered && message[k] == i;
+            ordered = queue.deallocate(message) && ordered;
+        }
+        producer.join();
+        
+        size_t size;
+        assert("Queue Concurrent Test 2", true, ordered);
+        assert("Queue Concurrent Test 3", true, aligned);
+        assert("Queue Concurrent Test 4", (void*)nullptr, queue.front(size));
+    }
 };
 
 #endif /* QueueTest_hpp */
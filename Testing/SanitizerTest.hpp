@@ -0,0 +1,141 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SanitizerTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef SanitizerTest_hpp
+#define SanitizerTest_hpp
+
+#include "MemoryManager.hpp"
+#include "Sanitizer.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define SANITIZER_CHURN_SIZE (1 << 18)
+
+class SanitizerTest : public UnitTest {
+public:
+    SanitizerTest () {}
+   ~SanitizerTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "Sanitizer Test"; }
+
+    void run () override {
+        // run tests
+        SanitizerPoisonTest  ();
+        SanitizerReleaseTest ();
+        SanitizerChurnTest   ();
+
+        // show results
+        show                 ();
+    }
+
+    /**
+     *  Tests a block is poisoned from its free until it is handed out again
+     */
+    void SanitizerPoisonTest () {
+        MemoryManager::Mode modes[] = { MemoryManager::Mode::Stack,  MemoryManager::Mode::Queue, MemoryManager::Mode::Pool,
+                                        MemoryManager::Mode::Bitmap, MemoryManager::Mode::Buddy, MemoryManager::Mode::TLSF };
+
+        bool handed = true, freed = true, refused = true;
+        for (MemoryManager::Mode mode : modes) {
+            MemoryManager manager (mode, POOL_SIZE);
+
+            char* a = (char*)manager.allocate(40);
+            char* b = (char*)manager.allocate(40);
+            handed = handed && !sanitizerPoisoned(a, 40) && !sanitizerPoisoned(b, 40);
+
+            // the newest block, so every mode frees it
+            std::memset(b, 1, 40);
+            manager.deallocate(b);
+            freed = freed && sanitizerPoisoned(b, 40) == poisons() && !sanitizerPoisoned(a, 40);
+
+            // checking a freed block never reads it
+            refused = refused && !manager.deallocate(b) && !manager.deallocate(b + 16);
+
+            char* c = (char*)manager.allocate(40);
+            handed = handed && !sanitizerPoisoned(c, 40);
+        }
+        assert("Sanitizer Poison Test 1", true, handed);
+        assert("Sanitizer Poison Test 2", true, freed);
+        assert("Sanitizer Poison Test 3", true, refused);
+    }
+
+    /**
+     *  Tests release poisons every block at once, and the memory is handed out again
+     */
+    void SanitizerReleaseTest () {
+        MemoryManager stack (MemoryManager::Mode::Stack, POOL_SIZE);
+        MemoryManager tlsf  (MemoryManager::Mode::TLSF,  POOL_SIZE);
+
+        char* a = (char*)stack.allocate(64);
+        char* b = (char*)stack.allocateHigh(64);
+        char* c = (char*)tlsf.allocate(64);
+        stack.release();
+        tlsf.release();
+        assert("Sanitizer Release Test 1", poisons(), sanitizerPoisoned(a, 64) && sanitizerPoisoned(b, 64) && sanitizerPoisoned(c, 64));
+
+        char* d = (char*)tlsf.allocate(POOL_SIZE / 2);
+        assert("Sanitizer Release Test 2", true, d != nullptr && !sanitizerPoisoned(d, POOL_SIZE / 2));
+    }
+
+    /**
+     *  Tests the strategies that keep metadata in free memory only ever
+     *  touch their own, as blocks are split, merged and chunks come and go
+     */
+    void SanitizerChurnTest () {
+        MemoryManager::Mode modes[] = { MemoryManager::Mode::Bitmap, MemoryManager::Mode::Buddy, MemoryManager::Mode::TLSF };
+
+        bool intact = true, freed = true;
+        for (MemoryManager::Mode mode : modes) {
+            MemoryManager manager (mode, SANITIZER_CHURN_SIZE, MemoryManager::Growth { MemoryManager::Growth::Fixed, 0, 0 });
+            std::mt19937 random (17);
+            std::vector<std::pair<char*, size_t>> live;
+
+            for (int i = 0; i < 16 * TEST_DEPTH; ++i) {
+                if (live.empty() || random() % 3 != 0) {
+                    size_t size      = 1 + random() % 2000;
+                    size_t alignment = (random() % 8 == 0) ? MemoryManager::CacheLine : MemoryManager::Default;
+                    char*  block     = (char*)manager.allocate(size, alignment);
+                    if (block == nullptr) continue;
+
+                    // the whole block is written, so a poisoned byte in it would be caught
+                    std::memset(block, (char)i, size);
+                    live.push_back({block, size});
+                } else {
+                    // the free list links in the first two words are the strategy's now
+                    size_t k     = random() % live.size();
+                    size_t links = 2 * sizeof(void*);
+                    intact = intact && manager.deallocate(live[k].first);
+                    freed  = freed && (live[k].second <= links || sanitizerPoisoned(live[k].first + links, live[k].second - links) == poisons());
+
+                    live[k] = live.back();
+                    live.pop_back();
+                }
+            }
+            for (auto& block : live) intact = manager.deallocate(block.first) && intact;
+            intact = intact && manager.occupiedMemory() == 0;
+        }
+        assert("Sanitizer Churn Test 1", true, intact);
+        assert("Sanitizer Churn Test 2", true, freed);
+    }
+
+private:
+    /** whether this build poisons freed blocks */
+    static bool poisons () {
+#ifdef SANITIZER_ASAN
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+#endif /* SanitizerTest_hpp */
@@ -0,0 +1,166 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SlabTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef SlabTest_hpp
+#define SlabTest_hpp
+
+#include "SlabAllocator.hpp"
+#include "UnitTest.hpp"
+
+#include <vector>
+
+#define SLAB_TEST_SIZE (1 << 22)
+
+class SlabTest : public UnitTest {
+public:
+    SlabTest () {}
+   ~SlabTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Slab Test"; }
+    
+    void run () override {
+        // run tests
+        SlabCorrectnessTest ();
+        SlabMixedTest       ();
+        SlabInvalidTest     ();
+        SlabSpeedTest       ();
+        
+        // show results
+        show                ();
+    }
+    
+    /**
+     *  Tests requests land in the right size class
+     */
+    void SlabCorrectnessTest () {
+        SlabAllocator slabs (SLAB_TEST_SIZE);
+        
+        assert("Slab Class Test 1", 8,    SlabAllocator::classSize(1));
+        assert("Slab Class Test 2", 16,   SlabAllocator::classSize(9));
+        assert("Slab Class Test 3", 64,   SlabAllocator::classSize(64));
+        assert("Slab Class Test 4", 4096, SlabAllocator::classSize(4000));
+        assert("Slab Class Test 5", 5000, SlabAllocator::classSize(5000));
+        
+        double* a = (double*) slabs.allocate(sizeof(double));
+        int*    b = (int*)    slabs.allocate(sizeof(int));
+        char*   c = (char*)   slabs.allocate(5000);
+        assert("Slab Allocation Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+        assert("Slab Allocation Test 2", 8 + 8 + 5000, slabs.occupiedMemory());
+        
+        *a = 3.14159;
+        *b = 256;
+        c[4999] = 'A';
+        assert("Slab Allocation Test 3", 3.14159, *a);
+        assert("Slab Allocation Test 4", 256, *b);
+        assert("Slab Allocation Test 5", 'A', c[4999]);
+        
+        // small frees reuse the slot, large frees go back to the pool
+        assert("Slab Deallocation Test 1", true, slabs.deallocate(b));
+        assert("Slab Deallocation Test 2", true, slabs.deallocate(c));
+        assert("Slab Deallocation Test 3", 8, slabs.occupiedMemory());
+        assert("Slab Allocation Test 6", (void*)b, slabs.allocate(sizeof(int)));
+        
+        // sized deallocation skips the lookup
+        assert("Slab Deallocation Test 4", true, slabs.deallocate(a, sizeof(double)));
+        
+        slabs.release();
+        assert("Slab Release Test", 0, slabs.occupiedMemory());
+    }
+    
+    /**
+     *  Tests a mix of sizes can be filled and emptied without overlap
+     */
+    void SlabMixedTest () {
+        SlabAllocator slabs (SLAB_TEST_SIZE);
+        std::vector<std::pair<char*, size_t>> blocks;
+        
+        for (size_t i = 0; i < TEST_DEPTH; ++i) {
+            size_t size = 1 + (i * 37) % 6000;
+            char* p = (char*)slabs.allocate(size);
+            if (p == nullptr) break;
+            for (size_t j = 0; j < size; ++j) p[j] = (char)i;
+            blocks.push_back({p, size});
+        }
+        assert("Slab Mixed Test 1", (size_t)TEST_DEPTH, blocks.size());
+        
+        bool intact = true;
+        for (size_t i = 0; i < blocks.size(); ++i)
+            for (size_t j = 0; j < blocks[i].second; ++j) intact = intact && blocks[i].first[j] == (char)i;
+        assert("Slab Mixed Test 2", true, intact);
+        
+        bool freed = true;
+        for (auto& block : blocks) freed = slabs.deallocate(block.first) && freed;
+        assert("Slab Mixed Test 3", true, freed);
+        assert("Slab Mixed Test 4", 0, slabs.occupiedMemory());
+    }
+    
+    /**
+     *  Tests pointers that are not a live slot are refused by both frees
+     */
+    void SlabInvalidTest () {
+        SlabAllocator slabs (SLAB_TEST_SIZE);
+        
+        char* a = (char*) slabs.allocate(64);
+        char* b = (char*) slabs.allocate(64);
+        assert("Slab Invalid Test 1", true, a != nullptr && b != nullptr);
+        
+        assert("Slab Invalid Test 2", false, slabs.deallocate(nullptr));
+        assert("Slab Invalid Test 3", false, slabs.deallocate(nullptr, 64));
+        assert("Slab Invalid Test 4", false, slabs.deallocate(a + 8));
+        assert("Slab Invalid Test 5", false, slabs.deallocate(a + 8, 64));
+        
+        // a slot never handed out, and one in another class
+        assert("Slab Invalid Test 6", false, slabs.deallocate(b + 64));
+        assert("Slab Invalid Test 7", false, slabs.deallocate(a, 8));
+        
+        // freed once only, whichever way
+        assert("Slab Invalid Test 8", true, slabs.deallocate(a));
+        assert("Slab Invalid Test 9", false, slabs.deallocate(a));
+        assert("Slab Invalid Test 10", false, slabs.deallocate(a, 64));
+        assert("Slab Invalid Test 11", true, slabs.deallocate(b, 64));
+        assert("Slab Invalid Test 12", false, slabs.deallocate(b, 64));
+        assert("Slab Invalid Test 13", 0, slabs.occupiedMemory());
+        
+        // and the list was left alone, so each slot comes back once
+        char* c = (char*) slabs.allocate(64);
+        char* d = (char*) slabs.allocate(64);
+        assert("Slab Invalid Test 14", true, c != d && (c == a || c == b) && (d == a || d == b));
+    }
+    
+    /**
+     *  Tests the slab allocator for speed vs new with mixed small sizes
+     */
+    void SlabSpeedTest () {
+        SlabAllocator slabs (SLAB_TEST_SIZE);
+        std::vector<void*> blocks (TEST_DEPTH);
+        
+        // allocate and free a load of data with new and delete
+        clock_t newStart = clock();
+        for (int r = 0; r < 64; ++r) {
+            for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new char[8 + (i % 64) * 8];
+            for (int i = 0; i < TEST_DEPTH; ++i) delete[] (char*)blocks[i];
+        }
+        double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        
+        // allocate and free a load of data with the slabs
+        clock_t managedStart = clock();
+        for (int r = 0; r < 64; ++r) {
+            for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = slabs.allocate(8 + (i % 64) * 8);
+            for (int i = 0; i < TEST_DEPTH; ++i) slabs.deallocate(blocks[i], 8 + (i % 64) * 8);
+        }
+        double managedTime = (double)(clock() - managedStart) / CLOCKS_PER_SEC;
+        
+        // print both times and check every slot came back
+        std::cout << "new/delete: " << newTime     << " s" << std::endl;
+        std::cout << "slabs:      " << managedTime << " s" << std::endl;
+        std::cout << std::endl;
+        assert("Slab Speed Test", (size_t)0, slabs.occupiedMemory());
+    }
+};
+
+#endif /* SlabTest_hpp */
@@ -0,0 +1,106 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SmartPointerTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef SmartPointerTest_hpp
+#define SmartPointerTest_hpp
+
+#include "MemoryManager.hpp"
+#include "SmartPointer.hpp"
+#include "UnitTest.hpp"
+
+#include <string>
+#include <utility>
+
+class SmartPointerTest : public UnitTest {
+public:
+    SmartPointerTest () {}
+   ~SmartPointerTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "Smart Pointer Test"; }
+    
+    void run () override {
+        // run tests
+        SmartPointerCorrectnessTest  ();
+        SharedPointerCorrectnessTest ();
+        
+        // show results
+        show                         ();
+    }
+    
+    /**
+     *  Tests the unique handle owns and returns its block
+     */
+    void SmartPointerCorrectnessTest () {
+        static_assert (sizeof(SmartPointer<double>) == sizeof(double*), "handle must be a raw pointer");
+        
+        MemoryManager manager (MemoryManager::Mode::Pool, POOL_SIZE);
+        
+        {
+            SmartPointer<double> a = makeSmartPointer<double>(manager, 3.14159);
+            assert("Smart Pointer Test 1", true, (bool)a);
+            assert("Smart Pointer Test 2", 3.14159, a.load());
+            assert("Smart Pointer Test 3", &manager, a.owner());
+            
+            a.store(2.71828);
+            assert("Smart Pointer Test 4", 2.71828, *a);
+            
+            SmartPointer<double> b = std::move(a);
+            assert("Smart Pointer Test 5", false, (bool)a);
+            assert("Smart Pointer Test 6", 2.71828, *b);
+            
+            SmartPointer<std::string> c = makeSmartPointer<std::string>(manager, "managed");
+            assert("Smart Pointer Test 7", (size_t)7, c->size());
+        }
+        
+        // both blocks went back when the handles died
+        assert("Smart Pointer Test 8", 0, manager.occupiedMemory());
+        
+        SmartPointer<char> d = makeSmartPointer<char>(manager, 'A');
+        d.reset();
+        assert("Smart Pointer Test 9", 0, manager.occupiedMemory());
+        
+        struct Big { char bytes[POOL_SIZE]; };
+        SmartPointer<Big> e = makeSmartPointer<Big>(manager);
+        assert("Smart Pointer Test 10", false, (bool)e);
+    }
+    
+    /**
+     *  Tests the shared handle counts references in the block header
+     */
+    void SharedPointerCorrectnessTest () {
+        static_assert (sizeof(SharedPointer<int>) == sizeof(int*), "handle must be a raw pointer");
+        
+        MemoryManager manager (MemoryManager::Mode::Pool, POOL_SIZE);
+        
+        {
+            SharedPointer<int> a = makeSharedPointer<int>(manager, 256);
+            assert("Shared Pointer Test 1", (size_t)1, a.count());
+            
+            SharedPointer<int> b = a;
+            assert("Shared Pointer Test 2", (size_t)2, a.count());
+            
+            b.store(512);
+            assert("Shared Pointer Test 3", 512, a.load());
+            
+            {
+                SharedPointer<int> c;
+                c = b;
+                assert("Shared Pointer Test 4", (size_t)3, c.count());
+            }
+            assert("Shared Pointer Test 5", (size_t)2, a.count());
+            
+            a.reset();
+            assert("Shared Pointer Test 6", (size_t)1, b.count());
+            assert("Shared Pointer Test 7", true, manager.occupiedMemory() > 0);
+        }
+        
+        assert("Shared Pointer Test 8", 0, manager.occupiedMemory());
+    }
+};
+
+#endif /* SmartPointerTest_hpp */
@@ -7,6 +7,7 @@
 #define StackTest_hpp
 
 #include "MemoryManager.hpp"
+#include "ScopedFrame.hpp"
 #include "UnitTest.hpp"
 
 #define POOL_SIZE  1024
@@ -25,7 +26,12 @@ public:
     void run () override {
         // run tests
         StackCorrectnessTest ();
+        StackAlignmentTest   ();
         StackFillTest        ();
+        StackBatchTest       ();
+        StackMarkerTest      ();
+        StackFrameTest       ();
+        StackHighTest        ();
         StackSpeedTest       ();
         
         // show results
@@ -51,7 +57,7 @@ public:
         assert("Stack Allocation Test 3", true, c != nullptr);
         
         manager.reportStatus();
-        assert("Stack Allocation Test 4", manager.occupiedMemory(), sizeof(double) + sizeof(int) + sizeof(bool));
+        assert("Stack Allocation Test 4", manager.occupiedMemory(), 2 * (MemoryManager::span(0) + alignof(std::max_align_t)) + MemoryManager::span(sizeof(bool)));
         
         *a = 3.14159;
         *b = 256;
@@ -68,7 +74,7 @@ public:
         manager.reportStatus();
         assert("Stack Deallocation test 2", manager.deallocate(b), true);
         manager.reportStatus();
-        assert("Stack Deallocation test 3", manager.occupiedMemory(), sizeof(double));
+        assert("Stack Deallocation test 3", manager.occupiedMemory(), MemoryManager::span(sizeof(double)));
         
         int* d = (int*) manager.allocate(sizeof(int));
         assert("Stack Allocation Test 8", true, d != nullptr);
@@ -117,16 +123,131 @@ public:
         assert ("Stack Fill Test", true, true);
     }
     
+    /**
+     *  Tests blocks come back aligned whatever came before them
+     */
+    void StackAlignmentTest () {
+        MemoryManager manager (MemoryManager::Mode::Stack, 4 * MemoryManager::Page);
+        
+        bool*   a = (bool*)   manager.allocate (sizeof(bool));
+        double* b = (double*) manager.allocate (sizeof(double));
+        char*   c = (char*)   manager.allocate (sizeof(char), MemoryManager::CacheLine);
+        char*   d = (char*)   manager.allocate (sizeof(char), MemoryManager::Page);
+        
+        assert("Stack Alignment Test 1", true, a != nullptr && b != nullptr && c != nullptr && d != nullptr);
+        assert("Stack Alignment Test 2", 0, (uintptr_t)b % alignof(std::max_align_t));
+        assert("Stack Alignment Test 3", 0, (uintptr_t)c % MemoryManager::CacheLine);
+        assert("Stack Alignment Test 4", 0, (uintptr_t)d % MemoryManager::Page);
+        assert("Stack Alignment Test 5", true, manager.allocate (sizeof(int), 3) == nullptr);
+    }
+    
+    /**
+     *  Tests a batch is pushed at once and popped newest first
+     */
+    void StackBatchTest () {
+        MemoryManager manager (MemoryManager::Mode::Stack, POOL_SIZE);
+        
+        void* blocks[4];
+        void* big[4];
+        assert("Stack Batch Test 1", true, manager.allocateBatch(sizeof(int), 4, blocks));
+        assert("Stack Batch Test 2", false, manager.allocateBatch(POOL_SIZE / 4, 4, big));
+        
+        // only the newest two can go, the rest stay in the stack
+        void* batch[] = { blocks[3], blocks[1], blocks[2] };
+        assert("Stack Batch Test 3", (size_t)2, manager.deallocate(batch, 3));
+        assert("Stack Batch Test 4", blocks[1], batch[2]);
+        
+        void* rest[] = { blocks[1], blocks[0] };
+        assert("Stack Batch Test 5", (size_t)2, manager.deallocate(rest, 2));
+        assert("Stack Batch Test 6", 0, manager.occupiedMemory());
+    }
+    
+    /**
+     *  Tests freeing to a marker pops everything above it at once
+     */
+    void StackMarkerTest () {
+        MemoryManager manager (MemoryManager::Mode::Stack, POOL_SIZE);
+        
+        void* a = manager.allocate(sizeof(int));
+        MemoryManager::Marker marker = manager.getMarker();
+        size_t occupied = manager.occupiedMemory();
+        
+        for (int i = 0; i < 8; ++i) manager.allocate(1 + i * 8);
+        assert("Stack Marker Test 1", true, manager.freeToMarker(marker));
+        assert("Stack Marker Test 2", occupied, manager.occupiedMemory());
+        assert("Stack Marker Test 3", true, manager.freeToMarker(marker));
+        
+        // the block under the marker is the top again
+        assert("Stack Marker Test 4", true, manager.deallocate(a));
+        assert("Stack Marker Test 5", false, manager.freeToMarker(marker));
+        
+        MemoryManager pool (MemoryManager::Mode::Pool, POOL_SIZE);
+        assert("Stack Marker Test 6", false, pool.freeToMarker(pool.getMarker()));
+    }
+    
+    /**
+     *  Tests nested frames roll back as their scopes end
+     */
+    void StackFrameTest () {
+        BasicMemoryManager<StackStrategy> manager (POOL_SIZE);
+        
+        void* outer = nullptr;
+        {
+            ScopedFrame<BasicMemoryManager<StackStrategy>> frame (manager);
+            outer = frame.allocate(100);
+            {
+                ScopedFrame<BasicMemoryManager<StackStrategy>> inner (manager);
+                for (int i = 0; i < 4; ++i) inner.allocate(64);
+                assert("Stack Frame Test 1", true, manager.occupiedMemory() > 256);
+            }
+            assert("Stack Frame Test 2", true, manager.freeable(outer));
+            assert("Stack Frame Test 3", (size_t)100, manager.occupiedMemory());
+        }
+        assert("Stack Frame Test 4", 0, manager.occupiedMemory());
+        assert("Stack Frame Test 5", outer, manager.allocate(100));
+    }
+    
+    /**
+     *  Tests both ends of the block fill towards each other
+     */
+    void StackHighTest () {
+        MemoryManager manager (MemoryManager::Mode::Stack, POOL_SIZE);
+        
+        char* low  = (char*)manager.allocate(100);
+        char* high = (char*)manager.allocateHigh(100);
+        char* top  = (char*)manager.allocateHigh(8, MemoryManager::CacheLine);
+        assert("Stack High Test 1", true, low != nullptr && high != nullptr && top != nullptr);
+        assert("Stack High Test 2", true, high > top && top > low + 100);
+        assert("Stack High Test 3", 0, (uintptr_t)top % MemoryManager::CacheLine);
+        
+        // neither end can run into the other
+        assert("Stack High Test 4", true, manager.allocate(POOL_SIZE - 200) == nullptr);
+        assert("Stack High Test 5", true, manager.allocateHigh(POOL_SIZE - 200) == nullptr);
+        
+        // scratch at the low end comes and goes under the long lived blocks
+        MemoryManager::Marker marker = manager.getMarker();
+        for (int i = 0; i < 4; ++i) manager.allocate(64);
+        manager.freeToMarker(marker);
+        assert("Stack High Test 6", false, manager.deallocate(high));
+        assert("Stack High Test 7", true, manager.deallocate(top) && manager.deallocate(high));
+        assert("Stack High Test 8", true, manager.deallocate(low));
+        assert("Stack High Test 9", 0, manager.occupiedMemory());
+        
+        assert("Stack High Test 10", (void*)nullptr, MemoryManager (MemoryManager::Mode::Queue, POOL_SIZE).allocateHigh(8));
+    }
+    
     /**
      *  Tests the Stack implementation for speed vs new
      */
     void StackSpeedTest () {
         MemoryManager manager (MemoryManager::Mode::Stack, POOL_SIZE);
-
+        std::vector<int*> blocks (TEST_DEPTH);
+        
         // allocate a load of data with new
         clock_t newStart = clock();
-        for (int i = 0; i < TEST_DEPTH; ++i) new int();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
         double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
   
         // allocate a load of data with manager
         clock_t managedStart = clock();
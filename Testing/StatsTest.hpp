@@ -0,0 +1,157 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  StatsTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef StatsTest_hpp
+#define StatsTest_hpp
+
+#include "BasicMemoryManager.hpp"
+#include "StackStrategy.hpp"
+#include "PoolStrategy.hpp"
+#include "Stats.hpp"
+#include "UnitTest.hpp"
+
+#include <thread>
+#include <vector>
+
+#define STATS_THREADS 4
+#define STATS_ROUNDS  1024
+
+class StatsTest : public UnitTest {
+public:
+    StatsTest () {}
+   ~StatsTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "Stats Test"; }
+
+    void run () override {
+        // run tests
+        StatsCountTest    ();
+        StatsFragmentTest ();
+        StatsJsonTest     ();
+        StatsNoneTest     ();
+        StatsLockedTest   ();
+
+        // show results
+        show              ();
+    }
+
+    /**
+     *  Tests allocations, frees, failures, the histogram and the peak
+     */
+    void StatsCountTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, Stats> pool (POOL_SIZE);
+
+        void* a = pool.allocate(8);
+        void* b = pool.allocate(100);
+        void* c = pool.allocate(8);
+        size_t peak = pool.occupiedMemory();
+        pool.deallocate(b);
+        pool.deallocate(b);
+        pool.allocate(POOL_SIZE);
+
+        Statistics stats = pool.statistics();
+        assert("Stats Count Test 1", (size_t)3, stats.allocations);
+        assert("Stats Count Test 2", (size_t)1, stats.frees);
+        assert("Stats Count Test 3", (size_t)1, stats.failures);
+        assert("Stats Count Test 4", (size_t)2, stats.histogram[statsBucket(8)]);
+        assert("Stats Count Test 5", (size_t)1, stats.histogram[statsBucket(100)]);
+        assert("Stats Count Test 6", peak, stats.peak);
+        assert("Stats Count Test 7", pool.occupiedMemory(), stats.occupied);
+        assert("Stats Count Test 8", true, stats.averageSearch >= 1.0);
+        assert("Stats Count Test 9", true, pool.deallocate(a) && pool.deallocate(c));
+
+        assert("Stats Bucket Test 1", 0u, statsBucket(0));
+        assert("Stats Bucket Test 2", 1u, statsBucket(1));
+        assert("Stats Bucket Test 3", 4u, statsBucket(15));
+        assert("Stats Bucket Test 4", (unsigned)STATS_BUCKETS - 1, statsBucket(size_t(-1)));
+    }
+
+    /**
+     *  Tests the largest free block against the free bytes
+     */
+    void StatsFragmentTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, Stats> pool (POOL_SIZE);
+
+        Statistics stats = pool.statistics();
+        assert("Stats Fragment Test 1", 1.0, stats.fragmentation);
+        assert("Stats Fragment Test 2", (size_t)POOL_SIZE, stats.largestFree);
+
+        void* a = pool.allocate(64);
+        void* b = pool.allocate(64);
+        void* c = pool.allocate(64);
+        pool.deallocate(b);
+
+        stats = pool.statistics();
+        assert("Stats Fragment Test 3", (size_t)POOL_SIZE - 192, stats.largestFree);
+        assert("Stats Fragment Test 4", true, stats.fragmentation < 1.0 && stats.fragmentation > 0.0);
+
+        pool.deallocate(a);
+        pool.deallocate(c);
+        assert("Stats Fragment Test 5", 1.0, pool.statistics().fragmentation);
+
+        BasicMemoryManager<StackStrategy, SingleThreaded, Backing, Stats> stack (POOL_SIZE);
+        stack.allocate(100);
+        stats = stack.statistics();
+        assert("Stats Fragment Test 6", stats.total - stats.occupied, stats.largestFree);
+        assert("Stats Fragment Test 7", 0.0, stats.averageSearch);
+    }
+
+    /**
+     *  Tests the JSON dump carries every field
+     */
+    void StatsJsonTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, Stats> pool (POOL_SIZE);
+        pool.allocate(8);
+
+        std::string json = pool.statistics().json();
+        assert("Stats Json Test 1", '{', json.front());
+        assert("Stats Json Test 2", '}', json.back());
+        assert("Stats Json Test 3", true, json.find("\"allocations\":1,") != std::string::npos);
+        assert("Stats Json Test 4", true, json.find("\"histogram\":[0,0,0,0,1,0") != std::string::npos);
+        assert("Stats Json Test 5", true, json.find("\"fragmentation\":1,") != std::string::npos);
+    }
+
+    /**
+     *  Tests a manager without stats still reports its memory
+     */
+    void StatsNoneTest () {
+        BasicMemoryManager<PoolStrategy> pool (POOL_SIZE);
+        pool.allocate(8);
+
+        Statistics stats = pool.statistics();
+        assert("Stats None Test 1", (size_t)0, stats.allocations);
+        assert("Stats None Test 2", pool.occupiedMemory(), stats.occupied);
+        assert("Stats None Test 3", pool.occupiedMemory(), stats.peak);
+        assert("Stats None Test 4", true, sizeof(BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, Stats>) > sizeof(BasicMemoryManager<PoolStrategy>));
+    }
+
+    /**
+     *  Tests no count is lost between threads sharing a locked pool
+     */
+    void StatsLockedTest () {
+        BasicMemoryManager<PoolStrategy, Locked, Backing, Stats> pool (STATS_THREADS * STATS_ROUNDS * 64);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < STATS_THREADS; ++t) {
+            workers.emplace_back ([&] () {
+                std::vector<void*> blocks;
+                for (int i = 0; i < STATS_ROUNDS; ++i) blocks.push_back(pool.allocate(16));
+                for (void* block : blocks) pool.deallocate(block);
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+
+        Statistics stats = pool.statistics();
+        assert("Stats Locked Test 1", (size_t)STATS_THREADS * STATS_ROUNDS, stats.allocations);
+        assert("Stats Locked Test 2", (size_t)STATS_THREADS * STATS_ROUNDS, stats.frees);
+        assert("Stats Locked Test 3", (size_t)STATS_THREADS * STATS_ROUNDS, stats.histogram[statsBucket(16)]);
+        assert("Stats Locked Test 4", (size_t)0, stats.occupied);
+    }
+};
+
+#endif /* StatsTest_hpp */
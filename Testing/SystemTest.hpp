@@ -0,0 +1,66 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  SystemTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef SystemTest_hpp
+#define SystemTest_hpp
+
+#include "SystemQueries.hpp"
+#include "UnitTest.hpp"
+
+#include <ctime>
+
+#define SYSTEM_QUERIES 100000
+
+class SystemTest : public UnitTest {
+public:
+    SystemTest () {}
+   ~SystemTest () {}
+    
+    void setup    () override {}
+    void teardown () override {}
+    
+    std::string name () override { return "System Test"; }
+    
+    void run () override {
+        // run tests
+        SystemQueriesTest ();
+        SystemCachedTest  ();
+        
+        // show results
+        show              ();
+    }
+    
+    /**
+     *  Tests the queries give sensible answers
+     */
+    void SystemQueriesTest () {
+        unsigned long long total     = totalSystemMemory();
+        unsigned long long available = availableSystemMemory();
+        unsigned long long page      = systemPageSize();
+        
+        assert("System Queries Test 1", true, total > 0);
+        assert("System Queries Test 2", true, available > 0 && available <= total);
+        assert("System Queries Test 3", true, page >= 4096 && (page & (page - 1)) == 0);
+        assert("System Queries Test 4", true, memoryLimit() > 0 && memoryLimit() <= total);
+        assert("System Queries Test 5", true, cgroupMemoryLimit() == 0 || cgroupMemoryLimit() == memoryLimit());
+    }
+    
+    /**
+     *  Tests the fixed queries cost nothing after the first call
+     */
+    void SystemCachedTest () {
+        unsigned long long sum = 0;
+        
+        clock_t start = clock();
+        for (int i = 0; i < SYSTEM_QUERIES; ++i) sum += totalSystemMemory() + memoryLimit() + systemPageSize();
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        
+        // a hundred thousand file reads would take far longer
+        assert("System Cached Test 1", true, seconds < 0.01);
+        assert("System Cached Test 2", true, sum > 0);
+    }
+};
+
+#endif /* SystemTest_hpp */
@@ -0,0 +1,232 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  TLSFTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef TLSFTest_hpp
+#define TLSFTest_hpp
+
+#include "MemoryManager.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define TLSF_CHURN_SIZE (1 << 20)
+#define TLSF_SPEED_SIZE (1 << 18)
+
+class TLSFTest : public UnitTest {
+public:
+    TLSFTest () {}
+   ~TLSFTest () {}
+
+    void setup    () override {}
+    void teardown () override {}
+
+    std::string name () override { return "TLSF Test"; }
+
+    void run () override {
+        // run tests
+        TLSFCorrectnessTest ();
+        TLSFMergeTest       ();
+        TLSFAlignmentTest   ();
+        TLSFChurnTest       ();
+        TLSFGrowthTest      ();
+        TLSFSpeedTest       ();
+
+        // show results
+        show                ();
+    }
+
+    /**
+     *  Tests blocks are granules behind a tag and freed in any order
+     */
+    void TLSFCorrectnessTest () {
+        MemoryManager manager (MemoryManager::Mode::TLSF, POOL_SIZE);
+
+        double* a = (double*) manager.allocate (sizeof(double));
+        int*    b = (int*)    manager.allocate (sizeof(int));
+        char*   c = (char*)   manager.allocate (100);
+        assert("TLSF Allocation Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+
+        // every block is its granules and a tag
+        assert("TLSF Allocation Test 2", rounded(sizeof(double)) + rounded(sizeof(int)) + rounded(100), manager.occupiedMemory());
+        assert("TLSF Allocation Test 3", rounded(sizeof(double)), (size_t)((char*)b - (char*)a));
+
+        *a = 3.14159;
+        *b = 256;
+        c[99] = 'A';
+        assert("TLSF Allocation Test 4", 3.14159, *a);
+        assert("TLSF Allocation Test 5", 256, *b);
+        assert("TLSF Allocation Test 6", 'A', c[99]);
+
+        assert("TLSF Deallocation Test 1", true, manager.deallocate(b));
+        assert("TLSF Deallocation Test 2", false, manager.deallocate(b));
+        assert("TLSF Deallocation Test 3", false, manager.deallocate(c + 16));
+        assert("TLSF Deallocation Test 4", (void*)b, manager.allocate(sizeof(int)));
+        assert("TLSF Deallocation Test 5", true, manager.deallocate(a) && manager.deallocate(c) && manager.deallocate(b));
+        assert("TLSF Deallocation Test 6", 0, manager.occupiedMemory());
+
+        void* d = manager.allocate(1);
+        void* e = manager.allocate(100);
+        manager.release();
+        assert("TLSF Release Test 1", 0, manager.occupiedMemory());
+
+        // blocks from before the release are gone, whatever their tags still say
+        assert("TLSF Release Test 2", false, manager.deallocate(e));
+        assert("TLSF Release Test 3", (void*)d, manager.allocate(1));
+        assert("TLSF Release Test 4", false, manager.deallocate(e));
+        assert("TLSF Release Test 5", true, manager.deallocate(d) && manager.occupiedMemory() == 0);
+    }
+
+    /**
+     *  Tests a freed block merges with free neighbours on both sides
+     */
+    void TLSFMergeTest () {
+        MemoryManager manager (MemoryManager::Mode::TLSF, POOL_SIZE);
+        size_t largest = manager.statistics().largestFree;
+
+        void* a = manager.allocate(200);
+        void* b = manager.allocate(200);
+        void* c = manager.allocate(200);
+        assert("TLSF Merge Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+
+        // the middle block merges with both, the last with the free rest after it
+        manager.deallocate(a);
+        manager.deallocate(c);
+        assert("TLSF Merge Test 2", true, manager.statistics().largestFree < largest);
+        manager.deallocate(b);
+        assert("TLSF Merge Test 3", largest, manager.statistics().largestFree);
+        assert("TLSF Merge Test 4", a, manager.allocate(largest - MemoryManager::span(0)));
+    }
+
+    /**
+     *  Tests alignment padding goes back as a free block of its own
+     */
+    void TLSFAlignmentTest () {
+        MemoryManager manager (MemoryManager::Mode::TLSF, 4 * MemoryManager::Page);
+
+        bool*   a = (bool*)   manager.allocate (sizeof(bool));
+        char*   b = (char*)   manager.allocate (sizeof(char), MemoryManager::CacheLine);
+        char*   c = (char*)   manager.allocate (sizeof(char), MemoryManager::Page);
+
+        assert("TLSF Alignment Test 1", true, a != nullptr && b != nullptr && c != nullptr);
+        assert("TLSF Alignment Test 2", 0, (uintptr_t)a % alignof(std::max_align_t));
+        assert("TLSF Alignment Test 3", 0, (uintptr_t)b % MemoryManager::CacheLine);
+        assert("TLSF Alignment Test 4", 0, (uintptr_t)c % MemoryManager::Page);
+
+        // padding is left free, so only the blocks themselves count
+        assert("TLSF Alignment Test 5", rounded(sizeof(bool)) + rounded(sizeof(char), MemoryManager::CacheLine) + rounded(sizeof(char), MemoryManager::Page), manager.occupiedMemory());
+
+        // and is there to be handed out
+        assert("TLSF Alignment Test 6", true, manager.allocate(1) < (void*)c);
+    }
+
+    /**
+     *  Tests random allocations and frees never overlap, lose memory or
+     *  leave free neighbours unmerged once everything is freed
+     */
+    void TLSFChurnTest () {
+        MemoryManager manager (MemoryManager::Mode::TLSF, TLSF_CHURN_SIZE);
+        size_t largest = manager.statistics().largestFree;
+        std::mt19937 random (13);
+        std::vector<std::pair<char*, size_t>> live;
+        std::vector<size_t> taken; // what each live block took, which its alignment changes when guarded
+
+        bool intact = true;
+        size_t expected = 0;
+        for (int i = 0; i < 64 * TEST_DEPTH; ++i) {
+            if (live.empty() || random() % 3 != 0) {
+                size_t size      = 1 + random() % 3000;
+                size_t alignment = (random() % 8 == 0) ? MemoryManager::CacheLine : MemoryManager::Default;
+                char*  block     = (char*)manager.allocate(size, alignment);
+                if (block == nullptr) continue;
+
+                intact = intact && (uintptr_t)block % alignment == 0;
+                std::fill(block, block + size, (char)live.size());
+                live.push_back({block, size});
+                taken.push_back(rounded(size, alignment));
+                expected += taken.back();
+            } else {
+                size_t k = random() % live.size();
+                intact = intact && live[k].first[live[k].second - 1] == (char)k && manager.deallocate(live[k].first);
+                expected -= taken[k];
+
+                // the last block takes the freed place in the list
+                live[k] = live.back();
+                live.pop_back();
+                taken[k] = taken.back();
+                taken.pop_back();
+                if (k < live.size()) std::fill(live[k].first, live[k].first + live[k].second, (char)k);
+            }
+        }
+        assert("TLSF Churn Test 1", true, intact);
+
+        // the rest of a block too small to split off stays with it
+        assert("TLSF Churn Test 2", true, expected <= manager.occupiedMemory() && manager.occupiedMemory() <= expected + live.size() * TLSF_HEADER);
+
+        std::sort(live.begin(), live.end());
+        bool apart = true;
+        for (size_t k = 1; k < live.size(); ++k) apart = apart && live[k - 1].first + live[k - 1].second <= live[k].first;
+        assert("TLSF Churn Test 3", true, apart);
+
+        for (auto& block : live) manager.deallocate(block.first);
+        assert("TLSF Churn Test 4", 0, manager.occupiedMemory());
+        assert("TLSF Churn Test 5", largest, manager.statistics().largestFree);
+    }
+
+    /**
+     *  Tests extra chunks join the same lists and go back once empty
+     */
+    void TLSFGrowthTest () {
+        MemoryManager manager (MemoryManager::Mode::TLSF, POOL_SIZE, MemoryManager::Growth { MemoryManager::Growth::Fixed, 0, 0 });
+
+        std::vector<void*> blocks;
+        for (int i = 0; i < 256; ++i) blocks.push_back(manager.allocate(500));
+        assert("TLSF Growth Test 1", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+        assert("TLSF Growth Test 2", true, manager.totalMemory() > POOL_SIZE);
+
+        void* big = manager.allocate(3 * CHUNK_GRANULE, MemoryManager::Page);
+        assert("TLSF Growth Test 3", true, big != nullptr);
+        assert("TLSF Growth Test 4", 0, (uintptr_t)big % MemoryManager::Page);
+
+        blocks.push_back(big);
+        for (void* block : blocks) manager.deallocate(block);
+        manager.release();
+        assert("TLSF Growth Test 5", (size_t)POOL_SIZE, manager.totalMemory());
+    }
+
+    /**
+     *  Tests the TLSF implementation for speed vs new
+     */
+    void TLSFSpeedTest () {
+        MemoryManager manager (MemoryManager::Mode::TLSF, TLSF_SPEED_SIZE);
+        std::vector<int*> blocks (TEST_DEPTH);
+
+        // allocate a load of data with new
+        clock_t newStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = new int();
+        double newTime = (double)(clock() - newStart) / CLOCKS_PER_SEC;
+        for (int* block : blocks) delete block;
+
+        // allocate a load of data with manager
+        clock_t managedStart = clock();
+        for (int i = 0; i < TEST_DEPTH; ++i) blocks[i] = (int*)manager.allocate(sizeof(int));
+        double managedTime = (double)(clock() - managedStart) / CLOCKS_PER_SEC;
+
+        // show the times, and check no request failed
+        std::cout << "new:   " << newTime     << " s" << std::endl;
+        std::cout << "tlsf:  " << managedTime << " s" << std::endl;
+        std::cout << std::endl;
+        assert("TLSF Speed Test", true, std::find(blocks.begin(), blocks.end(), nullptr) == blocks.end());
+    }
+
+private:
+    /** the granules and tag a request of _size takes, its record included */
+    static size_t rounded (size_t _size, size_t _alignment = MemoryManager::Default) {
+        return (MemoryManager::span(_size, _alignment) + TLSF_GRANULE - 1) / TLSF_GRANULE * TLSF_GRANULE + TLSF_HEADER;
+    }
+};
+
+#endif /* TLSFTest_hpp */
@@ -0,0 +1,130 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  TraceTest.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef TraceTest_hpp
+#define TraceTest_hpp
+
+#include "BasicMemoryManager.hpp"
+#include "PoolStrategy.hpp"
+#include "Trace.hpp"
+#include "UnitTest.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define TRACE_FILE    "TraceTest.trace"
+#define TRACE_THREADS 4
+#define TRACE_ROUNDS  3000 // two events a round, so every ring fills at least once
+
+class TraceTest : public UnitTest {
+public:
+    TraceTest () {}
+   ~TraceTest () {}
+
+    void setup    () override {}
+    void teardown () override { std::remove (TRACE_FILE); }
+
+    std::string name () override { return "Trace Test"; }
+
+    void run () override {
+        // run tests
+        TraceRecordTest  ();
+        TraceThreadsTest ();
+        TraceStoppedTest ();
+        teardown         ();
+
+        // show results
+        show             ();
+    }
+
+    /**
+     *  Tests every call is written and read back in order
+     */
+    void TraceRecordTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, Traced<Stats>> pool (POOL_SIZE);
+        TraceRecorder& recorder = TraceRecorder::global();
+
+        assert("Trace Record Test 1", true, recorder.start(TRACE_FILE));
+        assert("Trace Record Test 2", false, recorder.start(TRACE_FILE));
+
+        void* a = pool.allocate(8);
+        void* b = pool.allocate(100);
+        pool.deallocate(a);
+        pool.deallocate(a);
+        pool.allocate(POOL_SIZE);
+        pool.deallocate(b);
+        recorder.stop();
+
+        std::vector<TraceEvent> events;
+        assert("Trace Record Test 3", true, loadTrace(TRACE_FILE, events));
+        assert("Trace Record Test 4", (size_t)4, events.size());
+        assert("Trace Record Test 5", (size_t)4, recorder.written());
+        if (events.size() != 4) return;
+
+        assert("Trace Record Test 6", (uint32_t)TraceEvent::Allocate, events[0].kind);
+        assert("Trace Record Test 7", (uint64_t)100, events[1].size);
+        assert("Trace Record Test 8", (uint64_t)(uintptr_t)a, events[2].address);
+        assert("Trace Record Test 9", (uint32_t)TraceEvent::Free, events[3].kind);
+        assert("Trace Record Test 10", true, events[0].time <= events[3].time);
+        assert("Trace Record Test 11", (size_t)2, pool.statistics().allocations);
+    }
+
+    /**
+     *  Tests threads recording at once lose nothing when their rings fill
+     */
+    void TraceThreadsTest () {
+        BasicMemoryManager<PoolStrategy, Locked, Backing, Traced<>> pool (TRACE_THREADS * TRACE_ROUNDS * 64);
+        TraceRecorder& recorder = TraceRecorder::global();
+        recorder.start(TRACE_FILE);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < TRACE_THREADS; ++t) {
+            workers.emplace_back ([&] () {
+                for (int i = 0; i < TRACE_ROUNDS; ++i) pool.deallocate(pool.allocate(16));
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        recorder.stop();
+
+        std::vector<TraceEvent> events;
+        loadTrace(TRACE_FILE, events);
+        assert("Trace Threads Test 1", (size_t)TRACE_THREADS * TRACE_ROUNDS * 2, events.size());
+
+        std::set<uint32_t> threads;
+        for (const TraceEvent& event : events) threads.insert(event.thread);
+        assert("Trace Threads Test 2", (size_t)TRACE_THREADS, threads.size());
+
+        bool sorted = std::is_sorted(events.begin(), events.end(), [] (const TraceEvent& a, const TraceEvent& b) {
+            return a.time < b.time;
+        });
+        assert("Trace Threads Test 3", true, sorted);
+    }
+
+    /**
+     *  Tests nothing is written while stopped and bad files are refused
+     */
+    void TraceStoppedTest () {
+        BasicMemoryManager<PoolStrategy, SingleThreaded, Backing, Traced<>> pool (POOL_SIZE);
+        TraceRecorder& recorder = TraceRecorder::global();
+
+        pool.deallocate(pool.allocate(8));
+        recorder.start(TRACE_FILE);
+        recorder.stop();
+
+        std::vector<TraceEvent> events;
+        assert("Trace Stopped Test 1", true, loadTrace(TRACE_FILE, events) && events.empty());
+
+        std::FILE* file = std::fopen(TRACE_FILE, "wb");
+        std::fputs("not a trace", file);
+        std::fclose(file);
+        assert("Trace Stopped Test 2", false, loadTrace(TRACE_FILE, events));
+        assert("Trace Stopped Test 3", false, loadTrace("", events));
+    }
+};
+
+#endif /* TraceTest_hpp */
@@ -6,7 +6,9 @@
 #ifndef UnitTest_hpp
 #define UnitTest_hpp
 
+#include <algorithm>
 #include <iostream>
+#include <string>
 #include <vector>
 
 class UnitTest
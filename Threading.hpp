@@ -0,0 +1,38 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Threading.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Threading_hpp
+#define Threading_hpp
+
+#include <mutex>
+
+/**
+ *  SingleThreaded
+ *
+ *  the threading policy of a manager used from one thread at a time.
+ *  Locking compiles to nothing and the policy takes up no space.
+ */
+struct SingleThreaded {
+    inline void lock   () {}
+    inline void unlock () {}
+};
+
+/**
+ *  Locked
+ *
+ *  the threading policy of a manager shared between threads. Every call
+ *  takes one mutex, so it suits managers that are shared but not hot;
+ *  ConcurrentPool is the one to use when many threads allocate at once.
+ */
+class Locked {
+    public:
+        inline void lock   () { mutex.lock(); }
+        inline void unlock () { mutex.unlock(); }
+
+    private:
+        std::mutex mutex;
+};
+
+#endif /* Threading_hpp */
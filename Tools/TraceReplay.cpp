@@ -0,0 +1,228 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  TraceReplay.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "../MemoryManager.hpp"
+#include "../Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ *  TraceReplay
+ *
+ *  feeds a trace written by TraceRecorder through every MemoryManager
+ *  mode and through the system malloc, one call at a time on a single
+ *  thread in the order the calls were recorded. Every call is timed on
+ *  its own; throughput counts only the time spent in the allocator,
+ *  not in the replay's own bookkeeping. Stack and Queue reject frees
+ *  out of their order, and those blocks stay allocated until the end.
+ *
+ *  usage: TraceReplay trace [size]
+ *
+ *  size is the memory each manager preallocates, by default twice the
+ *  most bytes the trace ever has live. Managers grow geometrically past
+ *  it rather than fail.
+ */
+
+struct ReplayResult {
+    std::string name;     // what the trace was replayed through
+    size_t      calls;    // allocates and frees replayed
+    size_t      failed;   // allocates that returned null
+    size_t      rejected; // frees the allocator refused
+    double      seconds;  // time spent in the allocator
+    uint64_t    p50, p99, p999, worst; // call latency in nanoseconds
+    size_t      peak;     // the most bytes occupied at once
+    size_t      reserved; // the most bytes held from the system at once
+};
+
+/**
+ *  replay
+ *
+ *  _name       what the trace is replayed through
+ *  _events     the trace in time order
+ *  _allocate   allocates a size, null on fail
+ *  _free       frees a block, false when refused
+ *  _occupied   the bytes occupied right now
+ *  _reserved   the bytes held from the system right now
+ *
+ *  Replays every event, mapping recorded addresses to the blocks handed
+ *  out now. Frees of blocks allocated before the trace began are skipped.
+ */
+template <class Allocate, class Free, class Occupied, class Reserved>
+ReplayResult replay (const std::string& _name, const std::vector<TraceEvent>& _events,
+                     Allocate _allocate, Free _free, Occupied _occupied, Reserved _reserved) {
+    typedef std::chrono::steady_clock Clock;
+
+    ReplayResult result = { _name, 0, 0, 0, 0.0, 0, 0, 0, 0, 0, 0 };
+    std::unordered_map<uint64_t, void*> live;
+    std::vector<uint64_t> latencies;
+    latencies.reserve (_events.size());
+    live.reserve (_events.size());
+
+    for (const TraceEvent& event : _events) {
+        void* block = nullptr;
+        bool  freed = true;
+
+        if (event.kind == TraceEvent::Allocate) {
+            Clock::time_point begin = Clock::now();
+            block = _allocate ((size_t)event.size);
+            latencies.push_back ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+
+            if (block == nullptr) ++result.failed;
+            else live[event.address] = block;
+        } else {
+            auto it = live.find (event.address);
+            if (it == live.end()) continue;
+
+            Clock::time_point begin = Clock::now();
+            freed = _free (it->second);
+            latencies.push_back ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+
+            if (!freed) ++result.rejected;
+            live.erase (it);
+        }
+
+        ++result.calls;
+        result.peak     = std::max (result.peak, _occupied());
+        result.reserved = std::max (result.reserved, _reserved());
+    }
+
+    // whatever is left goes back so the next replay starts clean
+    for (auto& entry : live) _free (entry.second);
+
+    uint64_t total = 0;
+    for (uint64_t latency : latencies) total += latency;
+    result.seconds = total / 1e9;
+
+    std::sort (latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        result.p50   = latencies[latencies.size() * 50 / 100];
+        result.p99   = latencies[latencies.size() * 99 / 100];
+        result.p999  = latencies[latencies.size() * 999 / 1000];
+        result.worst = latencies.back();
+    }
+    return result;
+}
+
+/**
+ *  replayManager
+ *
+ *  _mode   the strategy to replay through
+ *  _size   the memory to preallocate
+ *  _events the trace in time order
+ */
+ReplayResult replayManager (MemoryManager::Mode _mode, size_t _size, const std::vector<TraceEvent>& _events) {
+    static const char* names[] = { "Stack", "Queue", "Pool", "Bitmap", "Buddy", "TLSF" };
+
+    MemoryManager manager (_mode, _size, MemoryManager::Growth { MemoryManager::Growth::Geometric, _size, 0 });
+    return replay (names[_mode], _events,
+                   [&] (size_t _bytes) { return manager.allocate (_bytes); },
+                   [&] (void* _data) { return manager.deallocate (_data); },
+                   [&] () { return manager.occupiedMemory(); },
+                   [&] () { return manager.totalMemory(); });
+}
+
+/**
+ *  replayMalloc
+ *
+ *  _events the trace in time order
+ *
+ *  malloc does not say what it holds, so its footprint is the bytes
+ *  asked for by the blocks live at once.
+ */
+ReplayResult replayMalloc (const std::vector<TraceEvent>& _events) {
+    std::unordered_map<void*, size_t> sizes;
+    size_t occupied = 0;
+
+    return replay ("malloc", _events,
+                   [&] (size_t _bytes) {
+                       void* block = malloc (_bytes);
+                       if (block != nullptr) occupied += (sizes[block] = _bytes);
+                       return block;
+                   },
+                   [&] (void* _data) {
+                       occupied -= sizes[_data];
+                       sizes.erase (_data);
+                       free (_data);
+                       return true;
+                   },
+                   [&] () { return occupied; },
+                   [&] () { return occupied; });
+}
+
+/**
+ *  peakLive
+ *
+ *  _events the trace in time order
+ *
+ *  the most bytes the recorded program had live at once.
+ */
+size_t peakLive (const std::vector<TraceEvent>& _events) {
+    std::unordered_map<uint64_t, uint64_t> sizes;
+    size_t live = 0, peak = 0;
+
+    for (const TraceEvent& event : _events) {
+        if (event.kind == TraceEvent::Allocate) {
+            live += (sizes[event.address] = event.size);
+            peak  = std::max (peak, live);
+        } else {
+            auto it = sizes.find (event.address);
+            if (it == sizes.end()) continue;
+
+            live -= it->second;
+            sizes.erase (it);
+        }
+    }
+    return peak;
+}
+
+int main (int argc, const char * argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " trace [size]" << std::endl;
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    if (!loadTrace (argv[1], events)) {
+        std::cout << "ERROR: " << argv[1] << " is not a readable trace" << std::endl;
+        return 1;
+    }
+
+    size_t size = (argc > 2) ? (size_t)std::strtoull (argv[2], nullptr, 10) : 2 * peakLive (events);
+    if (size < CHUNK_GRANULE) size = CHUNK_GRANULE;
+
+    std::vector<ReplayResult> results;
+    results.push_back (replayManager (MemoryManager::Stack,  size, events));
+    results.push_back (replayManager (MemoryManager::Queue,  size, events));
+    results.push_back (replayManager (MemoryManager::Pool,   size, events));
+    results.push_back (replayManager (MemoryManager::Bitmap, size, events));
+    results.push_back (replayManager (MemoryManager::Buddy,  size, events));
+    results.push_back (replayManager (MemoryManager::TLSF,   size, events));
+    results.push_back (replayMalloc (events));
+
+    std::cout << std::endl << events.size() << " events, " << size << " Bytes preallocated" << std::endl << std::endl;
+    std::cout << std::left << std::setw (8) << "target"
+              << std::right << std::setw (14) << "calls/s"
+              << std::setw (10) << "p50 ns" << std::setw (10) << "p99 ns"
+              << std::setw (10) << "p99.9 ns" << std::setw (12) << "worst ns"
+              << std::setw (14) << "peak B" << std::setw (14) << "reserved B"
+              << std::setw (8) << "failed" << std::setw (10) << "rejected" << std::endl;
+
+    for (const ReplayResult& r : results) {
+        std::cout << std::left << std::setw (8) << r.name
+                  << std::right << std::setw (14) << (size_t)(r.seconds > 0 ? r.calls / r.seconds : 0)
+                  << std::setw (10) << r.p50 << std::setw (10) << r.p99
+                  << std::setw (10) << r.p999 << std::setw (12) << r.worst
+                  << std::setw (14) << r.peak << std::setw (14) << r.reserved
+                  << std::setw (8) << r.failed << std::setw (10) << r.rejected << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Trace.cpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ *  global
+ *
+ *  the one recorder of the process, made on first use.
+ */
+TraceRecorder& TraceRecorder::global () {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+/**
+ *  TraceRecorder Constructor
+ *
+ *  a recorder starts out stopped
+ */
+TraceRecorder::TraceRecorder () : file (nullptr), count (0), active (false) {}
+
+/**
+ *  TraceRecorder Destructor
+ *
+ *  writes out whatever is still buffered and closes the file
+ */
+TraceRecorder::~TraceRecorder () {
+    stop();
+}
+
+/**
+ *  start
+ *
+ *  _path   the file to write the trace to
+ *
+ *  Opens the file and starts recording, throwing away events left in
+ *  the rings from an earlier trace. returns false when already recording
+ *  or the file cannot be opened.
+ */
+bool TraceRecorder::start (const std::string& _path) {
+    std::lock_guard<std::mutex> guard (mutex);
+    if (file != nullptr) return false;
+
+    if (!(file = std::fopen (_path.c_str(), "wb"))) return false;
+    if (std::fwrite (TRACE_MAGIC, 1, 8, file) != 8) {
+        std::fclose (file);
+        file = nullptr;
+        return false;
+    }
+
+    for (auto& ring : rings) ring->tail.store (ring->head.load (std::memory_order_acquire), std::memory_order_release);
+
+    count  = 0;
+    origin = std::chrono::steady_clock::now();
+    active.store (true, std::memory_order_release);
+    return true;
+}
+
+/**
+ *  stop
+ *
+ *  stops recording, writes out every ring and closes the file.
+ */
+void TraceRecorder::stop () {
+    active.store (false, std::memory_order_release);
+
+    std::lock_guard<std::mutex> guard (mutex);
+    if (file == nullptr) return;
+
+    for (auto& ring : rings) drain (ring.get());
+    std::fclose (file);
+    file = nullptr;
+}
+
+/**
+ *  flush
+ *
+ *  writes out every ring without stopping, so a trace survives a crash
+ *  up to the last flush.
+ */
+void TraceRecorder::flush () {
+    std::lock_guard<std::mutex> guard (mutex);
+    if (file == nullptr) return;
+
+    for (auto& ring : rings) drain (ring.get());
+    std::fflush (file);
+}
+
+/**
+ *  local
+ *
+ *  the calling thread's ring, made and numbered the first time the
+ *  thread records. Rings outlive their threads so nothing recorded is
+ *  lost when a thread exits before the next flush.
+ */
+TraceRecorder::Ring* TraceRecorder::local () {
+    thread_local Ring* ring = nullptr;
+    if (ring != nullptr) return ring;
+
+    std::lock_guard<std::mutex> guard (mutex);
+    ring = new Ring;
+    ring->head.store (0, std::memory_order_relaxed);
+    ring->tail.store (0, std::memory_order_relaxed);
+    ring->thread = (uint32_t)rings.size();
+    rings.emplace_back (ring);
+    return ring;
+}
+
+/**
+ *  drain
+ *
+ *  _ring   a ring to empty, with the mutex held
+ *
+ *  Writes the published events of a ring to the file, in at most two
+ *  pieces when they wrap around the end. Events are dropped when no
+ *  file is open.
+ */
+void TraceRecorder::drain (Ring* _ring) {
+    size_t tail = _ring->tail.load (std::memory_order_relaxed);
+    size_t head = _ring->head.load (std::memory_order_acquire);
+
+    while (file != nullptr && tail != head) {
+        size_t slot   = tail & (TRACE_RING_SIZE - 1);
+        size_t events = std::min (head - tail, (size_t)TRACE_RING_SIZE - slot);
+
+        std::fwrite (_ring->events + slot, sizeof(TraceEvent), events, file);
+        count += events;
+        tail  += events;
+    }
+    _ring->tail.store (head, std::memory_order_release);
+}
+
+/**
+ *  loadTrace
+ *
+ *  _path   a file written by TraceRecorder
+ *  _events set to its events in time order
+ *
+ *  Reads a whole trace and merges the threads' events by time. returns
+ *  false when the file cannot be read, is not a trace, or was cut off
+ *  in the middle of an event.
+ */
+bool loadTrace (const std::string& _path, std::vector<TraceEvent>& _events) {
+    _events.clear();
+
+    std::FILE* file = std::fopen (_path.c_str(), "rb");
+    if (file == nullptr) return false;
+
+    char magic[8];
+    bool valid = std::fread (magic, 1, 8, file) == 8 && std::memcmp (magic, TRACE_MAGIC, 8) == 0;
+
+    TraceEvent event;
+    size_t     read = 0;
+    while (valid && (read = std::fread (&event, 1, sizeof(TraceEvent), file)) == sizeof(TraceEvent)) {
+        _events.push_back (event);
+    }
+    if (valid && read != 0) valid = false;
+    std::fclose (file);
+
+    std::stable_sort (_events.begin(), _events.end(), [] (const TraceEvent& a, const TraceEvent& b) {
+        return a.time < b.time;
+    });
+    return valid;
+}
@@ -0,0 +1,144 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  Trace.hpp
+ *  MemoryManager
+ *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef Trace_hpp
+#define Trace_hpp
+
+#include "Stats.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_RING_SIZE 4096       // events a thread buffers before flushing them itself
+#define TRACE_MAGIC     "MMTRACE1" // the first bytes of every trace file
+
+/**
+ *  TraceEvent
+ *
+ *  one allocate or free as it is written to a trace file, in the byte
+ *  order of the machine that recorded it. Times are nanoseconds since
+ *  recording started; a free has no size.
+ */
+struct TraceEvent {
+    enum Kind : uint32_t { Allocate, Free };
+
+    uint64_t time;    // when the call returned
+    uint64_t address; // the block handed out or freed
+    uint64_t size;    // the bytes asked for
+    uint32_t thread;  // the recording thread, numbered from 0
+    uint32_t kind;    // Allocate or Free
+};
+
+static_assert (sizeof(TraceEvent) == 32, "trace events are written as is");
+
+/**
+ *  TraceRecorder
+ *
+ *  records allocation traffic to a binary file for TraceReplay. Every
+ *  thread that records gets a ring of its own, a single producer single
+ *  consumer queue, so recording an event takes no lock: the thread
+ *  writes the slot and publishes it with one release store. Rings are
+ *  drained to the file under a mutex, by flush or by the thread itself
+ *  once its ring is full. Events from different threads reach the file
+ *  out of order and are sorted by time on loading.
+ */
+class TraceRecorder {
+    public:
+        /** the recorder every Traced manager writes to */
+        static TraceRecorder& global ();
+
+       ~TraceRecorder ();
+
+        /** return false when the file cannot be opened */
+        bool start (const std::string& _path);
+        void stop  ();
+        void flush ();
+
+        inline bool recording () const { return active.load (std::memory_order_acquire); }
+
+        inline void record (TraceEvent::Kind _kind, void* _address, size_t _size) {
+            if (!recording()) return;
+
+            Ring*  ring = local();
+            size_t head = ring->head.load (std::memory_order_relaxed);
+            if (head - ring->tail.load (std::memory_order_acquire) == TRACE_RING_SIZE) {
+                std::lock_guard<std::mutex> guard (mutex);
+                drain (ring);
+            }
+
+            TraceEvent& event = ring->events[head & (TRACE_RING_SIZE - 1)];
+            event.time    = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+            event.address = (uint64_t)(uintptr_t)_address;
+            event.size    = _size;
+            event.thread  = ring->thread;
+            event.kind    = _kind;
+            ring->head.store (head + 1, std::memory_order_release);
+        }
+
+        /** events written to the file since start, exact once stopped */
+        inline size_t written () const { return count; }
+
+    private:
+        struct Ring {
+            std::atomic<size_t> head;   // the next slot the thread writes
+            std::atomic<size_t> tail;   // the next slot drained to the file
+            uint32_t            thread; // the number of the owning thread
+            TraceEvent          events[TRACE_RING_SIZE];
+        };
+
+        TraceRecorder ();
+        TraceRecorder (const TraceRecorder&) = delete;
+        TraceRecorder& operator= (const TraceRecorder&) = delete;
+
+        Ring* local ();
+        void  drain (Ring* _ring);
+
+        std::mutex                         mutex;  // guards the file, the rings list and draining
+        std::vector<std::unique_ptr<Ring>> rings;  // one per thread that ever recorded
+        std::FILE*                         file;   // the open trace, null when stopped
+        size_t                             count;  // events written since start
+        std::atomic<bool>                  active; // whether events are recorded
+        std::chrono::steady_clock::time_point origin; // time zero of the trace
+};
+
+/**
+ *  loadTrace
+ *
+ *  _path   a file written by TraceRecorder
+ *  _events set to its events in time order
+ *
+ *  return false when the file cannot be read or is not a trace.
+ */
+bool loadTrace (const std::string& _path, std::vector<TraceEvent>& _events);
+
+/**
+ *  Traced
+ *
+ *  a statistics policy that also writes every successful allocate and
+ *  free to the global TraceRecorder, passing the hooks on to the policy
+ *  it wraps. While the recorder is stopped a hook costs one load.
+ */
+template <class StatsPolicy = NoStats>
+class Traced : public StatsPolicy {
+    public:
+        inline void allocated (size_t _size, void* _block, size_t _occupied) {
+            StatsPolicy::allocated (_size, _block, _occupied);
+            if (_block != nullptr) TraceRecorder::global().record (TraceEvent::Allocate, _block, _size);
+        }
+
+        inline void freed (void* _data, bool _success) {
+            StatsPolicy::freed (_data, _success);
+            if (_success) TraceRecorder::global().record (TraceEvent::Free, _data, 0);
+        }
+};
+
+#endif /* Trace_hpp */
@@ -7,6 +7,24 @@
 #include "Testing/StackTest.hpp"
 #include "Testing/QueueTest.hpp"
 #include "Testing/PoolTest.hpp"
+#include "Testing/BitmapTest.hpp"
+#include "Testing/BuddyTest.hpp"
+#include "Testing/TLSFTest.hpp"
+#include "Testing/SlabTest.hpp"
+#include "Testing/ConcurrentTest.hpp"
+#include "Testing/ArenaTest.hpp"
+#include "Testing/AllocatorTest.hpp"
+#include "Testing/SmartPointerTest.hpp"
+#include "Testing/GrowthTest.hpp"
+#include "Testing/BackingTest.hpp"
+#include "Testing/SystemTest.hpp"
+#include "Testing/BasicTest.hpp"
+#include "Testing/StatsTest.hpp"
+#include "Testing/TraceTest.hpp"
+#include "Testing/HandleTest.hpp"
+#include "Testing/DebugTest.hpp"
+#include "Testing/SanitizerTest.hpp"
+#include "Testing/GlobalHeapTest.hpp"
 #include "Node.hpp"
 
 int main(int argc, const char * argv[]) {
@@ -18,6 +36,60 @@ int main(int argc, const char * argv[]) {
     
     PoolTest pool;
     pool.run();
+    
+    BitmapTest bitmap;
+    bitmap.run();
+    
+    BuddyTest buddy;
+    buddy.run();
+    
+    TLSFTest tlsf;
+    tlsf.run();
+    
+    SlabTest slab;
+    slab.run();
+    
+    ConcurrentTest concurrent;
+    concurrent.run();
+    
+    ArenaTest arena;
+    arena.run();
+    
+    AllocatorTest allocator;
+    allocator.run();
+    
+    SmartPointerTest smartPointer;
+    smartPointer.run();
+    
+    GrowthTest growth;
+    growth.run();
+    
+    BackingTest backing;
+    backing.run();
+    
+    SystemTest system;
+    system.run();
+    
+    BasicTest basic;
+    basic.run();
+    
+    StatsTest stats;
+    stats.run();
+    
+    TraceTest trace;
+    trace.run();
+    
+    HandleTest handle;
+    handle.run();
+    
+    DebugTest debug;
+    debug.run();
+    
+    SanitizerTest sanitizer;
+    sanitizer.run();
+    
+    GlobalHeapTest globalHeap;
+    globalHeap.run();
      
     return 0;
 }